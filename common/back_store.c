@@ -0,0 +1,188 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "back_store.h"
+
+// stdio: the original fseek + fread/fwrite path
+static int stdio_read(struct BackStore* store, void* memory, long start, long len) {
+    if (fseek(store->fh, start, SEEK_SET) || fread(memory, len, 1, store->fh) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+static int stdio_write(struct BackStore* store, const void* memory, long start, long len) {
+    if (fseek(store->fh, start, SEEK_SET) || fwrite(memory, len, 1, store->fh) != 1) {
+        return -1;
+    }
+    return 0;
+}
+
+static int stdio_direct_fd(struct BackStore* store) {
+    // unbuffered, so fread never returns bytes that a pwrite has since replaced
+    if (setvbuf(store->fh, NULL, _IONBF, 0)) {
+        return -1;
+    }
+    return store->fd;
+}
+
+static void stdio_close(struct BackStore* store) {
+    fclose(store->fh);
+}
+
+static const struct BackStoreOps stdio_back_store_ops = {
+    "stdio", stdio_read, stdio_write, stdio_direct_fd, stdio_close
+};
+
+// mmap: the whole file is mapped, page-ins and write-backs are memcpys
+static int mmap_read(struct BackStore* store, void* memory, long start, long len) {
+    if (memory != store->map + start) {
+        memcpy(memory, store->map + start, len);
+    }
+    return 0;
+}
+
+static int mmap_write(struct BackStore* store, const void* memory, long start, long len) {
+    if (!store->writable) {
+        errno = EBADF;
+        return -1;
+    }
+    // an aliased frame already is the mapping
+    if (memory != store->map + start) {
+        memcpy(store->map + start, memory, len);
+    }
+    long page_size = sysconf(_SC_PAGESIZE);
+    long aligned = start & ~(page_size - 1);
+    return msync(store->map + aligned, len + (start - aligned), MS_ASYNC);
+}
+
+static int mmap_direct_fd(struct BackStore* store) {
+    // a shared mapping and pwrite see the same page cache
+    return store->writable ? store->fd : -1;
+}
+
+static void mmap_close(struct BackStore* store) {
+    if (store->map) {
+        if (store->writable) {
+            msync(store->map, store->size, MS_SYNC);
+        }
+        munmap(store->map, store->size);
+    }
+    close(store->fd);
+}
+
+static const struct BackStoreOps mmap_back_store_ops = {
+    "mmap", mmap_read, mmap_write, mmap_direct_fd, mmap_close
+};
+
+// memory: a private copy, writes never reach a file
+static int memory_direct_fd(struct BackStore* store) {
+    return -1;
+}
+
+static int memory_write(struct BackStore* store, const void* memory, long start, long len) {
+    if (memory != store->map + start) {
+        memcpy(store->map + start, memory, len);
+    }
+    return 0;
+}
+
+static void memory_close(struct BackStore* store) {
+    free(store->map);
+}
+
+static const struct BackStoreOps memory_back_store_ops = {
+    "memory", mmap_read, memory_write, memory_direct_fd, memory_close
+};
+
+/**
+ Opens the file fname with the backend called kind ("stdio" or "mmap"). A
+ store that is not writable is never modified; in mmap mode its pages are
+ still writable in memory (copy-on-write), so zero-copy frames work.
+ Returns 0 on success, -1 with errno set on failure (EINVAL for an unknown
+ kind or zero_copy without mmap).
+ */
+int back_store_open(struct BackStore* store, const char* fname, const char* kind, int writable,
+                    int zero_copy) {
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+    store->writable = writable;
+    store->zero_copy = zero_copy;
+    int use_mmap = strcmp(kind, "mmap") == 0;
+    if ((!use_mmap && strcmp(kind, "stdio")) || (zero_copy && !use_mmap)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct stat st;
+    if (use_mmap) {
+        store->ops = &mmap_back_store_ops;
+        store->fd = open(fname, writable ? O_RDWR : O_RDONLY);
+        if (store->fd < 0) {
+            return -1;
+        }
+    } else {
+        store->ops = &stdio_back_store_ops;
+        store->fh = fopen(fname, writable ? "r+" : "rb");
+        if (!store->fh) {
+            return -1;
+        }
+        store->fd = fileno(store->fh);
+    }
+    if (fstat(store->fd, &st)) {
+        back_store_close(store);
+        return -1;
+    }
+    store->size = st.st_size;
+
+    if (use_mmap && store->size > 0) {
+        store->map = (char *) mmap(NULL, store->size, PROT_READ | PROT_WRITE,
+                                   writable ? MAP_SHARED : MAP_PRIVATE, store->fd, 0);
+        if (store->map == MAP_FAILED) {
+            store->map = NULL;
+            back_store_close(store);
+            return -1;
+        }
+        // pages are faulted in trace order, which readahead cannot predict
+        madvise(store->map, store->size, MADV_RANDOM);
+    }
+    return 0;
+}
+
+/**
+ Opens a writable in-memory store holding a copy of size bytes of data.
+ Returns 0 on success.
+ */
+int back_store_open_memory(struct BackStore* store, const char* data, long size) {
+    memset(store, 0, sizeof(*store));
+    store->ops = &memory_back_store_ops;
+    store->fd = -1;
+    store->writable = 1;
+    store->size = size;
+    store->map = (char *) malloc(size > 0 ? size : 1);
+    if (!store->map) {
+        return -1;
+    }
+    memcpy(store->map, data, size);
+    return 0;
+}
+
+void back_store_close(struct BackStore* store) {
+    if (store->ops) {
+        store->ops->close(store);
+    }
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+}
+
+/**
+ Returns the names of the file backends, for usage messages.
+ */
+const char* back_store_names(void) {
+    return "stdio, mmap";
+}
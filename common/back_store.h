@@ -0,0 +1,71 @@
+#ifndef BACK_STORE_H
+#define BACK_STORE_H
+
+#include <stdio.h>
+
+/**
+ Backing store interface. Pages are read and written as byte ranges that lie
+ inside the store; the simulator deals with anything past its end.
+
+ Backends:
+ stdio    fseek + fread/fwrite on a FILE (the original behaviour)
+ mmap     the file is mapped once; page-ins copy out of the mapping and dirty
+          write-backs copy into it and msync the range. With zero_copy, frames
+          alias the mapping instead of being copied (see back_store_alias).
+ memory   a private in-memory copy, used by the sweep so that simulations
+          running side by side do not share a file
+ */
+struct BackStore;
+
+struct BackStoreOps {
+    const char * name;
+    int (*read)(struct BackStore* store, void* memory, long start, long len);
+    int (*write)(struct BackStore* store, const void* memory, long start, long len);
+    int (*direct_fd)(struct BackStore* store);
+    void (*close)(struct BackStore* store);
+};
+
+struct BackStore {
+    const struct BackStoreOps * ops;
+    long size;
+    int writable;
+    int zero_copy;
+    FILE * fh;     // stdio
+    int fd;        // stdio and mmap, -1 for memory
+    char * map;    // mmap and memory: the whole store
+};
+
+int back_store_open(struct BackStore* store, const char* fname, const char* kind, int writable,
+                    int zero_copy);
+int back_store_open_memory(struct BackStore* store, const char* data, long size);
+void back_store_close(struct BackStore* store);
+const char* back_store_names(void);
+
+static inline int back_store_read(struct BackStore* store, void* memory, long start, long len) {
+    return store->ops->read(store, memory, start, len);
+}
+
+static inline int back_store_write(struct BackStore* store, const void* memory, long start,
+                                   long len) {
+    return store->ops->write(store, memory, start, len);
+}
+
+/**
+ Returns a file descriptor that may be written with pwrite/pwritev without
+ stdio caching stale copies of what it overwrites, or -1 if there is none.
+ Must be called before the first read or write.
+ */
+static inline int back_store_direct_fd(struct BackStore* store) {
+    return store->ops->direct_fd(store);
+}
+
+/**
+ In zero-copy mode returns the mapped bytes [start, start + len) for a frame
+ to use in place of physical memory, or NULL if the range cannot be aliased
+ (zero-copy is off, or the range is not entirely inside the store).
+ */
+static inline char* back_store_alias(struct BackStore* store, long start, long len) {
+    return store->zero_copy && start + len <= store->size ? store->map + start : NULL;
+}
+
+#endif
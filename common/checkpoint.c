@@ -0,0 +1,224 @@
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "checkpoint.h"
+
+static volatile sig_atomic_t ckpt_signalled;
+
+/**
+ Pads the file with zeros up to a multiple of align.
+ */
+static void ckpt_align(struct CkptWriter* out, uint64_t align) {
+    static const char zeros[CKPT_PAGE_ALIGN];
+    uint64_t pad = (align - out->offset % align) % align;
+    ckpt_write(out, zeros, pad);
+}
+
+/**
+ Records the length of the section being written, if any.
+ */
+static void ckpt_end_section(struct CkptWriter* out) {
+    if (out->num_sections > 0) {
+        struct CkptSection * last = &out->sections[out->num_sections - 1];
+        last->len = out->offset - last->offset;
+    }
+}
+
+/**
+ Creates a checkpoint to be written to path. Returns 0 on success, -1 if the
+ file cannot be created.
+ */
+int ckpt_create(struct CkptWriter* out, const char* path) {
+    memset(out, 0, sizeof(*out));
+    out->path = strdup(path);
+    out->tmp_path = (char *) malloc(strlen(path) + 5);
+    if (!out->path || !out->tmp_path) {
+        free(out->path);
+        free(out->tmp_path);
+        return -1;
+    }
+    strcpy(out->tmp_path, path);
+    strcat(out->tmp_path, ".tmp");
+    out->file = fopen(out->tmp_path, "wb");
+    if (!out->file) {
+        free(out->path);
+        free(out->tmp_path);
+        return -1;
+    }
+    // the header is filled in by ckpt_commit
+    struct CkptHeader header;
+    memset(&header, 0, sizeof(header));
+    ckpt_write(out, &header, sizeof(header));
+    return 0;
+}
+
+/**
+ Ends the current section, if any, and starts section id. Bulk sections are
+ page_aligned in the file.
+ */
+void ckpt_begin(struct CkptWriter* out, uint32_t id, int page_aligned) {
+    ckpt_end_section(out);
+    if (out->num_sections == CKPT_MAX_SECTIONS) {
+        out->error = 1;
+        return;
+    }
+    ckpt_align(out, page_aligned ? CKPT_PAGE_ALIGN : 8);
+    struct CkptSection * section = &out->sections[out->num_sections++];
+    memset(section, 0, sizeof(*section));
+    section->id = id;
+    section->offset = out->offset;
+}
+
+/**
+ Appends len bytes to the current section.
+ */
+void ckpt_write(struct CkptWriter* out, const void* data, size_t len) {
+    if (out->error || len == 0) {
+        return;
+    }
+    if (fwrite(data, 1, len, out->file) != len) {
+        out->error = 1;
+    }
+    out->offset += len;
+}
+
+/**
+ Ends the last section, writes the directory and header, and puts the file
+ in place of any earlier checkpoint at the same path. position is the number
+ of trace records consumed. Returns 0 on success; on failure the earlier
+ checkpoint is left as it was and -1 is returned.
+ */
+int ckpt_commit(struct CkptWriter* out, uint64_t position) {
+    ckpt_end_section(out);
+    ckpt_align(out, 8);
+    struct CkptHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CKPT_MAGIC, 4);
+    header.version = CKPT_VERSION;
+    header.header_size = sizeof(header);
+    header.num_sections = out->num_sections;
+    header.position = position;
+    header.directory = out->offset;
+    ckpt_write(out, out->sections, out->num_sections * sizeof(struct CkptSection));
+    if (!out->error && (fseek(out->file, 0, SEEK_SET) ||
+                        fwrite(&header, sizeof(header), 1, out->file) != 1 ||
+                        fflush(out->file) || fsync(fileno(out->file)))) {
+        out->error = 1;
+    }
+    if (fclose(out->file) || out->error || rename(out->tmp_path, out->path)) {
+        unlink(out->tmp_path);
+        out->error = 1;
+    }
+    free(out->path);
+    free(out->tmp_path);
+    return out->error ? -1 : 0;
+}
+
+/**
+ Maps the checkpoint at path and checks its header and directory. Returns 0
+ on success, -1 if the file cannot be read or is not a checkpoint of this
+ version.
+ */
+int ckpt_open(struct Checkpoint* ckpt, const char* path) {
+    memset(ckpt, 0, sizeof(*ckpt));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || (size_t) st.st_size < sizeof(struct CkptHeader)) {
+        close(fd);
+        return -1;
+    }
+    void * map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    ckpt->map = (const char *) map;
+    ckpt->len = st.st_size;
+    ckpt->header = (const struct CkptHeader *) map;
+    const struct CkptHeader * header = ckpt->header;
+    if (memcmp(header->magic, CKPT_MAGIC, 4) || header->version != CKPT_VERSION ||
+        header->num_sections > CKPT_MAX_SECTIONS || header->directory > ckpt->len ||
+        (ckpt->len - header->directory) / sizeof(struct CkptSection) < header->num_sections) {
+        ckpt_close(ckpt);
+        return -1;
+    }
+    ckpt->sections = (const struct CkptSection *) (ckpt->map + header->directory);
+    for (uint32_t i = 0; i < header->num_sections; i++) {
+        const struct CkptSection * section = &ckpt->sections[i];
+        if (section->offset > ckpt->len || section->len > ckpt->len - section->offset) {
+            ckpt_close(ckpt);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void ckpt_close(struct Checkpoint* ckpt) {
+    if (ckpt->map) {
+        munmap((void *) ckpt->map, ckpt->len);
+    }
+    memset(ckpt, 0, sizeof(*ckpt));
+}
+
+/**
+ Points in at section id. Returns 0 on success, -1 if the checkpoint has no
+ such section.
+ */
+int ckpt_section(const struct Checkpoint* ckpt, uint32_t id, struct CkptReader* in) {
+    for (uint32_t i = 0; i < ckpt->header->num_sections; i++) {
+        if (ckpt->sections[i].id == id) {
+            in->pos = ckpt->map + ckpt->sections[i].offset;
+            in->end = in->pos + ckpt->sections[i].len;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ Returns the next len bytes of the section in place, in the mapping, and
+ moves past them. Returns NULL if the section is shorter.
+ */
+const void* ckpt_view(struct CkptReader* in, size_t len) {
+    if ((size_t) (in->end - in->pos) < len) {
+        return NULL;
+    }
+    const void * bytes = in->pos;
+    in->pos += len;
+    return bytes;
+}
+
+static void ckpt_signal_handler(int signum) {
+    ckpt_signalled = 1;
+}
+
+/**
+ Makes signal signum request a checkpoint instead of terminating the process.
+ */
+void ckpt_catch_signal(int signum) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = ckpt_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(signum, &action, NULL);
+}
+
+/**
+ Returns 1, once, if a checkpoint was requested by a signal since the last call.
+ */
+int ckpt_requested(void) {
+    if (!ckpt_signalled) {
+        return 0;
+    }
+    ckpt_signalled = 0;
+    return 1;
+}
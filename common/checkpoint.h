@@ -0,0 +1,115 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ Checkpoint file format. A checkpoint starts with a 32 byte header and holds
+ a number of sections, each a run of bytes written and read in order by the
+ module that owns that part of the simulator state, followed by a directory
+ of the sections. Sections start on 8 byte boundaries; the bulk ones (frame
+ contents, the backing store image) start on a 4 KiB boundary, so once the
+ file is mapped they are copied out page by page straight from the page
+ cache. Everything is in host byte order: a checkpoint is for resuming on the
+ machine that took it, not for exchange.
+
+ Readers ignore sections they do not know, so sections can be added without
+ a new version; a change to the layout of an existing section needs one.
+
+ A checkpoint is written to path.tmp and renamed over path once complete, so
+ a crash while writing leaves the previous checkpoint intact.
+ */
+#define CKPT_MAGIC "VMCK"
+#define CKPT_VERSION 3
+#define CKPT_MAX_SECTIONS 32
+#define CKPT_PAGE_ALIGN 4096
+
+struct CkptHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t num_sections;
+    uint32_t reserved;
+    uint64_t position;    // trace records consumed when the checkpoint was taken
+    uint64_t directory;   // file offset of the section directory
+};
+
+struct CkptSection {
+    uint32_t id;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t len;
+};
+
+// sections of a simulator checkpoint
+#define CKPT_CONFIG 1          // geometry and features, checked on restore
+#define CKPT_COUNTERS 2        // access counters and output position
+#define CKPT_PAGE_TABLES 3
+#define CKPT_TLB 4
+#define CKPT_FRAMES 5          // frame table and replacement policy state
+#define CKPT_MEMORY 6          // frame contents, page aligned
+#define CKPT_STORE 7           // backing store image, page aligned
+#define CKPT_SPILL 8           // pages written past the end of the store
+#define CKPT_WRITE_BEHIND 9
+#define CKPT_TIER 10
+#define CKPT_PREFETCH 11
+#define CKPT_RESIDENT_SETS 12
+#define CKPT_HUGE 13
+#define CKPT_STATS 14
+
+struct CkptWriter {
+    FILE * file;
+    char * path;
+    char * tmp_path;
+    struct CkptSection sections[CKPT_MAX_SECTIONS];
+    uint32_t num_sections;
+    uint64_t offset;      // bytes written so far
+    int error;            // set by the first failed write, reported by ckpt_commit
+};
+
+/**
+ A checkpoint mapped for reading.
+ */
+struct Checkpoint {
+    const char * map;
+    size_t len;
+    const struct CkptHeader * header;
+    const struct CkptSection * sections;
+};
+
+// the unread part of one section
+struct CkptReader {
+    const char * pos;
+    const char * end;
+};
+
+int ckpt_create(struct CkptWriter* out, const char* path);
+void ckpt_begin(struct CkptWriter* out, uint32_t id, int page_aligned);
+void ckpt_write(struct CkptWriter* out, const void* data, size_t len);
+int ckpt_commit(struct CkptWriter* out, uint64_t position);
+
+int ckpt_open(struct Checkpoint* ckpt, const char* path);
+void ckpt_close(struct Checkpoint* ckpt);
+int ckpt_section(const struct Checkpoint* ckpt, uint32_t id, struct CkptReader* in);
+const void* ckpt_view(struct CkptReader* in, size_t len);
+
+void ckpt_catch_signal(int signum);
+int ckpt_requested(void);
+
+/**
+ Copies the next len bytes of the section into data. Returns 0 on success, -1
+ if the section is shorter.
+ */
+static inline int ckpt_read(struct CkptReader* in, void* data, size_t len) {
+    const void * bytes = ckpt_view(in, len);
+    if (!bytes) {
+        return -1;
+    }
+    memcpy(data, bytes, len);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,479 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compressed_tier.h"
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+#define LZ_LAST_LITERALS 5   // the block ends with at least this many literals
+#define LZ_MATCH_LIMIT 12    // no match starts closer than this to the end
+
+static inline uint32_t lz_read32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ Writes the remainder of a length that did not fit in its token nibble.
+ Returns the new output position, or NULL if out of room.
+ */
+static unsigned char* lz_put_length(unsigned char* op, const unsigned char* oend, int len) {
+    while (len >= 255) {
+        if (op >= oend) {
+            return NULL;
+        }
+        *op++ = 255;
+        len -= 255;
+    }
+    if (op >= oend) {
+        return NULL;
+    }
+    *op++ = (unsigned char) len;
+    return op;
+}
+
+/**
+ Writes one sequence: lit literals from anchor, then a match of match_len
+ bytes offset back (no match when match_len is 0, for the last sequence).
+ Returns the new output position, or NULL if out of room.
+ */
+static unsigned char* lz_put_sequence(unsigned char* op, const unsigned char* oend,
+                                      const unsigned char* anchor, int lit, int offset,
+                                      int match_len) {
+    if (op >= oend) {
+        return NULL;
+    }
+    int extra = match_len ? match_len - LZ_MIN_MATCH : 0;
+    unsigned char* token = op++;
+    *token = (unsigned char) ((lit >= 15 ? 15 : lit) << 4 | (extra >= 15 ? 15 : extra));
+    if (lit >= 15 && !(op = lz_put_length(op, oend, lit - 15))) {
+        return NULL;
+    }
+    if (oend - op < lit + (match_len ? 2 : 0)) {
+        return NULL;
+    }
+    memcpy(op, anchor, lit);
+    op += lit;
+    if (match_len) {
+        *op++ = (unsigned char) (offset & 255);
+        *op++ = (unsigned char) (offset >> 8);
+        if (extra >= 15 && !(op = lz_put_length(op, oend, extra - 15))) {
+            return NULL;
+        }
+    }
+    return op;
+}
+
+/**
+ Compresses len bytes of src into at most cap bytes of dst in the LZ4 block
+ format, greedily, matching 4-byte sequences through a hash table. Returns
+ the compressed length, or 0 if it does not fit in cap.
+ */
+int lz_compress(const unsigned char* src, int len, unsigned char* dst, int cap) {
+    int table[1 << LZ_HASH_BITS];
+    memset(table, -1, sizeof(table));
+    const unsigned char* ip = src;
+    const unsigned char* anchor = src;
+    const unsigned char* end = src + len;
+    const unsigned char* match_start_limit = len > LZ_MATCH_LIMIT ? end - LZ_MATCH_LIMIT : src;
+    const unsigned char* match_end_limit = end - LZ_LAST_LITERALS;
+    unsigned char* op = dst;
+    const unsigned char* oend = dst + cap;
+    while (ip < match_start_limit) {
+        uint32_t seq = lz_read32(ip);
+        uint32_t h = lz_hash(seq);
+        int ref = table[h];
+        table[h] = (int) (ip - src);
+        if (ref < 0 || ip - src - ref > LZ_MAX_OFFSET || lz_read32(src + ref) != seq) {
+            ip++;
+            continue;
+        }
+        const unsigned char* match = src + ref;
+        const unsigned char* mp = ip + LZ_MIN_MATCH;
+        const unsigned char* mm = match + LZ_MIN_MATCH;
+        while (mp < match_end_limit && *mp == *mm) {
+            mp++;
+            mm++;
+        }
+        op = lz_put_sequence(op, oend, anchor, (int) (ip - anchor), (int) (ip - match),
+                             (int) (mp - ip));
+        if (!op) {
+            return 0;
+        }
+        ip = anchor = mp;
+    }
+    op = lz_put_sequence(op, oend, anchor, (int) (end - anchor), 0, 0);
+    return op ? (int) (op - dst) : 0;
+}
+
+/**
+ Decompresses len bytes of LZ4 block src into exactly out_len bytes of dst.
+ Returns 0 on success, -1 if the block is malformed.
+ */
+int lz_decompress(const unsigned char* src, int len, unsigned char* dst, int out_len) {
+    const unsigned char* ip = src;
+    const unsigned char* iend = src + len;
+    unsigned char* op = dst;
+    unsigned char* oend = dst + out_len;
+    while (ip < iend) {
+        int token = *ip++;
+        int lit = token >> 4;
+        if (lit == 15) {
+            int b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                lit += b;
+            } while (b == 255);
+        }
+        if (lit > iend - ip || lit > oend - op) {
+            return -1;
+        }
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == iend) {
+            break;
+        }
+        if (iend - ip < 2) {
+            return -1;
+        }
+        int offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        int match_len = token & 15;
+        if (match_len == 15) {
+            int b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op - dst || match_len > oend - op) {
+            return -1;
+        }
+        // byte by byte: the match may overlap the bytes it produces
+        const unsigned char* m = op - offset;
+        while (match_len--) {
+            *op++ = *m++;
+        }
+    }
+    return op == oend ? 0 : -1;
+}
+
+/**
+ Returns the bytes a page of len compressed bytes (0 if same-filled) is
+ charged against the budget.
+ */
+static inline long ctier_charge(int len) {
+    return (len > 0 ? len : 1) + CTIER_ENTRY_BYTES;
+}
+
+/**
+ Sets up an empty tier holding at most budget bytes of pages of
+ page_size bytes. Dirty pages pushed out of it go to write_back(ctx, ...).
+ Returns 0 on success, -1 on a bad budget or allocation failure.
+ */
+int ctier_init(struct CompressedTier* tier, long budget, int page_size,
+               TierWriteBackFn write_back, void* ctx) {
+    memset(tier, 0, sizeof(*tier));
+    tier->free = -1;
+    tier->oldest = -1;
+    tier->newest = -1;
+    if (budget < 1) {
+        return -1;
+    }
+    tier->scratch = (char *) malloc(page_size);
+    if (!tier->scratch || page_map_init(&tier->index, 1024)) {
+        ctier_free(tier);
+        return -1;
+    }
+    tier->budget = budget;
+    tier->page_size = page_size;
+    tier->write_back = write_back;
+    tier->ctx = ctx;
+    return 0;
+}
+
+void ctier_free(struct CompressedTier* tier) {
+    if (tier->entries) {
+        for (int i = tier->oldest; i >= 0; i = tier->entries[i].newer) {
+            free(tier->entries[i].data);
+        }
+    }
+    free(tier->entries);
+    free(tier->scratch);
+    if (tier->index.slots) {
+        page_map_free(&tier->index);
+    }
+    tier->entries = NULL;
+    tier->scratch = NULL;
+    tier->budget = 0;
+}
+
+/**
+ Takes entry i off the FIFO and the index and frees its bytes.
+ */
+static void ctier_remove(struct CompressedTier* tier, int i) {
+    struct TierEntry* entry = &tier->entries[i];
+    if (entry->older >= 0) {
+        tier->entries[entry->older].newer = entry->newer;
+    } else {
+        tier->oldest = entry->newer;
+    }
+    if (entry->newer >= 0) {
+        tier->entries[entry->newer].older = entry->older;
+    } else {
+        tier->newest = entry->older;
+    }
+    page_map_remove(&tier->index, entry->page_no);
+    tier->used -= ctier_charge(entry->len);
+    tier->num_pages--;
+    free(entry->data);
+    entry->data = NULL;
+    entry->newer = tier->free;
+    tier->free = i;
+}
+
+/**
+ Copies the page of entry into data. Returns 0 on success; a corrupt page is
+ reported, sets tier->failed and returns -1.
+ */
+static int ctier_expand(struct CompressedTier* tier, const struct TierEntry* entry, void* data) {
+    if (!entry->data) {
+        memset(data, entry->fill, tier->page_size);
+    } else if (lz_decompress((const unsigned char *) entry->data, entry->len,
+                             (unsigned char *) data, tier->page_size)) {
+        fprintf(stderr, "Compressed page %ld is corrupt\n", entry->page_no);
+        tier->failed = 1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ Drops the oldest page, writing it back first if it is dirty.
+ */
+static void ctier_drop_oldest(struct CompressedTier* tier) {
+    int i = tier->oldest;
+    struct TierEntry* entry = &tier->entries[i];
+    if (entry->dirty && ctier_expand(tier, entry, tier->scratch) == 0) {
+        tier->write_back(tier->ctx, entry->page_no, tier->scratch);
+        tier->num_written_back++;
+    }
+    tier->num_dropped++;
+    ctier_remove(tier, i);
+}
+
+/**
+ Adds a page as the newest entry: len compressed bytes in data, which the
+ tier takes over, or a page of fill bytes when data is NULL.
+ */
+static void ctier_append(struct CompressedTier* tier, long page_no, char* data, int len,
+                         unsigned char fill, int dirty) {
+    if (tier->free < 0) {
+        int cap = tier->entries_cap ? 2 * tier->entries_cap : 1024;
+        struct TierEntry* entries = (struct TierEntry *)
+            realloc(tier->entries, (size_t) cap * sizeof(struct TierEntry));
+        if (!entries) {
+            fprintf(stderr, "Cannot keep %d compressed pages\n", cap);
+            exit(-1);
+        }
+        for (int i = cap - 1; i >= tier->entries_cap; i--) {
+            entries[i].newer = tier->free;
+            tier->free = i;
+        }
+        tier->entries = entries;
+        tier->entries_cap = cap;
+    }
+    int i = tier->free;
+    struct TierEntry* entry = &tier->entries[i];
+    tier->free = entry->newer;
+    entry->page_no = page_no;
+    entry->data = data;
+    entry->len = len;
+    entry->fill = fill;
+    entry->dirty = dirty != 0;
+    entry->older = tier->newest;
+    entry->newer = -1;
+    if (tier->newest >= 0) {
+        tier->entries[tier->newest].newer = i;
+    } else {
+        tier->oldest = i;
+    }
+    tier->newest = i;
+    page_map_put(&tier->index, page_no, i);
+    tier->used += ctier_charge(len);
+    tier->num_pages++;
+}
+
+/**
+ Stores an evicted page, dirty if the backing store has an older copy.
+ Returns 0 if the tier took it, -1 if it is rejected as incompressible or
+ charged more than the whole budget; the caller then deals with it as if there were
+ no tier.
+ */
+int ctier_store(struct CompressedTier* tier, long page_no, const void* data, int dirty) {
+    const unsigned char* bytes = (const unsigned char *) data;
+    int same = 1;
+    for (int b = 1; b < tier->page_size && same; b++) {
+        same = bytes[b] == bytes[0];
+    }
+    int len = 0;
+    if (!same) {
+        len = lz_compress(bytes, tier->page_size, (unsigned char *) tier->scratch,
+                          tier->page_size - tier->page_size / 4);
+        if (len == 0) {
+            tier->num_rejected++;
+            return -1;
+        }
+    }
+    if (ctier_charge(len) > tier->budget) {
+        tier->num_rejected++;
+        return -1;
+    }
+    char* copy = NULL;
+    if (len > 0 && !(copy = (char *) malloc(len))) {
+        tier->num_rejected++;
+        return -1;
+    }
+    if (len > 0) {
+        memcpy(copy, tier->scratch, len);
+    }
+    while (tier->used + ctier_charge(len) > tier->budget) {
+        ctier_drop_oldest(tier);
+    }
+
+    ctier_append(tier, page_no, copy, len, bytes[0], dirty);
+    tier->num_stored++;
+    tier->num_dirty_stored += dirty != 0;
+    if (same) {
+        tier->num_same_filled++;
+    } else {
+        tier->bytes_in += tier->page_size;
+        tier->bytes_out += len;
+    }
+    return 0;
+}
+
+/**
+ Serves a page fault on page_no from the tier: copies the page into data,
+ sets *dirty if the backing store holds an older copy, and removes the page
+ from the tier. Returns 0 on a hit, -1 if the page is not in the tier or is
+ corrupt (see tier->failed).
+ */
+int ctier_load(struct CompressedTier* tier, long page_no, void* data, int* dirty) {
+    int i = page_map_get(&tier->index, page_no);
+    if (i < 0) {
+        tier->num_misses++;
+        return -1;
+    }
+    if (ctier_expand(tier, &tier->entries[i], data)) {
+        ctier_remove(tier, i);
+        return -1;
+    }
+    *dirty = tier->entries[i].dirty;
+    tier->num_hits++;
+    ctier_remove(tier, i);
+    return 0;
+}
+
+/**
+ Writes every dirty page in the tier back, oldest first, and marks it clean.
+ The pages stay in the tier.
+ */
+void ctier_flush(struct CompressedTier* tier) {
+    for (int i = tier->oldest; i >= 0; i = tier->entries[i].newer) {
+        struct TierEntry* entry = &tier->entries[i];
+        if (entry->dirty && ctier_expand(tier, entry, tier->scratch) == 0) {
+            tier->write_back(tier->ctx, entry->page_no, tier->scratch);
+            tier->num_written_back++;
+            entry->dirty = 0;
+        }
+    }
+}
+
+/**
+ Writes the counters and every page in the tier, oldest first, to a
+ checkpoint.
+ */
+void ctier_save(const struct CompressedTier* tier, struct CkptWriter* out) {
+    ckpt_write(out, &tier->budget, sizeof(tier->budget));
+    ckpt_write(out, &tier->num_stored, sizeof(tier->num_stored));
+    ckpt_write(out, &tier->num_same_filled, sizeof(tier->num_same_filled));
+    ckpt_write(out, &tier->num_rejected, sizeof(tier->num_rejected));
+    ckpt_write(out, &tier->num_dirty_stored, sizeof(tier->num_dirty_stored));
+    ckpt_write(out, &tier->num_hits, sizeof(tier->num_hits));
+    ckpt_write(out, &tier->num_misses, sizeof(tier->num_misses));
+    ckpt_write(out, &tier->num_dropped, sizeof(tier->num_dropped));
+    ckpt_write(out, &tier->num_written_back, sizeof(tier->num_written_back));
+    ckpt_write(out, &tier->bytes_in, sizeof(tier->bytes_in));
+    ckpt_write(out, &tier->bytes_out, sizeof(tier->bytes_out));
+    ckpt_write(out, &tier->num_pages, sizeof(tier->num_pages));
+    for (int i = tier->oldest; i >= 0; i = tier->entries[i].newer) {
+        const struct TierEntry* entry = &tier->entries[i];
+        ckpt_write(out, &entry->page_no, sizeof(entry->page_no));
+        ckpt_write(out, &entry->len, sizeof(entry->len));
+        ckpt_write(out, &entry->fill, sizeof(entry->fill));
+        ckpt_write(out, &entry->dirty, sizeof(entry->dirty));
+        ckpt_write(out, entry->data, entry->len);
+    }
+}
+
+/**
+ Refills an empty tier of the same budget from a checkpoint. Returns 0 on
+ success, -1 if it does not fit, is corrupt or memory runs out.
+ */
+int ctier_restore(struct CompressedTier* tier, struct CkptReader* in) {
+    long budget;
+    int num_pages;
+    if (ckpt_read(in, &budget, sizeof(budget)) || budget != tier->budget ||
+        ckpt_read(in, &tier->num_stored, sizeof(tier->num_stored)) ||
+        ckpt_read(in, &tier->num_same_filled, sizeof(tier->num_same_filled)) ||
+        ckpt_read(in, &tier->num_rejected, sizeof(tier->num_rejected)) ||
+        ckpt_read(in, &tier->num_dirty_stored, sizeof(tier->num_dirty_stored)) ||
+        ckpt_read(in, &tier->num_hits, sizeof(tier->num_hits)) ||
+        ckpt_read(in, &tier->num_misses, sizeof(tier->num_misses)) ||
+        ckpt_read(in, &tier->num_dropped, sizeof(tier->num_dropped)) ||
+        ckpt_read(in, &tier->num_written_back, sizeof(tier->num_written_back)) ||
+        ckpt_read(in, &tier->bytes_in, sizeof(tier->bytes_in)) ||
+        ckpt_read(in, &tier->bytes_out, sizeof(tier->bytes_out)) ||
+        ckpt_read(in, &num_pages, sizeof(num_pages)) || num_pages < 0) {
+        return -1;
+    }
+    for (int i = 0; i < num_pages; i++) {
+        long page_no;
+        int len;
+        unsigned char fill, dirty;
+        const char* bytes;
+        if (ckpt_read(in, &page_no, sizeof(page_no)) || ckpt_read(in, &len, sizeof(len)) ||
+            ckpt_read(in, &fill, sizeof(fill)) || ckpt_read(in, &dirty, sizeof(dirty)) ||
+            len < 0 || len > tier->page_size ||
+            tier->used + ctier_charge(len) > tier->budget ||
+            !(bytes = (const char *) ckpt_view(in, len))) {
+            return -1;
+        }
+        char* data = NULL;
+        if (len > 0) {
+            if (!(data = (char *) malloc(len))) {
+                return -1;
+            }
+            memcpy(data, bytes, len);
+        }
+        ctier_append(tier, page_no, data, len, fill, dirty);
+    }
+    return 0;
+}
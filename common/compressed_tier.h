@@ -0,0 +1,78 @@
+#ifndef COMPRESSED_TIER_H
+#define COMPRESSED_TIER_H
+
+#include "checkpoint.h"
+#include "page_map.h"
+
+/**
+ Compressed in-memory swap tier between the frames and the backing store, in
+ the manner of zswap. Evicted pages are compressed into the tier instead of
+ being written to (or, when clean, dropped in favour of) the backing store,
+ and a page fault is served from the tier before the store is read. A page
+ leaves the tier when it faults back in, so it is never both resident and
+ compressed.
+
+ Pages whose bytes are all the same are kept as that one byte. Others are
+ compressed in the LZ4 block format by a small greedy compressor; pages that
+ do not shrink to 3/4 of their size are rejected and go to the store as
+ before. Each page is charged its stored bytes (one for a same-filled page)
+ plus CTIER_ENTRY_BYTES for its entry and index slot, and the charges are
+ held within budget, so the tier is a real memory bound even for pages that
+ compress to nothing; to make room the oldest pages are dropped, the dirty
+ ones written back through write_back first.
+ */
+struct TierEntry {
+    long page_no;
+    char * data;          // NULL for a same-filled page
+    int len;              // compressed bytes
+    unsigned char fill;   // the byte of a same-filled page
+    unsigned char dirty;  // newer than the backing store
+    int older;            // FIFO links, -1 at either end; newer chains free entries
+    int newer;
+};
+
+// an entry, and the two slots its index keeps per entry at most half full
+#define CTIER_ENTRY_BYTES ((long) (sizeof(struct TierEntry) + 2 * sizeof(struct PageMapSlot)))
+
+typedef void (*TierWriteBackFn)(void* ctx, long page_no, void* data);
+
+struct CompressedTier {
+    long budget;                 // bytes charged at most, 0 when the tier is off
+    long used;                   // bytes charged for the pages held
+    int page_size;
+    struct TierEntry * entries;
+    int entries_cap;
+    int free;                    // free entries, chained through newer
+    int oldest;
+    int newest;
+    int num_pages;
+    struct PageMap index;        // page -> entry
+    char * scratch;              // a page of compressed or decompressed bytes
+    TierWriteBackFn write_back;
+    void * ctx;
+    long num_stored;
+    long num_same_filled;
+    long num_rejected;
+    long num_dirty_stored;
+    long num_hits;
+    long num_misses;
+    long num_dropped;            // pages pushed out to make room
+    long num_written_back;       // dirty pages written to the store on the way out
+    long bytes_in;               // page bytes of the pages compressed
+    long bytes_out;              // compressed bytes they took
+    int failed;                  // a page failed to decompress
+};
+
+int ctier_init(struct CompressedTier* tier, long budget, int page_size,
+               TierWriteBackFn write_back, void* ctx);
+void ctier_free(struct CompressedTier* tier);
+int ctier_store(struct CompressedTier* tier, long page_no, const void* data, int dirty);
+int ctier_load(struct CompressedTier* tier, long page_no, void* data, int* dirty);
+void ctier_flush(struct CompressedTier* tier);
+void ctier_save(const struct CompressedTier* tier, struct CkptWriter* out);
+int ctier_restore(struct CompressedTier* tier, struct CkptReader* in);
+
+int lz_compress(const unsigned char* src, int len, unsigned char* dst, int cap);
+int lz_decompress(const unsigned char* src, int len, unsigned char* dst, int out_len);
+
+#endif
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_heap.h"
+
+int frame_heap_init(struct FrameHeap* heap, int num_frames) {
+    memset(heap, 0, sizeof(*heap));
+    heap->heap = (int *) malloc(num_frames * sizeof(int));
+    heap->pos = (int *) malloc(num_frames * sizeof(int));
+    heap->key = (long long *) calloc(num_frames, sizeof(long long));
+    heap->tie = (long long *) calloc(num_frames, sizeof(long long));
+    if (!heap->heap || !heap->pos || !heap->key || !heap->tie) {
+        frame_heap_free(heap);
+        return -1;
+    }
+    for (int i = 0; i < num_frames; i++) {
+        heap->pos[i] = -1;
+    }
+    return 0;
+}
+
+void frame_heap_free(struct FrameHeap* heap) {
+    free(heap->heap);
+    free(heap->pos);
+    free(heap->key);
+    free(heap->tie);
+    memset(heap, 0, sizeof(*heap));
+}
+
+static int frame_heap_less(const struct FrameHeap* heap, int a, int b) {
+    return heap->key[a] < heap->key[b] || (heap->key[a] == heap->key[b] && heap->tie[a] < heap->tie[b]);
+}
+
+static void frame_heap_place(struct FrameHeap* heap, int i, int frame_no) {
+    heap->heap[i] = frame_no;
+    heap->pos[frame_no] = i;
+}
+
+static void frame_heap_sift_up(struct FrameHeap* heap, int i) {
+    int frame_no = heap->heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!frame_heap_less(heap, frame_no, heap->heap[parent])) {
+            break;
+        }
+        frame_heap_place(heap, i, heap->heap[parent]);
+        i = parent;
+    }
+    frame_heap_place(heap, i, frame_no);
+}
+
+static void frame_heap_sift_down(struct FrameHeap* heap, int i) {
+    int frame_no = heap->heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap->size) {
+            break;
+        }
+        if (child + 1 < heap->size && frame_heap_less(heap, heap->heap[child + 1], heap->heap[child])) {
+            child++;
+        }
+        if (!frame_heap_less(heap, heap->heap[child], frame_no)) {
+            break;
+        }
+        frame_heap_place(heap, i, heap->heap[child]);
+        i = child;
+    }
+    frame_heap_place(heap, i, frame_no);
+}
+
+/**
+ Inserts frame_no with the given key, or moves it if it is already in the heap.
+ */
+void frame_heap_set(struct FrameHeap* heap, int frame_no, long long key, long long tie) {
+    heap->key[frame_no] = key;
+    heap->tie[frame_no] = tie;
+    int i = heap->pos[frame_no];
+    if (i < 0) {
+        i = heap->size++;
+        frame_heap_place(heap, i, frame_no);
+    }
+    frame_heap_sift_up(heap, i);
+    frame_heap_sift_down(heap, heap->pos[frame_no]);
+}
+
+void frame_heap_remove(struct FrameHeap* heap, int frame_no) {
+    int i = heap->pos[frame_no];
+    if (i < 0) {
+        return;
+    }
+    heap->pos[frame_no] = -1;
+    heap->size--;
+    if (i == heap->size) {
+        return;
+    }
+    int moved = heap->heap[heap->size];
+    frame_heap_place(heap, i, moved);
+    frame_heap_sift_up(heap, i);
+    frame_heap_sift_down(heap, heap->pos[moved]);
+}
+
+void frame_heap_save(const struct FrameHeap* heap, int num_frames, struct CkptWriter* out) {
+    ckpt_write(out, &heap->size, sizeof(heap->size));
+    ckpt_write(out, heap->heap, num_frames * sizeof(int));
+    ckpt_write(out, heap->pos, num_frames * sizeof(int));
+    ckpt_write(out, heap->key, num_frames * sizeof(long long));
+    ckpt_write(out, heap->tie, num_frames * sizeof(long long));
+}
+
+int frame_heap_restore(struct FrameHeap* heap, int num_frames, struct CkptReader* in) {
+    if (ckpt_read(in, &heap->size, sizeof(heap->size)) || heap->size < 0 ||
+        heap->size > num_frames ||
+        ckpt_read(in, heap->heap, num_frames * sizeof(int)) ||
+        ckpt_read(in, heap->pos, num_frames * sizeof(int)) ||
+        ckpt_read(in, heap->key, num_frames * sizeof(long long)) ||
+        ckpt_read(in, heap->tie, num_frames * sizeof(long long))) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef FRAME_HEAP_H
+#define FRAME_HEAP_H
+
+#include "checkpoint.h"
+
+/**
+ Indexed binary min-heap of frames ordered by (key, tie). pos[] tracks where
+ each frame sits so a frame's key can be changed or the frame removed in
+ O(log n).
+ */
+struct FrameHeap {
+    int * heap;
+    int * pos;  // -1 if the frame is not in the heap
+    long long * key;
+    long long * tie;
+    int size;
+};
+
+int frame_heap_init(struct FrameHeap* heap, int num_frames);
+void frame_heap_free(struct FrameHeap* heap);
+void frame_heap_set(struct FrameHeap* heap, int frame_no, long long key, long long tie);
+void frame_heap_remove(struct FrameHeap* heap, int frame_no);
+void frame_heap_save(const struct FrameHeap* heap, int num_frames, struct CkptWriter* out);
+int frame_heap_restore(struct FrameHeap* heap, int num_frames, struct CkptReader* in);
+
+static inline int frame_heap_top(const struct FrameHeap* heap) {
+    return heap->size > 0 ? heap->heap[0] : -1;
+}
+
+#endif
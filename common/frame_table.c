@@ -0,0 +1,256 @@
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_table.h"
+
+/**
+ Allocates a frame table with every frame free, split into num_partitions
+ partitions of (nearly) equal size, each replaced by the policy called
+ policy_name. Returns 0 on success, -1 on an unknown policy, fewer frames than
+ partitions or allocation failure.
+ */
+int frame_table_init(struct FrameTable* frame_table, int num_frames, int num_partitions,
+                     const char* policy_name) {
+    memset(frame_table, 0, sizeof(*frame_table));
+    if (num_partitions < 1 || num_frames < num_partitions) {
+        return -1;
+    }
+    frame_table->frames = (struct Frame *) malloc(num_frames * sizeof(struct Frame));
+    frame_table->partitions = (struct FramePartition *) calloc(num_partitions,
+                                                               sizeof(struct FramePartition));
+    frame_table->free_list = (int *) malloc(num_frames * sizeof(int));
+    if (!frame_table->frames || !frame_table->partitions || !frame_table->free_list) {
+        frame_table_free(frame_table);
+        return -1;
+    }
+    frame_table->num_partitions = num_partitions;
+    int first = 0;
+    for (int p = 0; p < num_partitions; p++) {
+        struct FramePartition * part = &frame_table->partitions[p];
+        part->first = first;
+        part->num_frames = num_frames / num_partitions + (p < num_frames % num_partitions);
+        if (policy_init(&part->policy, policy_name, part->num_frames)) {
+            frame_table_free(frame_table);
+            return -1;
+        }
+        for (int i = first; i < first + part->num_frames; i++) {
+            frame_table->frames[i].page_no = -1;
+            frame_table->frames[i].pte = NULL;
+            frame_table->frames[i].dirty = 0;
+            frame_table->frames[i].loaded_at = 0;
+            frame_table->frames[i].prefetched = 0;
+            frame_table->frames[i].partition = p;
+        }
+        first += part->num_frames;
+    }
+    frame_table->num_frames = num_frames;
+    return 0;
+}
+
+void frame_table_free(struct FrameTable* frame_table) {
+    free(frame_table->frames);
+    for (int p = 0; p < frame_table->num_partitions; p++) {
+        policy_free(&frame_table->partitions[p].policy);
+    }
+    free(frame_table->partitions);
+    free(frame_table->free_list);
+    memset(frame_table, 0, sizeof(*frame_table));
+}
+
+/**
+ Returns a free frame of partition, one released by frame_table_recycle or
+ else one that has never been used, or -1 once every frame of the partition is
+ taken and a victim has to be chosen.
+ */
+int frame_table_alloc(struct FrameTable* frame_table, int partition) {
+    struct FramePartition * part = &frame_table->partitions[partition];
+    if (part->num_free > 0) {
+        return frame_table->free_list[part->first + --part->num_free];
+    }
+    if (part->num_used < part->num_frames) {
+        return part->first + part->num_used++;
+    }
+    return -1;
+}
+
+/**
+ Asks the replacement policy of partition which resident frame to evict so
+ that page_no can be loaded. The frame stays resident until
+ frame_table_release.
+ */
+int frame_table_select_victim(struct FrameTable* frame_table, int partition, long page_no) {
+    struct FramePartition * part = &frame_table->partitions[partition];
+    return part->first + part->policy.ops->victim(&part->policy, page_no);
+}
+
+/**
+ Records that page_no, whose page table entry is pte, has just been loaded,
+ clean, into frame_no at trace position now.
+ */
+void frame_table_assign(struct FrameTable* frame_table, int frame_no, long page_no,
+                        struct PTE* pte, long now) {
+    struct Frame * frame = &frame_table->frames[frame_no];
+    struct FramePartition * part = &frame_table->partitions[frame->partition];
+    frame->page_no = page_no;
+    frame->pte = pte;
+    frame->dirty = 0;
+    frame->loaded_at = frame_table->num_loads++;
+    frame->prefetched = 0;
+    part->policy.ops->load(&part->policy, frame_no - part->first, page_no, now);
+}
+
+/**
+ Marks frame_no free again once its page has been evicted.
+ */
+void frame_table_release(struct FrameTable* frame_table, int frame_no) {
+    struct FramePartition * part = &frame_table->partitions[frame_table->frames[frame_no].partition];
+    frame_table->frames[frame_no].page_no = -1;
+    frame_table->frames[frame_no].pte = NULL;
+    frame_table->frames[frame_no].dirty = 0;
+    part->policy.ops->evict(&part->policy, frame_no - part->first);
+}
+
+/**
+ Hands frame_no, released and not about to be reloaded, back to the
+ allocator of its partition.
+ */
+void frame_table_recycle(struct FrameTable* frame_table, int frame_no) {
+    struct FramePartition * part = &frame_table->partitions[frame_table->frames[frame_no].partition];
+    frame_table->free_list[part->first + part->num_free++] = frame_no;
+}
+
+/**
+ Returns the number of resident pages that are dirty.
+ */
+int frame_table_count_dirty(const struct FrameTable* frame_table) {
+    int num_dirty = 0;
+    for (int p = 0; p < frame_table->num_partitions; p++) {
+        const struct FramePartition * part = &frame_table->partitions[p];
+        for (int i = part->first; i < part->first + part->num_used; i++) {
+            num_dirty += frame_table->frames[i].page_no >= 0 && frame_table->frames[i].dirty;
+        }
+    }
+    return num_dirty;
+}
+
+/**
+ Writes the frames, the allocator state of every partition and the state of
+ its replacement policy to a checkpoint. The PTE pointers are not saved, the
+ owner of the page tables binds them again after a restore.
+ */
+void frame_table_save(const struct FrameTable* frame_table, struct CkptWriter* out) {
+    const char * policy_name = frame_table_policy_ops(frame_table)->name;
+    int name_len = (int) strlen(policy_name);
+    ckpt_write(out, &frame_table->num_frames, sizeof(frame_table->num_frames));
+    ckpt_write(out, &frame_table->num_partitions, sizeof(frame_table->num_partitions));
+    ckpt_write(out, &frame_table->num_loads, sizeof(frame_table->num_loads));
+    for (int i = 0; i < frame_table->num_frames; i++) {
+        const struct Frame * frame = &frame_table->frames[i];
+        ckpt_write(out, &frame->page_no, sizeof(frame->page_no));
+        ckpt_write(out, &frame->dirty, sizeof(frame->dirty));
+        ckpt_write(out, &frame->loaded_at, sizeof(frame->loaded_at));
+        ckpt_write(out, &frame->prefetched, sizeof(frame->prefetched));
+    }
+    ckpt_write(out, frame_table->free_list, frame_table->num_frames * sizeof(int));
+    for (int p = 0; p < frame_table->num_partitions; p++) {
+        ckpt_write(out, &frame_table->partitions[p].num_used, sizeof(int));
+        ckpt_write(out, &frame_table->partitions[p].num_free, sizeof(int));
+    }
+    ckpt_write(out, &name_len, sizeof(name_len));
+    ckpt_write(out, policy_name, name_len);
+    for (int p = 0; p < frame_table->num_partitions; p++) {
+        const struct ReplacementPolicy * policy = &frame_table->partitions[p].policy;
+        policy->ops->save(policy, out);
+    }
+}
+
+static int compare_loads(const void* a, const void* b, void* frames) {
+    long la = ((const struct Frame *) frames)[*(const int *) a].loaded_at;
+    long lb = ((const struct Frame *) frames)[*(const int *) b].loaded_at;
+    return la < lb ? -1 : la > lb;
+}
+
+/**
+ Hands the resident frames of partition to its policy in the order they were
+ loaded, as if it had been the policy all along and never seen a reference.
+ */
+static int frame_table_reseed(struct FrameTable* frame_table, int partition) {
+    struct FramePartition * part = &frame_table->partitions[partition];
+    int * order = (int *) malloc((part->num_frames > 0 ? part->num_frames : 1) * sizeof(int));
+    if (!order) {
+        return -1;
+    }
+    int num_resident = 0;
+    for (int i = part->first; i < part->first + part->num_frames; i++) {
+        if (frame_table->frames[i].page_no >= 0) {
+            order[num_resident++] = i;
+        }
+    }
+    qsort_r(order, num_resident, sizeof(int), compare_loads, frame_table->frames);
+    for (int i = 0; i < num_resident; i++) {
+        struct Frame * frame = &frame_table->frames[order[i]];
+        part->policy.ops->load(&part->policy, order[i] - part->first, frame->page_no,
+                               frame->loaded_at);
+    }
+    free(order);
+    return 0;
+}
+
+/**
+ Loads a frame table saved by frame_table_save into an empty one of the same
+ size and partitions. If the table was saved under another replacement
+ policy, the policy of this one starts from the resident pages in load order
+ instead, except for policies that look ahead in the trace, which cannot.
+ Returns 0 on success, -1 if the checkpoint does not fit or is corrupt.
+ */
+int frame_table_restore(struct FrameTable* frame_table, struct CkptReader* in) {
+    int num_frames, num_partitions, name_len;
+    if (ckpt_read(in, &num_frames, sizeof(num_frames)) ||
+        ckpt_read(in, &num_partitions, sizeof(num_partitions)) ||
+        num_frames != frame_table->num_frames || num_partitions != frame_table->num_partitions ||
+        ckpt_read(in, &frame_table->num_loads, sizeof(frame_table->num_loads))) {
+        return -1;
+    }
+    for (int i = 0; i < num_frames; i++) {
+        struct Frame * frame = &frame_table->frames[i];
+        if (ckpt_read(in, &frame->page_no, sizeof(frame->page_no)) ||
+            ckpt_read(in, &frame->dirty, sizeof(frame->dirty)) ||
+            ckpt_read(in, &frame->loaded_at, sizeof(frame->loaded_at)) ||
+            ckpt_read(in, &frame->prefetched, sizeof(frame->prefetched))) {
+            return -1;
+        }
+        frame->pte = NULL;
+    }
+    if (ckpt_read(in, frame_table->free_list, num_frames * sizeof(int))) {
+        return -1;
+    }
+    for (int p = 0; p < num_partitions; p++) {
+        struct FramePartition * part = &frame_table->partitions[p];
+        if (ckpt_read(in, &part->num_used, sizeof(int)) ||
+            ckpt_read(in, &part->num_free, sizeof(int)) ||
+            part->num_used < 0 || part->num_used > part->num_frames ||
+            part->num_free < 0 || part->num_free > part->num_used) {
+            return -1;
+        }
+    }
+    const char * policy_name;
+    const struct PolicyOps * ops = frame_table_policy_ops(frame_table);
+    if (ckpt_read(in, &name_len, sizeof(name_len)) || name_len < 0 ||
+        !(policy_name = (const char *) ckpt_view(in, name_len))) {
+        return -1;
+    }
+    int same_policy = (size_t) name_len == strlen(ops->name) &&
+                      memcmp(policy_name, ops->name, name_len) == 0;
+    if (!same_policy && ops->prepare) {
+        return -1;
+    }
+    for (int p = 0; p < num_partitions; p++) {
+        struct ReplacementPolicy * policy = &frame_table->partitions[p].policy;
+        if (same_policy ? policy->ops->restore(policy, in) : frame_table_reseed(frame_table, p)) {
+            return -1;
+        }
+    }
+    return 0;
+}
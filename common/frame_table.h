@@ -0,0 +1,75 @@
+#ifndef FRAME_TABLE_H
+#define FRAME_TABLE_H
+
+#include "checkpoint.h"
+#include "policy.h"
+#include "pte.h"
+
+/**
+ Inverted frame table: one entry per physical frame recording which page owns
+ it and where that page's table entry lives. It is the only record of which
+ frames are free, so eviction never has to search or walk the page table. The
+ replacement policy that picks victims is driven from here.
+
+ The frames may be split into partitions of consecutive frames, each with its
+ own policy instance; a page only ever replaces a page of its own partition
+ (local replacement). Policies number the frames of their partition from 0.
+ */
+struct Frame {
+    long page_no;     // owner page, -1 if the frame is free
+    struct PTE * pte; // page table entry of the owner page
+    int dirty;        // page was modified since it was loaded
+    long loaded_at;   // value of num_loads when the page was loaded
+    int prefetched;   // loaded by the prefetcher and not referenced since
+    int partition;    // partition the frame belongs to, fixed
+};
+
+struct FramePartition {
+    int first;       // first frame of the partition
+    int num_frames;
+    int num_used;    // frames [first + num_used, first + num_frames) have never been handed out
+    int num_free;    // released frames waiting for reuse, free_list[first, first + num_free)
+    struct ReplacementPolicy policy;
+};
+
+struct FrameTable {
+    struct Frame * frames;
+    int num_frames;
+    long num_loads;
+    struct FramePartition * partitions;
+    int num_partitions;
+    int * free_list;   // stack of released frames of each partition
+};
+
+int frame_table_init(struct FrameTable* frame_table, int num_frames, int num_partitions,
+                     const char* policy_name);
+void frame_table_free(struct FrameTable* frame_table);
+int frame_table_alloc(struct FrameTable* frame_table, int partition);
+int frame_table_select_victim(struct FrameTable* frame_table, int partition, long page_no);
+void frame_table_assign(struct FrameTable* frame_table, int frame_no, long page_no,
+                        struct PTE* pte, long now);
+void frame_table_release(struct FrameTable* frame_table, int frame_no);
+void frame_table_recycle(struct FrameTable* frame_table, int frame_no);
+int frame_table_count_dirty(const struct FrameTable* frame_table);
+void frame_table_save(const struct FrameTable* frame_table, struct CkptWriter* out);
+int frame_table_restore(struct FrameTable* frame_table, struct CkptReader* in);
+
+/**
+ Tells the replacement policy that the page in frame_no was referenced again.
+ */
+static inline void frame_table_touch(struct FrameTable* frame_table, int frame_no, long now) {
+    struct FramePartition * part = frame_table->partitions;
+    if (frame_table->num_partitions > 1) {
+        part += frame_table->frames[frame_no].partition;
+    }
+    part->policy.ops->access(&part->policy, frame_no - part->first, now);
+}
+
+/**
+ Returns the operations of the replacement policy, the same in every partition.
+ */
+static inline const struct PolicyOps* frame_table_policy_ops(const struct FrameTable* frame_table) {
+    return frame_table->partitions[0].policy.ops;
+}
+
+#endif
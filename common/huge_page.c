@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "huge_page.h"
+
+/**
+ Sets up huge pages of pages_per_huge base pages (a power of two, at least 2)
+ with a huge-page TLB of tlb_entries entries. Returns 0 on success, -1 on bad
+ parameters or allocation failure.
+ */
+int huge_init(struct HugePages* huge, int pages_per_huge, int tlb_entries, int promote_misses) {
+    memset(huge, 0, sizeof(*huge));
+    if (pages_per_huge < 2 || (pages_per_huge & (pages_per_huge - 1)) || tlb_entries < 1 ||
+        promote_misses < 1) {
+        return -1;
+    }
+    huge->pages_per_huge = pages_per_huge;
+    huge->shift = __builtin_ctz(pages_per_huge);
+    huge->promote_misses = promote_misses;
+    huge->ptes = (struct PTE *) calloc((size_t) tlb_entries * pages_per_huge, sizeof(struct PTE));
+    if (!huge->ptes || tlb_init(&huge->tlb, 1, tlb_entries) ||
+        page_map_init(&huge->index, 1024)) {
+        huge_free(huge);
+        return -1;
+    }
+    return 0;
+}
+
+void huge_free(struct HugePages* huge) {
+    tlb_free(&huge->tlb);
+    if (huge->index.slots) {
+        page_map_free(&huge->index);
+    }
+    free(huge->ptes);
+    free(huge->regions);
+    memset(huge, 0, sizeof(*huge));
+}
+
+/**
+ Returns the state of the region holding page_no, adding it the first time.
+ */
+struct HugeRegion* huge_region(struct HugePages* huge, long page_no) {
+    long region = page_no >> huge->shift;
+    int slot = page_map_get(&huge->index, region);
+    if (slot >= 0) {
+        return &huge->regions[slot];
+    }
+    if (huge->num_regions == huge->regions_cap) {
+        int cap = huge->regions_cap ? 2 * huge->regions_cap : 1024;
+        struct HugeRegion * regions = (struct HugeRegion *)
+            realloc(huge->regions, (size_t) cap * sizeof(struct HugeRegion));
+        if (!regions) {
+            fprintf(stderr, "Cannot keep %d huge-page regions\n", cap);
+            exit(-1);
+        }
+        huge->regions = regions;
+        huge->regions_cap = cap;
+    }
+    slot = huge->num_regions++;
+    page_map_put(&huge->index, region, slot);
+    memset(&huge->regions[slot], 0, sizeof(struct HugeRegion));
+    return &huge->regions[slot];
+}
+
+/**
+ Writes the huge-page TLB with its PTE copies, the regions and the counters
+ to a checkpoint.
+ */
+void huge_save(const struct HugePages* huge, struct CkptWriter* out) {
+    ckpt_write(out, &huge->pages_per_huge, sizeof(huge->pages_per_huge));
+    ckpt_write(out, &huge->num_hits, sizeof(huge->num_hits));
+    ckpt_write(out, &huge->num_promotions, sizeof(huge->num_promotions));
+    ckpt_write(out, &huge->num_demotions, sizeof(huge->num_demotions));
+    tlb_save(&huge->tlb, out);
+    ckpt_write(out, huge->ptes, (size_t) huge->tlb.num_sets * huge->tlb.num_ways *
+                                huge->pages_per_huge * sizeof(struct PTE));
+    ckpt_write(out, &huge->num_regions, sizeof(huge->num_regions));
+    ckpt_write(out, huge->regions, huge->num_regions * sizeof(struct HugeRegion));
+    page_map_save(&huge->index, out);
+}
+
+/**
+ Loads huge pages saved by huge_save into a fresh set of the same geometry.
+ Returns 0 on success, -1 if it does not fit or is corrupt.
+ */
+int huge_restore(struct HugePages* huge, struct CkptReader* in) {
+    int pages_per_huge, num_regions;
+    if (ckpt_read(in, &pages_per_huge, sizeof(pages_per_huge)) ||
+        pages_per_huge != huge->pages_per_huge ||
+        ckpt_read(in, &huge->num_hits, sizeof(huge->num_hits)) ||
+        ckpt_read(in, &huge->num_promotions, sizeof(huge->num_promotions)) ||
+        ckpt_read(in, &huge->num_demotions, sizeof(huge->num_demotions)) ||
+        tlb_restore(&huge->tlb, in) ||
+        ckpt_read(in, huge->ptes, (size_t) huge->tlb.num_sets * huge->tlb.num_ways *
+                                  pages_per_huge * sizeof(struct PTE)) ||
+        ckpt_read(in, &num_regions, sizeof(num_regions)) || num_regions < 0) {
+        return -1;
+    }
+    struct HugeRegion * regions = (struct HugeRegion *)
+        malloc((num_regions > 0 ? num_regions : 1) * sizeof(struct HugeRegion));
+    if (!regions || ckpt_read(in, regions, num_regions * sizeof(struct HugeRegion))) {
+        free(regions);
+        return -1;
+    }
+    free(huge->regions);
+    huge->regions = regions;
+    huge->num_regions = num_regions;
+    huge->regions_cap = num_regions > 0 ? num_regions : 1;
+    return page_map_restore(&huge->index, in);
+}
@@ -0,0 +1,67 @@
+#ifndef HUGE_PAGE_H
+#define HUGE_PAGE_H
+
+#include "checkpoint.h"
+#include "page_map.h"
+#include "pte.h"
+#include "tlb.h"
+
+/**
+ Huge pages. The tagged page numbers are grouped into aligned regions of
+ pages_per_huge base pages. A region is promoted to a huge page once it is
+ dense and hot: all its base pages are resident and it has taken
+ promote_misses base TLB misses since it last became fully resident. A
+ promoted region is translated by a single entry of a separate, fully
+ associative huge-page TLB (a split TLB), which holds a copy of the PTE of
+ every base page of the region, so one entry covers the reach of
+ pages_per_huge base entries. Evicting any base page of a promoted region
+ demotes it again, like splitting a transparent huge page on reclaim.
+
+ Base pages keep their own frames: the simulator models the TLB reach of a
+ huge mapping, not the physical contiguity, so translations are the same as
+ without huge pages. Dirty bits of a promoted region live in the copies of
+ its huge-page TLB entry, as they do in base TLB entries, and reach the frame
+ table when the entry is evicted or the region demoted. Demotion comes before
+ the write-back of the evicted page, just as a base page's write-back checks
+ its TLB entry, so no write held in either TLB is lost.
+ */
+struct HugeRegion {
+    int resident;        // base pages of the region in memory
+    int misses;          // base TLB misses since the region became fully resident
+    int promoted;
+};
+
+struct HugePages {
+    int pages_per_huge;          // a power of two, 0 when huge pages are off
+    int shift;                   // log2(pages_per_huge)
+    int promote_misses;
+    struct Tlb tlb;              // tagged by region, page >> shift
+    struct PTE * ptes;           // pages_per_huge copies per huge-page TLB entry
+    struct PageMap index;        // region -> regions slot
+    struct HugeRegion * regions;
+    int num_regions;
+    int regions_cap;
+    long num_hits;
+    long num_promotions;
+    long num_demotions;
+};
+
+int huge_init(struct HugePages* huge, int pages_per_huge, int tlb_entries, int promote_misses);
+void huge_free(struct HugePages* huge);
+struct HugeRegion* huge_region(struct HugePages* huge, long page_no);
+void huge_save(const struct HugePages* huge, struct CkptWriter* out);
+int huge_restore(struct HugePages* huge, struct CkptReader* in);
+
+/**
+ Returns the PTE copy of page_no in the huge-page TLB, or NULL if its region
+ has no entry there.
+ */
+static inline struct PTE* huge_find(struct HugePages* huge, long page_no) {
+    int index = tlb_find_entry(&huge->tlb, page_no >> huge->shift);
+    if (index < 0) {
+        return NULL;
+    }
+    return &huge->ptes[((long) index << huge->shift) + (page_no & (huge->pages_per_huge - 1))];
+}
+
+#endif
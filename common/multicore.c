@@ -0,0 +1,455 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "multicore.h"
+#include "trace.h"
+
+// page table entry: frame << 2 | state
+#define MC_PTE_INVALID 0
+#define MC_PTE_VALID 1
+#define MC_PTE_BUSY 2
+#define MC_PTE_STATE 3
+
+#define MC_FRAME_FREE -1
+#define MC_FRAME_CLAIMED -2
+
+#define MC_MAX_IMAGE (1L << 32)
+
+static double mc_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ Sets up the shared page table, frame pool and backing store image and the
+ private TLB of every core. Returns 0 on success; on failure prints the reason
+ and returns -1.
+ */
+int mc_init(struct Multicore* mc, const struct SimConfig* config, struct BackStore* back_store) {
+    memset(mc, 0, sizeof(*mc));
+    mc->config = *config;
+    int page_size = config->page_size;
+    if (config->address_bits < 1 || config->address_bits > 32 || page_size < 1 ||
+        page_size > (1L << config->address_bits)) {
+        fprintf(stderr, "Multi-core simulation needs addresses of up to 32 bits\n");
+        return -1;
+    }
+    mc->num_pages = ((1L << config->address_bits) + page_size - 1) / page_size;
+    mc->num_cores = config->num_cores;
+    mc->batch = config->shootdown_batch;
+    mc->num_frames = config->num_frames;
+    if (mc->num_frames > PTE_MAX_FRAMES) {
+        fprintf(stderr, "%d frames do not fit in a page table entry\n", mc->num_frames);
+        return -1;
+    }
+    if (mc->num_cores < 1 || mc->num_cores > MC_MAX_CORES || mc->batch < 1 ||
+        mc->batch > MC_RING_SIZE || config->core_quantum < 1) {
+        fprintf(stderr, "Invalid multi-core setup: %d cores, shootdown batch %d, quantum %d\n",
+                mc->num_cores, mc->batch, config->core_quantum);
+        return -1;
+    }
+    // every core may hold a batch of spare frames and a batch being reclaimed
+    if (mc->num_frames <= 2 * mc->batch * mc->num_cores) {
+        fprintf(stderr, "%d frames are too few for %d cores reclaiming %d at a time\n",
+                mc->num_frames, mc->num_cores, mc->batch);
+        return -1;
+    }
+    if (config->num_processes != 1 || config->prefetch > 0 || config->write_behind > 0 ||
+        config->zero_copy || config->stats_file || config->huge_pages ||
+        config->compressed_tier || config->checkpoint_file || config->restore_file ||
+        config->sample_rate < 1 || config->sample_check) {
+        fprintf(stderr, "Multi-core simulation supports neither several processes, "
+                "prefetching, write-behind, zero-copy, the statistics export, huge pages, "
+                "the compressed tier, checkpoints nor sampling\n");
+        return -1;
+    }
+
+    mc->image_size = mc->num_pages * page_size;
+    if (mc->image_size < back_store->size) {
+        mc->image_size = back_store->size;
+    }
+    if (mc->image_size > MC_MAX_IMAGE) {
+        fprintf(stderr, "Backing store of %ld bytes is too large\n", mc->image_size);
+        return -1;
+    }
+    mc->page_table = (uint64_t *) calloc(mc->num_pages, sizeof(uint64_t));
+    mc->frames = (struct McFrame *) malloc(mc->num_frames * sizeof(struct McFrame));
+    mc->physical_mem = (char *) malloc((size_t) mc->num_frames * page_size);
+    mc->image = (char *) calloc(mc->image_size, 1);
+    mc->rings = (struct McRing *) calloc(mc->num_cores * mc->num_cores, sizeof(struct McRing));
+    if (!mc->page_table || !mc->frames || !mc->physical_mem || !mc->image || !mc->rings) {
+        fprintf(stderr, "Cannot allocate %d frames of %d bytes\n", mc->num_frames, page_size);
+        mc_free(mc);
+        return -1;
+    }
+    if (back_store->size > 0 && back_store_read(back_store, mc->image, 0, back_store->size)) {
+        fprintf(stderr, "Cannot read from back store\n");
+        mc_free(mc);
+        return -1;
+    }
+    for (int i = 0; i < mc->num_frames; i++) {
+        mc->frames[i].owner = MC_FRAME_FREE;
+        mc->frames[i].referenced = 0;
+        mc->frames[i].dirty = 0;
+    }
+    for (int c = 0; c < mc->num_cores; c++) {
+        struct McCore * core = &mc->cores[c];
+        core->mc = mc;
+        core->id = c;
+        core->spare = (int *) malloc(mc->batch * sizeof(int));
+        if (!core->spare || tlb_init(&core->tlb, config->tlb_sets, config->tlb_ways) ||
+            (config->tlb_lookup && tlb_set_lookup(&core->tlb, config->tlb_lookup))) {
+            fprintf(stderr, "Invalid TLB: %d sets x %d ways, lookup %s\n", config->tlb_sets,
+                    config->tlb_ways, config->tlb_lookup ? config->tlb_lookup : "default");
+            mc_free(mc);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void mc_free(struct Multicore* mc) {
+    for (int c = 0; c < mc->num_cores; c++) {
+        tlb_free(&mc->cores[c].tlb);
+        free(mc->cores[c].spare);
+        mc->cores[c].spare = NULL;
+    }
+    free(mc->page_table);
+    free(mc->frames);
+    free(mc->physical_mem);
+    free(mc->image);
+    free(mc->rings);
+    mc->page_table = NULL;
+    mc->frames = NULL;
+    mc->physical_mem = NULL;
+    mc->image = NULL;
+    mc->rings = NULL;
+}
+
+/**
+ Serves the shootdown requests sent to core: each page leaves its TLB, and
+ moving the ring tail acknowledges it.
+ */
+static void mc_drain(struct McCore* core) {
+    struct Multicore * mc = core->mc;
+    // cleared first, so a request posted during the drain sets it again
+    __atomic_store_n(&core->mail, 0, __ATOMIC_SEQ_CST);
+    for (int s = 0; s < mc->num_cores; s++) {
+        if (s == core->id) {
+            continue;
+        }
+        struct McRing * ring = &mc->rings[s * mc->num_cores + core->id];
+        unsigned long head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        unsigned long tail = ring->tail;
+        if (tail == head) {
+            continue;
+        }
+        for (; tail < head; tail++) {
+            tlb_remove_entry(&core->tlb, ring->pages[tail % MC_RING_SIZE]);
+            core->num_invalidations++;
+        }
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ Serves pending requests while waiting for something another core does.
+ */
+static inline void mc_relax(struct McCore* core) {
+    if (__atomic_load_n(&core->mail, __ATOMIC_ACQUIRE)) {
+        mc_drain(core);
+    }
+    sched_yield();
+}
+
+/**
+ Removes pages from every TLB: this core's at once, the others' through their
+ rings. Returns once every core still running has acknowledged all of them.
+ */
+static void mc_shootdown(struct McCore* core, const long* pages, int num_pages) {
+    struct Multicore * mc = core->mc;
+    for (int i = 0; i < num_pages; i++) {
+        tlb_remove_entry(&core->tlb, pages[i]);
+    }
+    if (mc->num_cores == 1) {
+        return;
+    }
+    double start = mc_now();
+    unsigned long targets[MC_MAX_CORES];
+    core->num_shootdowns++;
+    for (int c = 0; c < mc->num_cores; c++) {
+        struct McCore * other = &mc->cores[c];
+        if (c == core->id || __atomic_load_n(&other->done, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        struct McRing * ring = &mc->rings[core->id * mc->num_cores + c];
+        unsigned long head = ring->head;
+        for (int i = 0; i < num_pages; i++) {
+            while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == MC_RING_SIZE &&
+                   !__atomic_load_n(&other->done, __ATOMIC_ACQUIRE)) {
+                mc_relax(core);
+            }
+            ring->pages[head % MC_RING_SIZE] = pages[i];
+            __atomic_store_n(&ring->head, ++head, __ATOMIC_RELEASE);
+        }
+        __atomic_store_n(&other->mail, 1, __ATOMIC_SEQ_CST);
+        core->num_ipis++;
+    }
+    for (int c = 0; c < mc->num_cores; c++) {
+        struct McCore * other = &mc->cores[c];
+        if (c == core->id) {
+            continue;
+        }
+        struct McRing * ring = &mc->rings[core->id * mc->num_cores + c];
+        targets[c] = ring->head;
+        while (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) < targets[c] &&
+               !__atomic_load_n(&other->done, __ATOMIC_ACQUIRE)) {
+            mc_relax(core);
+        }
+    }
+    core->wait_seconds += mc_now() - start;
+}
+
+/**
+ Sweeps the CLOCK hand to an unreferenced resident frame and claims it. The
+ page it holds is marked busy, so no core can fault it back in before it has
+ been written back. Returns the frame and sets *page to its page.
+ */
+static int mc_clock(struct McCore* core, long* page) {
+    struct Multicore * mc = core->mc;
+    for (;;) {
+        int h = __atomic_fetch_add(&mc->hand, 1, __ATOMIC_RELAXED) % mc->num_frames;
+        struct McFrame * frame = &mc->frames[h];
+        long owner = __atomic_load_n(&frame->owner, __ATOMIC_ACQUIRE);
+        if (owner < 0) {
+            // free, or being loaded or evicted by another core
+            continue;
+        }
+        if (__atomic_load_n(&frame->referenced, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&frame->referenced, 0, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (__atomic_compare_exchange_n(&frame->owner, &owner, MC_FRAME_CLAIMED, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            // a resident page's entry is valid, and only the frame's claimant changes it
+            __atomic_store_n(&mc->page_table[owner], MC_PTE_BUSY, __ATOMIC_RELEASE);
+            *page = owner;
+            return h;
+        }
+        if (__atomic_load_n(&core->mail, __ATOMIC_ACQUIRE)) {
+            mc_drain(core);
+        }
+    }
+}
+
+/**
+ Returns a frame for a page-in: a spare one, a never used one, or the first
+ of a batch of victims that are shot down together.
+ */
+static int mc_take_frame(struct McCore* core) {
+    struct Multicore * mc = core->mc;
+    if (core->num_spare > 0) {
+        return core->spare[--core->num_spare];
+    }
+    if (__atomic_load_n(&mc->next_free, __ATOMIC_RELAXED) < mc->num_frames) {
+        int frame_no = __atomic_fetch_add(&mc->next_free, 1, __ATOMIC_RELAXED);
+        if (frame_no < mc->num_frames) {
+            return frame_no;
+        }
+    }
+
+    int victims[MC_RING_SIZE];
+    long pages[MC_RING_SIZE];
+    for (int i = 0; i < mc->batch; i++) {
+        victims[i] = mc_clock(core, &pages[i]);
+    }
+    mc_shootdown(core, pages, mc->batch);
+    // no TLB maps the victims any more: nobody writes to them behind our back
+    int page_size = mc->config.page_size;
+    for (int i = 0; i < mc->batch; i++) {
+        struct McFrame * frame = &mc->frames[victims[i]];
+        if (__atomic_load_n(&frame->dirty, __ATOMIC_ACQUIRE)) {
+            memcpy(mc->image + pages[i] * page_size,
+                   mc->physical_mem + (size_t) victims[i] * page_size, page_size);
+            frame->dirty = 0;
+        }
+        __atomic_store_n(&mc->page_table[pages[i]], MC_PTE_INVALID, __ATOMIC_RELEASE);
+    }
+    for (int i = mc->batch - 1; i > 0; i--) {
+        core->spare[core->num_spare++] = victims[i];
+    }
+    return victims[0];
+}
+
+/**
+ Walks the shared page table for page, faulting it in if no core has, and
+ caches the translation in the core's TLB. Returns the frame.
+ */
+static int mc_translate(struct McCore* core, long page) {
+    struct Multicore * mc = core->mc;
+    uint64_t * pte = &mc->page_table[page];
+    int frame_no;
+    for (;;) {
+        uint64_t word = __atomic_load_n(pte, __ATOMIC_ACQUIRE);
+        if ((word & MC_PTE_STATE) == MC_PTE_VALID) {
+            frame_no = (int) (word >> 2);
+            break;
+        }
+        if ((word & MC_PTE_STATE) == MC_PTE_INVALID &&
+            __atomic_compare_exchange_n(pte, &word, MC_PTE_BUSY, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            core->num_faults++;
+            frame_no = mc_take_frame(core);
+            int page_size = mc->config.page_size;
+            memcpy(mc->physical_mem + (size_t) frame_no * page_size,
+                   mc->image + page * page_size, page_size);
+            struct McFrame * frame = &mc->frames[frame_no];
+            frame->dirty = 0;
+            frame->referenced = 1;
+            __atomic_store_n(pte, (uint64_t) frame_no << 2 | MC_PTE_VALID, __ATOMIC_RELEASE);
+            // only now may the CLOCK hand pick the frame
+            __atomic_store_n(&frame->owner, page, __ATOMIC_RELEASE);
+            break;
+        }
+        // another core is loading or evicting the page
+        mc_relax(core);
+    }
+    struct PTE entry = { frame_no, 1, 0, 1, PTE_PROT_READ | PTE_PROT_WRITE };
+    struct TLBE evicted;
+    tlb_add_entry(&core->tlb, page, entry, &evicted);
+    return frame_no;
+}
+
+static inline void mc_access(struct McCore* core, uint64_t record) {
+    struct Multicore * mc = core->mc;
+    if (__atomic_load_n(&core->mail, __ATOMIC_ACQUIRE)) {
+        mc_drain(core);
+    }
+    const unsigned long page_size = mc->config.page_size;
+    unsigned long logical_addr = trace_address(record) & ((1UL << mc->config.address_bits) - 1);
+    long page = logical_addr / page_size;
+    unsigned long offset = logical_addr % page_size;
+
+    int frame_no;
+    int tlb_index = tlb_find_entry(&core->tlb, page);
+    if (tlb_index >= 0) {
+        core->tlb.num_hits++;
+        frame_no = core->tlb.ptes[tlb_index].frame_no;
+    } else {
+        frame_no = mc_translate(core, page);
+    }
+    struct McFrame * frame = &mc->frames[frame_no];
+    if (!__atomic_load_n(&frame->referenced, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&frame->referenced, 1, __ATOMIC_RELAXED);
+    }
+    if (trace_is_write(record)) {
+        if (!__atomic_load_n(&frame->dirty, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&frame->dirty, 1, __ATOMIC_RELEASE);
+        }
+        __atomic_fetch_add(&mc->physical_mem[(size_t) frame_no * page_size + offset], 1,
+                           __ATOMIC_RELAXED);
+    }
+    core->num_entries++;
+}
+
+static void* mc_core_main(void* arg) {
+    struct McCore * core = (struct McCore *) arg;
+    struct Multicore * mc = core->mc;
+    size_t quantum = mc->config.core_quantum;
+    size_t stride = quantum * mc->num_cores;
+    for (size_t start = core->id * quantum; start < mc->num_records; start += stride) {
+        size_t end = start + quantum < mc->num_records ? start + quantum : mc->num_records;
+        for (size_t r = start; r < end; r++) {
+            mc_access(core, mc->records[r]);
+        }
+    }
+    __atomic_store_n(&core->done, 1, __ATOMIC_SEQ_CST);
+    return NULL;
+}
+
+/**
+ Translates the trace on one thread per core. Returns 0 on success, -1 if the
+ threads could not be started.
+ */
+int mc_run(struct Multicore* mc, const uint64_t* records, size_t num_records) {
+    pthread_t threads[MC_MAX_CORES];
+    mc->records = records;
+    mc->num_records = num_records;
+    double start = mc_now();
+    int started = 0;
+    for (; started < mc->num_cores; started++) {
+        if (pthread_create(&threads[started], NULL, mc_core_main, &mc->cores[started])) {
+            break;
+        }
+    }
+    // cores that never started would never acknowledge a shootdown
+    for (int c = started; c < mc->num_cores; c++) {
+        __atomic_store_n(&mc->cores[c].done, 1, __ATOMIC_SEQ_CST);
+    }
+    for (int c = 0; c < started; c++) {
+        pthread_join(threads[c], NULL);
+    }
+    mc->seconds = mc_now() - start;
+    return started == mc->num_cores ? 0 : -1;
+}
+
+/**
+ Writes the dirty resident pages into the image and the image back to the
+ store. Returns 0 on success.
+ */
+int mc_write_back(struct Multicore* mc, struct BackStore* back_store) {
+    int page_size = mc->config.page_size;
+    for (int i = 0; i < mc->num_frames; i++) {
+        struct McFrame * frame = &mc->frames[i];
+        if (frame->owner >= 0 && frame->dirty) {
+            memcpy(mc->image + frame->owner * page_size,
+                   mc->physical_mem + (size_t) i * page_size, page_size);
+        }
+    }
+    if (back_store->size == 0) {
+        return 0;
+    }
+    return back_store_write(back_store, mc->image, 0, back_store->size);
+}
+
+void mc_print_stats(const struct Multicore* mc, FILE* out) {
+    long num_entries = 0, num_faults = 0, num_hits = 0;
+    long num_shootdowns = 0, num_ipis = 0, num_invalidations = 0;
+    double wait_seconds = 0;
+    for (int c = 0; c < mc->num_cores; c++) {
+        const struct McCore * core = &mc->cores[c];
+        num_entries += core->num_entries;
+        num_faults += core->num_faults;
+        num_hits += core->tlb.num_hits;
+        num_shootdowns += core->num_shootdowns;
+        num_ipis += core->num_ipis;
+        num_invalidations += core->num_invalidations;
+        wait_seconds += core->wait_seconds;
+    }
+    int num_dirty = 0;
+    for (int i = 0; i < mc->num_frames; i++) {
+        num_dirty += mc->frames[i].owner >= 0 && mc->frames[i].dirty;
+    }
+    double n = num_entries > 0 ? (double) num_entries : 1.0;
+    fprintf(out, "Page-fault rate: %f\n", num_faults / n);
+    fprintf(out, "TLB hit rate: %f\n", num_hits / n);
+    fprintf(out, "Number of dirty pages: %d\n", num_dirty);
+    for (int c = 0; c < mc->num_cores; c++) {
+        const struct McCore * core = &mc->cores[c];
+        double m = core->num_entries > 0 ? (double) core->num_entries : 1.0;
+        fprintf(out, "Core %d: %ld accesses, page-fault rate %f, TLB hit rate %f, "
+                "%ld shootdowns sent, %ld invalidations received\n", c, core->num_entries,
+                core->num_faults / m, core->tlb.num_hits / m, core->num_shootdowns,
+                core->num_invalidations);
+    }
+    fprintf(out, "TLB shootdowns: %ld\n", num_shootdowns);
+    fprintf(out, "Shootdown IPIs: %ld\n", num_ipis);
+    fprintf(out, "Invalidations per IPI: %f\n",
+            num_ipis ? num_invalidations / (double) num_ipis : 0.0);
+    fprintf(out, "Shootdown wait: %f ms\n", wait_seconds * 1e3);
+    fprintf(out, "Simulation throughput: %.1f M accesses/s\n", num_entries / mc->seconds / 1e6);
+}
@@ -0,0 +1,91 @@
+#ifndef MULTICORE_H
+#define MULTICORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "back_store.h"
+#include "simulator.h"
+#include "tlb.h"
+
+#define MC_MAX_CORES 64
+#define MC_RING_SIZE 256  // shootdown requests in flight from one core to another
+
+/**
+ Multi-core simulation. Each simulated core is a thread with a private TLB;
+ all cores share one flat page table and one frame pool of the configured
+ geometry, and translate the records dealt to them in quanta of
+ config->core_quantum, round-robin.
+
+ Nothing shared is locked. A page table entry is one word holding the frame
+ and a state (invalid, valid, or busy while a core faults the page in or
+ evicts it) and changes by compare-and-swap; frames are claimed the same way,
+ and replacement is CLOCK with an atomic hand, the one policy that needs no
+ ordered lists.
+
+ Evicting a page sends a TLB shootdown to every other running core through a
+ single-producer ring per pair of cores, and waits until each has removed the
+ page from its TLB; cores check for requests before every access. With a
+ shootdown batch of B, a core that needs a frame reclaims B at once and
+ invalidates them with one round of requests, keeping the spare frames for
+ its next faults.
+
+ Interleaving between cores depends on the host scheduler, so only
+ statistics are printed.
+ */
+struct McRing {
+    long pages[MC_RING_SIZE];
+    unsigned long head;  // written by the sender
+    unsigned long tail;  // written by the receiver, acknowledges requests
+};
+
+struct McCore {
+    struct Multicore * mc;
+    int id;
+    struct Tlb tlb;
+    int mail;            // set when a ring to this core has requests
+    int done;            // no more translations: shootdowns need not wait
+    int * spare;         // reclaimed frames not yet used
+    int num_spare;
+    long num_entries;
+    long num_faults;
+    long num_shootdowns;     // rounds of requests sent
+    long num_ipis;           // cores interrupted by them
+    long num_invalidations;  // requests received
+    double wait_seconds;     // spent waiting for acknowledgements
+};
+
+struct McFrame {
+    long owner;          // page, MC_FRAME_FREE or MC_FRAME_CLAIMED
+    char referenced;
+    char dirty;
+};
+
+struct Multicore {
+    struct SimConfig config;
+    long num_pages;
+    int num_frames;
+    int num_cores;
+    int batch;
+    uint64_t * page_table;
+    struct McFrame * frames;
+    char * physical_mem;
+    char * image;        // the backing store, extended with zeros to the whole address space
+    long image_size;
+    int next_free;       // frames [next_free, num_frames) were never used
+    unsigned long hand;  // CLOCK hand, taken modulo num_frames
+    struct McCore cores[MC_MAX_CORES];
+    struct McRing * rings;  // ring from core s to core r is rings[s * num_cores + r]
+    const uint64_t * records;
+    size_t num_records;
+    double seconds;
+};
+
+int mc_init(struct Multicore* mc, const struct SimConfig* config, struct BackStore* back_store);
+void mc_free(struct Multicore* mc);
+int mc_run(struct Multicore* mc, const uint64_t* records, size_t num_records);
+int mc_write_back(struct Multicore* mc, struct BackStore* back_store);
+void mc_print_stats(const struct Multicore* mc, FILE* out);
+
+#endif
@@ -0,0 +1,379 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "options.h"
+
+static void usage(const char* prog, const struct SimConfig* config, int allow_replacement) {
+    fprintf(stderr,
+            "Usage: %s [options] [addresses] [backing store]\n"
+            "  -a, --address-bits N  width of logical addresses, up to 48 (default %d)\n"
+            "  -p, --page-size N     page size in bytes (default %d)\n"
+            "  -s, --tlb-sets N      number of TLB sets, a power of two (default %d)\n"
+            "  -w, --tlb-ways N      entries per TLB set (default %d)\n"
+            "  -k, --tlb-lookup NAME TLB lookup: avx2, sse2 or scalar tag scan, or hash\n"
+            "                        index (default: fastest available)\n"
+            "  -l, --levels A,B,...  page number bits of each page table level, root first\n"
+            "                        (default: one level up to 16 bits, else about 10 per level)\n"
+            "  -c, --psc-entries N   paging-structure cache entries per level, a power of two\n"
+            "                        (default %d, none)\n"
+            "  -S, --back-store NAME backing store backend: %s (default %s)\n"
+            "  -z, --zero-copy       frames alias the mmap'd backing store instead of copies\n"
+            "                        (implies --back-store mmap)\n"
+            "  -o, --output MODE     per-access output: text, binary or summary (statistics\n"
+            "                        only) (default text)\n"
+            "  -n, --sample N        write only every Nth access (default %ld, all)\n"
+            "  -N, --processes N     address spaces; trace records carry the process ID\n"
+            "                        (default %d)\n"
+            "  -x, --stats FILE      write counters, reuse distances, per-page statistics\n"
+            "                        and snapshots to FILE (builds with make STATS=1)\n"
+            "  -X, --stats-format F  statistics format: csv or json (default csv)\n"
+            "  -i, --stats-interval N\n"
+            "                        accesses between statistics snapshots (default %ld,\n"
+            "                        none)\n"
+            "  -H, --huge-pages N    promote dense, hot regions of N base pages, a power of\n"
+            "                        two, to huge pages (default: none)\n"
+            "  -G, --huge-tlb N      entries of the huge-page TLB (default %d)\n"
+            "  -M, --promote-misses N\n"
+            "                        TLB misses of a fully resident region before it is\n"
+            "                        promoted (default %d)\n"
+            "  -K, --checkpoint FILE write the whole simulator state to FILE on SIGUSR1 and\n"
+            "                        every --checkpoint-every accesses\n"
+            "  -E, --checkpoint-every N\n"
+            "                        accesses between checkpoints (default %ld, on SIGUSR1\n"
+            "                        only)\n"
+            "  -U, --restore FILE    resume from checkpoint FILE, skipping the part of the\n"
+            "                        trace it covers; the replacement policy may differ\n"
+            "  -e, --sample-rate R   simulate only the share R of the pages, picked by hash,\n"
+            "                        against a memory and TLB R times the size, and print\n"
+            "                        the estimated statistics (default 1, every page)\n"
+            "  -A, --sample-check    also simulate every page and report the error of the\n"
+            "                        sampled estimates\n"
+            "  -u, --no-page-runs    look every access up in the TLB, also one to the page\n"
+            "                        of the access before (default: such runs skip the TLB)\n",
+            prog, config->address_bits, config->page_size, config->tlb_sets, config->tlb_ways,
+            config->psc_entries, back_store_names(), config->back_store, config->sample_every,
+            config->num_processes, config->stats_interval, config->huge_tlb_entries,
+            config->promote_misses, config->checkpoint_every);
+    if (allow_replacement) {
+        fprintf(stderr,
+                "  -f, --frames N        number of physical frames (default %d)\n"
+                "  -r, --policy NAME     page replacement policy: %s (default %s)\n"
+                "  -b, --write-behind N  queue N dirty pages and write them back together\n"
+                "                        (default %d, write at once)\n"
+                "  -m, --mrc             print LRU page-fault and TLB hit rate curves over\n"
+                "                        all memory and TLB sizes instead of simulating\n"
+                "  -P, --prefetch N      on a sequential or strided fault, prefetch the next N\n"
+                "                        pages of the stream (default %d, none)\n"
+                "  -T, --prefetch-streams N\n"
+                "                        fault streams the prefetcher tracks (default %d)\n"
+                "  -L, --local           each process replaces pages only among its equal share\n"
+                "                        of the frames (default: global replacement)\n"
+                "  -C, --cores N         simulate N cores with private TLBs sharing the page\n"
+                "                        table, with TLB shootdowns; statistics only, CLOCK\n"
+                "                        replacement (default: single core)\n"
+                "  -B, --shootdown-batch N\n"
+                "                        victims reclaimed per shootdown (default %d)\n"
+                "  -Q, --quantum N       consecutive accesses dealt to one core (default %d)\n"
+                "  -W, --working-set TAU size resident sets by the working set of each process\n"
+                "                        over its last TAU accesses\n"
+                "  -F, --pff LOW,HIGH    size resident sets by page-fault frequency, shrinking\n"
+                "                        below LOW and growing above HIGH faults per access\n"
+                "  -I, --rs-interval N   accesses between resident-set samples (default %ld)\n"
+                "  -R, --rs-series FILE  write resident-set sizes and fault rates over time to\n"
+                "                        FILE as CSV\n"
+                "  -Z, --compressed-tier BYTES\n"
+                "                        keep evicted pages compressed in memory, up to BYTES\n"
+                "                        of compressed data, before the backing store\n",
+                config->num_frames, policy_names(), config->policy, config->write_behind,
+                config->prefetch, config->prefetch_streams, config->shootdown_batch,
+                config->core_quantum, config->rs_interval);
+    }
+    exit(-1);
+}
+
+/**
+ Parses a comma separated list of level widths into config. Returns 0 on
+ success, -1 if there are too many levels or an entry is not a number.
+ */
+static int parse_levels(const char* arg, struct SimConfig* config) {
+    config->num_levels = 0;
+    while (*arg) {
+        char * end;
+        long bits = strtol(arg, &end, 10);
+        if (end == arg || bits < 1 || config->num_levels == PAGE_TABLE_MAX_LEVELS ||
+            (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+        config->level_bits[config->num_levels++] = (int) bits;
+        arg = *end == ',' ? end + 1 : end;
+    }
+    return config->num_levels > 0 ? 0 : -1;
+}
+
+/**
+ Parses the command line shared by both simulators. Options update config;
+ up to two positional arguments replace the trace and backing store names.
+ Part 1 never replaces pages, so it passes allow_replacement = 0 and the frame
+ count, policy, write-behind, miss-ratio curve, prefetch, local replacement,
+ multi-core, resident-set and compressed tier options are rejected.
+ */
+void parse_options(int argc, char** argv, struct SimConfig* config,
+                   const char** addresses_fname, const char** back_store_fname,
+                   int allow_replacement) {
+    static const struct option long_options[] = {
+        {"address-bits", required_argument, NULL, 'a'},
+        {"page-size", required_argument, NULL, 'p'},
+        {"tlb-sets", required_argument, NULL, 's'},
+        {"tlb-ways", required_argument, NULL, 'w'},
+        {"tlb-lookup", required_argument, NULL, 'k'},
+        {"levels", required_argument, NULL, 'l'},
+        {"psc-entries", required_argument, NULL, 'c'},
+        {"back-store", required_argument, NULL, 'S'},
+        {"zero-copy", no_argument, NULL, 'z'},
+        {"output", required_argument, NULL, 'o'},
+        {"sample", required_argument, NULL, 'n'},
+        {"processes", required_argument, NULL, 'N'},
+        {"stats", required_argument, NULL, 'x'},
+        {"stats-format", required_argument, NULL, 'X'},
+        {"stats-interval", required_argument, NULL, 'i'},
+        {"huge-pages", required_argument, NULL, 'H'},
+        {"huge-tlb", required_argument, NULL, 'G'},
+        {"promote-misses", required_argument, NULL, 'M'},
+        {"checkpoint", required_argument, NULL, 'K'},
+        {"checkpoint-every", required_argument, NULL, 'E'},
+        {"restore", required_argument, NULL, 'U'},
+        {"sample-rate", required_argument, NULL, 'e'},
+        {"sample-check", no_argument, NULL, 'A'},
+        {"no-page-runs", no_argument, NULL, 'u'},
+        {"frames", required_argument, NULL, 'f'},
+        {"policy", required_argument, NULL, 'r'},
+        {"mrc", no_argument, NULL, 'm'},
+        {"write-behind", required_argument, NULL, 'b'},
+        {"prefetch", required_argument, NULL, 'P'},
+        {"prefetch-streams", required_argument, NULL, 'T'},
+        {"local", no_argument, NULL, 'L'},
+        {"cores", required_argument, NULL, 'C'},
+        {"shootdown-batch", required_argument, NULL, 'B'},
+        {"quantum", required_argument, NULL, 'Q'},
+        {"working-set", required_argument, NULL, 'W'},
+        {"pff", required_argument, NULL, 'F'},
+        {"rs-interval", required_argument, NULL, 'I'},
+        {"rs-series", required_argument, NULL, 'R'},
+        {"compressed-tier", required_argument, NULL, 'Z'},
+        {NULL, 0, NULL, 0}
+    };
+    struct SimConfig defaults = *config;
+    int opt;
+    while ((opt = getopt_long(argc, argv,
+                              "a:p:s:w:k:l:c:S:zo:n:N:x:X:i:H:G:M:K:E:U:e:Au"
+                              "f:r:mb:P:T:LC:B:Q:W:F:I:R:Z:",
+                              long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'a':
+                config->address_bits = atoi(optarg);
+                break;
+            case 'p':
+                config->page_size = atoi(optarg);
+                break;
+            case 's':
+                config->tlb_sets = atoi(optarg);
+                break;
+            case 'w':
+                config->tlb_ways = atoi(optarg);
+                break;
+            case 'k':
+                config->tlb_lookup = optarg;
+                break;
+            case 'l':
+                if (parse_levels(optarg, config)) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'c':
+                config->psc_entries = atoi(optarg);
+                break;
+            case 'S':
+                config->back_store = optarg;
+                break;
+            case 'z':
+                // aliasing needs a mapping
+                config->zero_copy = 1;
+                config->back_store = "mmap";
+                break;
+            case 'o':
+                if (strcmp(optarg, "summary") == 0) {
+                    config->quiet = 1;
+                } else if ((config->output_format = output_parse_format(optarg)) < 0) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'n':
+                config->sample_every = atol(optarg);
+                if (config->sample_every < 1) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'N':
+                config->num_processes = atoi(optarg);
+                break;
+            case 'x':
+                config->stats_file = optarg;
+                break;
+            case 'X':
+                if ((config->stats_format = stats_parse_format(optarg)) < 0) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'i':
+                config->stats_interval = atol(optarg);
+                if (config->stats_interval < 0) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'H':
+                config->huge_pages = atoi(optarg);
+                break;
+            case 'G':
+                config->huge_tlb_entries = atoi(optarg);
+                break;
+            case 'M':
+                config->promote_misses = atoi(optarg);
+                break;
+            case 'K':
+                config->checkpoint_file = optarg;
+                break;
+            case 'E':
+                config->checkpoint_every = atol(optarg);
+                if (config->checkpoint_every < 1) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'U':
+                config->restore_file = optarg;
+                break;
+            case 'e':
+                config->sample_rate = atof(optarg);
+                if (!(config->sample_rate > 0 && config->sample_rate <= 1)) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'A':
+                config->sample_check = 1;
+                break;
+            case 'u':
+                config->page_runs = 0;
+                break;
+            case 'f':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->num_frames = atoi(optarg);
+                if (config->num_frames < 1) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'r':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->policy = optarg;
+                break;
+            case 'b':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->write_behind = atoi(optarg);
+                break;
+            case 'm':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->mrc = 1;
+                break;
+            case 'P':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->prefetch = atoi(optarg);
+                break;
+            case 'T':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->prefetch_streams = atoi(optarg);
+                break;
+            case 'L':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->local_replacement = 1;
+                break;
+            case 'C':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->num_cores = atoi(optarg);
+                if (config->num_cores < 1) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'B':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->shootdown_batch = atoi(optarg);
+                break;
+            case 'Q':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->core_quantum = atoi(optarg);
+                break;
+            case 'W':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->working_set = atol(optarg);
+                break;
+            case 'F':
+                if (!allow_replacement ||
+                    sscanf(optarg, "%lf,%lf", &config->pff_lower, &config->pff_upper) != 2) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            case 'I':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->rs_interval = atol(optarg);
+                break;
+            case 'R':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->rs_series = optarg;
+                break;
+            case 'Z':
+                if (!allow_replacement) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                config->compressed_tier = atol(optarg);
+                if (config->compressed_tier < 1) {
+                    usage(argv[0], &defaults, allow_replacement);
+                }
+                break;
+            default:
+                usage(argv[0], &defaults, allow_replacement);
+        }
+    }
+
+    //set filename
+    if(optind < argc) {
+        *addresses_fname = argv[optind];
+    }
+    if(optind + 1 < argc) {
+        *back_store_fname = argv[optind + 1];
+    }
+}
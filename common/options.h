@@ -0,0 +1,10 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include "simulator.h"
+
+void parse_options(int argc, char** argv, struct SimConfig* config,
+                   const char** addresses_fname, const char** back_store_fname,
+                   int allow_replacement);
+
+#endif
@@ -0,0 +1,64 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "output.h"
+
+/**
+ Sets up a writer to fd. Returns 0 on success, -1 on a bad format or sample
+ interval or if memory runs out.
+ */
+int output_init(struct OutputWriter* writer, int fd, int format, long sample_every) {
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = fd;
+    if ((format != OUTPUT_TEXT && format != OUTPUT_BINARY) || sample_every < 1) {
+        return -1;
+    }
+    writer->format = format;
+    writer->sample_every = sample_every;
+    writer->countdown = 1;
+    writer->buffer = (char *) malloc(OUTPUT_BUFFER_SIZE);
+    return writer->buffer ? 0 : -1;
+}
+
+void output_free(struct OutputWriter* writer) {
+    if (writer->buffer) {
+        output_flush(writer);
+    }
+    free(writer->buffer);
+    writer->buffer = NULL;
+}
+
+/**
+ Writes out everything buffered so far.
+ */
+void output_flush(struct OutputWriter* writer) {
+    size_t done = 0;
+    while (done < writer->len) {
+        ssize_t n = write(writer->fd, writer->buffer + done, writer->len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            fprintf(stderr, "Cannot write output: %s\n", strerror(errno));
+            exit(-1);
+        }
+        done += n;
+    }
+    writer->len = 0;
+}
+
+/**
+ Returns the OUTPUT_* format called name ("text" or "binary"), or -1.
+ */
+int output_parse_format(const char* name) {
+    if (strcmp(name, "text") == 0) {
+        return OUTPUT_TEXT;
+    }
+    if (strcmp(name, "binary") == 0) {
+        return OUTPUT_BINARY;
+    }
+    return -1;
+}
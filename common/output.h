@@ -0,0 +1,116 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ Buffered writer for the per-access output. Lines are formatted by hand into
+ a large block that goes to the file descriptor with a single write when it
+ fills up, instead of one printf (and one stdout lock) per access.
+
+ Formats:
+ OUTPUT_TEXT     "0x%04lX 0x%04lX %d %d\n": logical address, physical address,
+                 the byte at that address and the dirty bit, as in out.txt
+ OUTPUT_BINARY   16 byte little-endian records: bits 0-47 of the first word
+                 hold the logical address, bits 48-55 the byte and bit 63 the
+                 dirty bit; the second word is the physical address
+
+ With sample_every = N only every Nth access is written, starting with the
+ first.
+ */
+#define OUTPUT_TEXT 0
+#define OUTPUT_BINARY 1
+
+#define OUTPUT_BUFFER_SIZE (1 << 18)
+#define OUTPUT_MAX_RECORD 48  // longest text line: two 16 digit addresses
+
+#define OUTPUT_DIRTY_FLAG (UINT64_C(1) << 63)
+
+struct OutputWriter {
+    int fd;
+    int format;
+    long sample_every;
+    long countdown;    // accesses until the next one that is written
+    char * buffer;
+    size_t len;
+    long num_written;
+};
+
+int output_init(struct OutputWriter* writer, int fd, int format, long sample_every);
+void output_free(struct OutputWriter* writer);
+void output_flush(struct OutputWriter* writer);
+int output_parse_format(const char* name);
+
+/**
+ Writes value as 0x followed by at least four upper case hex digits.
+ Returns the number of characters written.
+ */
+static inline int output_hex(char* out, unsigned long value) {
+    static const char digits[] = "0123456789ABCDEF";
+    int bits = 64 - __builtin_clzl(value | 1);
+    int n = bits > 16 ? (bits + 3) / 4 : 4;
+    out[0] = '0';
+    out[1] = 'x';
+    for (int i = n + 1; i >= 2; i--) {
+        out[i] = digits[value & 15];
+        value >>= 4;
+    }
+    return n + 2;
+}
+
+/**
+ Writes a byte value in decimal. Returns the number of characters written.
+ */
+static inline int output_byte(char* out, int value) {
+    int n = 0;
+    if (value < 0) {
+        out[n++] = '-';
+        value = -value;
+    }
+    if (value >= 100) {
+        out[n++] = '0' + value / 100;
+    }
+    if (value >= 10) {
+        out[n++] = '0' + value / 10 % 10;
+    }
+    out[n++] = '0' + value % 10;
+    return n;
+}
+
+/**
+ Records one translation.
+ */
+static inline void output_access(struct OutputWriter* writer, unsigned long logical_addr,
+                                 unsigned long physical_addr, int value, int dirty) {
+    if (--writer->countdown > 0) {
+        return;
+    }
+    writer->countdown = writer->sample_every;
+    if (OUTPUT_BUFFER_SIZE - writer->len < OUTPUT_MAX_RECORD) {
+        output_flush(writer);
+    }
+    char * out = writer->buffer + writer->len;
+    if (writer->format == OUTPUT_BINARY) {
+        uint64_t record[2];
+        record[0] = (logical_addr & ((UINT64_C(1) << 48) - 1)) |
+                    ((uint64_t) (uint8_t) value << 48) | (dirty ? OUTPUT_DIRTY_FLAG : 0);
+        record[1] = physical_addr;
+        memcpy(out, record, sizeof(record));
+        writer->len += sizeof(record);
+    } else {
+        char * p = out;
+        p += output_hex(p, logical_addr);
+        *p++ = ' ';
+        p += output_hex(p, physical_addr);
+        *p++ = ' ';
+        p += output_byte(p, value);
+        *p++ = ' ';
+        p += output_byte(p, dirty);
+        *p++ = '\n';
+        writer->len += p - out;
+    }
+    writer->num_written++;
+}
+
+#endif
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "page_map.h"
+
+/**
+ Allocates a map able to hold max_entries keys. The table is kept at most half
+ full so probe sequences stay short. Returns 0 on success.
+ */
+int page_map_init(struct PageMap* map, int max_entries) {
+    int bits = 1;
+    while ((1 << bits) < 2 * max_entries) {
+        bits++;
+    }
+    map->slots = (struct PageMapSlot *) malloc(sizeof(struct PageMapSlot) << bits);
+    if (!map->slots) {
+        return -1;
+    }
+    map->mask = (1ULL << bits) - 1;
+    map->shift = 64 - bits;
+    page_map_clear(map);
+    return 0;
+}
+
+void page_map_free(struct PageMap* map) {
+    free(map->slots);
+    map->slots = NULL;
+}
+
+void page_map_clear(struct PageMap* map) {
+    for (uint64_t i = 0; i <= map->mask; i++) {
+        map->slots[i].value = -1;
+    }
+    map->size = 0;
+}
+
+/**
+ Doubles the table once it is half full, rehashing every entry.
+ */
+static void page_map_grow(struct PageMap* map) {
+    struct PageMap bigger;
+    if (page_map_init(&bigger, (int) (map->mask + 1))) {
+        fprintf(stderr, "Cannot grow page map to %llu slots\n",
+                (unsigned long long) (map->mask + 1) * 2);
+        exit(-1);
+    }
+    for (uint64_t i = 0; i <= map->mask; i++) {
+        if (map->slots[i].value >= 0) {
+            page_map_put(&bigger, map->slots[i].key, map->slots[i].value);
+        }
+    }
+    free(map->slots);
+    *map = bigger;
+}
+
+/**
+ Inserts key or overwrites its value. value must be non-negative. The map
+ grows past the max_entries it was created for if it has to.
+ */
+void page_map_put(struct PageMap* map, uint64_t key, int value) {
+    if (2 * (uint64_t) (map->size + 1) > map->mask + 1) {
+        page_map_grow(map);
+    }
+    uint64_t i = page_map_slot(map, key);
+    while (map->slots[i].value >= 0) {
+        if (map->slots[i].key == key) {
+            map->slots[i].value = value;
+            return;
+        }
+        i = (i + 1) & map->mask;
+    }
+    map->slots[i].key = key;
+    map->slots[i].value = value;
+    map->size++;
+}
+
+/**
+ Removes key if present, shifting the rest of its probe run back so no
+ tombstone is needed.
+ */
+void page_map_remove(struct PageMap* map, uint64_t key) {
+    uint64_t i = page_map_slot(map, key);
+    while (map->slots[i].value >= 0 && map->slots[i].key != key) {
+        i = (i + 1) & map->mask;
+    }
+    if (map->slots[i].value < 0) {
+        return;
+    }
+    map->size--;
+    uint64_t hole = i;
+    for (;;) {
+        i = (i + 1) & map->mask;
+        if (map->slots[i].value < 0) {
+            break;
+        }
+        // an entry may move into the hole only if its home slot is not
+        // between the hole and its current position
+        uint64_t home = page_map_slot(map, map->slots[i].key);
+        if (((i - home) & map->mask) >= ((i - hole) & map->mask)) {
+            map->slots[hole] = map->slots[i];
+            hole = i;
+        }
+    }
+    map->slots[hole].value = -1;
+}
+
+/**
+ Writes the entries of the map to a checkpoint.
+ */
+void page_map_save(const struct PageMap* map, struct CkptWriter* out) {
+    ckpt_write(out, &map->size, sizeof(map->size));
+    for (uint64_t i = 0; i <= map->mask; i++) {
+        if (map->slots[i].value >= 0) {
+            ckpt_write(out, &map->slots[i], sizeof(struct PageMapSlot));
+        }
+    }
+}
+
+/**
+ Replaces the entries of the map with those saved by page_map_save. Returns 0
+ on success, -1 if the checkpoint is cut short.
+ */
+int page_map_restore(struct PageMap* map, struct CkptReader* in) {
+    int size;
+    if (ckpt_read(in, &size, sizeof(size)) || size < 0) {
+        return -1;
+    }
+    page_map_clear(map);
+    for (int i = 0; i < size; i++) {
+        struct PageMapSlot slot;
+        if (ckpt_read(in, &slot, sizeof(slot)) || slot.value < 0) {
+            return -1;
+        }
+        page_map_put(map, slot.key, slot.value);
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef PAGE_MAP_H
+#define PAGE_MAP_H
+
+#include <stdint.h>
+
+#include "checkpoint.h"
+
+/**
+ Open addressing hash map from page numbers to small non-negative integers
+ (TLB slots, frame numbers, ...). Linear probing with backward shift deletion
+ keeps lookups, inserts and removals constant time without tombstones.
+ */
+struct PageMapSlot {
+    uint64_t key;
+    int value; // -1 marks an empty slot
+};
+
+struct PageMap {
+    struct PageMapSlot * slots;
+    uint64_t mask;
+    int shift;
+    int size;
+};
+
+int page_map_init(struct PageMap* map, int max_entries);
+void page_map_free(struct PageMap* map);
+void page_map_clear(struct PageMap* map);
+void page_map_put(struct PageMap* map, uint64_t key, int value);
+void page_map_remove(struct PageMap* map, uint64_t key);
+void page_map_save(const struct PageMap* map, struct CkptWriter* out);
+int page_map_restore(struct PageMap* map, struct CkptReader* in);
+
+static inline uint64_t page_map_slot(const struct PageMap* map, uint64_t key) {
+    return (key * 0x9E3779B97F4A7C15ULL) >> map->shift;
+}
+
+/**
+ Returns the value stored for key, or -1 if key is not in the map.
+ */
+static inline int page_map_get(const struct PageMap* map, uint64_t key) {
+    uint64_t i = page_map_slot(map, key);
+    while (map->slots[i].value >= 0) {
+        if (map->slots[i].key == key) {
+            return map->slots[i].value;
+        }
+        i = (i + 1) & map->mask;
+    }
+    return -1;
+}
+
+#endif
@@ -0,0 +1,281 @@
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "page_table.h"
+
+/**
+ Allocates the node at level, zeroed: children are NULL and PTEs invalid.
+ */
+static void* page_table_new_node(struct PageTable* page_table, int level) {
+    size_t entries = (size_t) 1 << page_table->level_bits[level];
+    size_t entry_size = level == page_table->num_levels - 1 ? sizeof(struct PTE) : sizeof(void *);
+    void * node = calloc(entries, entry_size);
+    if (!node) {
+        fprintf(stderr, "Cannot allocate page table node of %zu entries\n", entries);
+        exit(-1);
+    }
+    page_table->num_nodes++;
+    return node;
+}
+
+/**
+ Sets up an empty table for vpn_bits-wide page numbers. level_bits lists the
+ index width of each level from the root down and must add up to vpn_bits;
+ with num_levels == 0 the split is chosen here: one level up to 16 bits,
+ otherwise levels of about 10 bits (10+10 for 32-bit addresses with 4 KiB
+ pages, 9+9+9+9 for 48-bit). psc_entries (a power of two, 0 for none) sizes
+ the paging-structure cache of each level below the root.
+ Returns 0 on success, -1 on a bad split or allocation failure.
+ */
+int page_table_init(struct PageTable* page_table, int vpn_bits, const int* level_bits,
+                    int num_levels, int psc_entries) {
+    memset(page_table, 0, sizeof(*page_table));
+    page_table->psc_mask = -1;
+    if (num_levels == 0) {
+        num_levels = vpn_bits <= 16 ? 1 : (vpn_bits + 9) / 10;
+        for (int i = 0; i < num_levels; i++) {
+            page_table->level_bits[i] = vpn_bits / num_levels + (i < vpn_bits % num_levels);
+        }
+    } else {
+        if (num_levels > PAGE_TABLE_MAX_LEVELS) {
+            return -1;
+        }
+        memcpy(page_table->level_bits, level_bits, num_levels * sizeof(int));
+    }
+    page_table->num_levels = num_levels;
+    int shift = vpn_bits;
+    for (int i = 0; i < num_levels; i++) {
+        if (page_table->level_bits[i] < 1 || page_table->level_bits[i] > 30) {
+            return -1;
+        }
+        shift -= page_table->level_bits[i];
+        page_table->level_shift[i] = shift;
+    }
+    if (shift != 0 || (psc_entries & (psc_entries - 1))) {
+        return -1;
+    }
+
+    page_table->root = page_table_new_node(page_table, 0);
+    if (psc_entries > 0 && num_levels > 1) {
+        page_table->psc_mask = psc_entries - 1;
+        for (int i = 1; i < num_levels; i++) {
+            page_table->psc[i] = (struct PscEntry *) calloc(psc_entries, sizeof(struct PscEntry));
+            if (!page_table->psc[i]) {
+                page_table_free(page_table);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void page_table_free_node(struct PageTable* page_table, void* node, int level) {
+    if (level < page_table->num_levels - 1) {
+        void ** children = (void **) node;
+        for (size_t i = 0; i < (size_t) 1 << page_table->level_bits[level]; i++) {
+            if (children[i]) {
+                page_table_free_node(page_table, children[i], level + 1);
+            }
+        }
+    }
+    free(node);
+}
+
+void page_table_free(struct PageTable* page_table) {
+    if (page_table->root) {
+        page_table_free_node(page_table, page_table->root, 0);
+    }
+    for (int i = 0; i < PAGE_TABLE_MAX_LEVELS; i++) {
+        free(page_table->psc[i]);
+    }
+    memset(page_table, 0, sizeof(*page_table));
+}
+
+/**
+ Returns the child slot of node (at level) on the path to page_no, allocating
+ the child if it does not exist yet.
+ */
+static void* page_table_child(struct PageTable* page_table, void* node, int level,
+                              unsigned long page_no) {
+    void ** slot = &((void **) node)[(page_no >> page_table->level_shift[level]) &
+                                     ((1UL << page_table->level_bits[level]) - 1)];
+    if (!*slot) {
+        *slot = page_table_new_node(page_table, level + 1);
+    }
+    return *slot;
+}
+
+static struct PTE* page_table_leaf_entry(struct PageTable* page_table, void* leaf,
+                                         unsigned long page_no) {
+    int last = page_table->num_levels - 1;
+    return &((struct PTE *) leaf)[page_no & ((1UL << page_table->level_bits[last]) - 1)];
+}
+
+/**
+ Walks a table of two or more levels. The node of level i is named by the
+ page number bits above that level's index, page_no >> (level_shift[i] +
+ level_bits[i]); that prefix is the paging-structure cache key.
+ */
+struct PTE* page_table_walk_levels(struct PageTable* page_table, unsigned long page_no) {
+    int last = page_table->num_levels - 1;
+    int level = 0;
+    void * node = page_table->root;
+    page_table->num_walks++;
+
+    if (page_table->psc_mask >= 0) {
+        for (int i = last; i > 0; i--) {
+            unsigned long prefix = page_no >> (page_table->level_shift[i] + page_table->level_bits[i]);
+            struct PscEntry * entry = &page_table->psc[i][prefix & page_table->psc_mask];
+            if (entry->node && entry->prefix == prefix) {
+                page_table->psc_hits++;
+                level = i;
+                node = entry->node;
+                break;
+            }
+        }
+    }
+
+    for (; level < last; level++) {
+        page_table->levels_touched++;
+        node = page_table_child(page_table, node, level, page_no);
+        if (page_table->psc_mask >= 0) {
+            unsigned long prefix = page_no >> page_table->level_shift[level];
+            struct PscEntry * entry = &page_table->psc[level + 1][prefix & page_table->psc_mask];
+            entry->prefix = prefix;
+            entry->node = node;
+        }
+    }
+    page_table->levels_touched++;
+    return page_table_leaf_entry(page_table, node, page_no);
+}
+
+/**
+ Finds the PTE of page_no like page_table_walk_levels, allocating the path,
+ but as the OS would: the walk is neither counted nor cached.
+ */
+struct PTE* page_table_get_levels(struct PageTable* page_table, unsigned long page_no) {
+    void * node = page_table->root;
+    for (int level = 0; level < page_table->num_levels - 1; level++) {
+        node = page_table_child(page_table, node, level, page_no);
+    }
+    return page_table_leaf_entry(page_table, node, page_no);
+}
+
+/**
+ Counts the leaves under node (at level), the first page of which is first.
+ With out set, also writes each leaf: its first page number, then its PTEs.
+ */
+static long page_table_for_leaves(const struct PageTable* page_table, void* node, int level,
+                                  unsigned long first, struct CkptWriter* out) {
+    if (level == page_table->num_levels - 1) {
+        if (out) {
+            size_t entries = (size_t) 1 << page_table->level_bits[level];
+            ckpt_write(out, &first, sizeof(first));
+            ckpt_write(out, node, entries * sizeof(struct PTE));
+        }
+        return 1;
+    }
+    long num_leaves = 0;
+    void ** children = (void **) node;
+    for (unsigned long i = 0; i < 1UL << page_table->level_bits[level]; i++) {
+        if (children[i]) {
+            num_leaves += page_table_for_leaves(page_table, children[i], level + 1,
+                                                first | i << page_table->level_shift[level], out);
+        }
+    }
+    return num_leaves;
+}
+
+/**
+ Writes the table to a checkpoint: the counters, every leaf with the page
+ number it starts at, and the prefixes held by the paging-structure cache.
+ Interior nodes are not written, a walk to each leaf rebuilds them.
+ */
+void page_table_save(const struct PageTable* page_table, struct CkptWriter* out) {
+    ckpt_write(out, &page_table->num_levels, sizeof(page_table->num_levels));
+    ckpt_write(out, page_table->level_bits, sizeof(page_table->level_bits));
+    ckpt_write(out, &page_table->psc_mask, sizeof(page_table->psc_mask));
+    ckpt_write(out, &page_table->num_faults, sizeof(page_table->num_faults));
+    ckpt_write(out, &page_table->num_walks, sizeof(page_table->num_walks));
+    ckpt_write(out, &page_table->levels_touched, sizeof(page_table->levels_touched));
+    ckpt_write(out, &page_table->psc_hits, sizeof(page_table->psc_hits));
+    long num_leaves = page_table_for_leaves(page_table, page_table->root, 0, 0, NULL);
+    ckpt_write(out, &num_leaves, sizeof(num_leaves));
+    page_table_for_leaves(page_table, page_table->root, 0, 0, out);
+    for (int i = 1; i < page_table->num_levels && page_table->psc_mask >= 0; i++) {
+        for (int e = 0; e <= page_table->psc_mask; e++) {
+            // a NULL node is saved as the prefix ULONG_MAX, which no page number has
+            unsigned long prefix = page_table->psc[i][e].node ? page_table->psc[i][e].prefix
+                                                               : ULONG_MAX;
+            ckpt_write(out, &prefix, sizeof(prefix));
+        }
+    }
+}
+
+/**
+ Fills an empty table of the same geometry with one saved by page_table_save.
+ Returns 0 on success, -1 if the geometry differs or the checkpoint is
+ corrupt.
+ */
+int page_table_restore(struct PageTable* page_table, struct CkptReader* in) {
+    int num_levels, psc_mask;
+    int level_bits[PAGE_TABLE_MAX_LEVELS];
+    if (ckpt_read(in, &num_levels, sizeof(num_levels)) ||
+        ckpt_read(in, level_bits, sizeof(level_bits)) ||
+        ckpt_read(in, &psc_mask, sizeof(psc_mask)) || num_levels != page_table->num_levels ||
+        memcmp(level_bits, page_table->level_bits, sizeof(level_bits)) ||
+        psc_mask != page_table->psc_mask ||
+        ckpt_read(in, &page_table->num_faults, sizeof(page_table->num_faults)) ||
+        ckpt_read(in, &page_table->num_walks, sizeof(page_table->num_walks)) ||
+        ckpt_read(in, &page_table->levels_touched, sizeof(page_table->levels_touched)) ||
+        ckpt_read(in, &page_table->psc_hits, sizeof(page_table->psc_hits))) {
+        return -1;
+    }
+    int last = num_levels - 1;
+    long num_leaves;
+    if (ckpt_read(in, &num_leaves, sizeof(num_leaves))) {
+        return -1;
+    }
+    unsigned long vpn_mask = (1UL << (page_table->level_shift[0] + page_table->level_bits[0])) - 1;
+    size_t leaf_size = ((size_t) 1 << page_table->level_bits[last]) * sizeof(struct PTE);
+    for (long l = 0; l < num_leaves; l++) {
+        unsigned long first;
+        if (ckpt_read(in, &first, sizeof(first)) || (first & ~vpn_mask)) {
+            return -1;
+        }
+        struct PTE * leaf = num_levels == 1 ? (struct PTE *) page_table->root
+                                            : page_table_get_levels(page_table, first);
+        if (ckpt_read(in, leaf, leaf_size)) {
+            return -1;
+        }
+    }
+    for (int i = 1; i < num_levels && psc_mask >= 0; i++) {
+        for (int e = 0; e <= psc_mask; e++) {
+            unsigned long prefix;
+            if (ckpt_read(in, &prefix, sizeof(prefix))) {
+                return -1;
+            }
+            struct PscEntry * entry = &page_table->psc[i][e];
+            entry->node = NULL;
+            if (prefix == ULONG_MAX) {
+                continue;
+            }
+            // the node of level i is the child taken at level i - 1, which the leaves rebuilt
+            unsigned long page_no = prefix << (page_table->level_shift[i] +
+                                               page_table->level_bits[i]);
+            void * node = page_table->root;
+            for (int level = 0; level < i && node; level++) {
+                node = ((void **) node)[(page_no >> page_table->level_shift[level]) &
+                                        ((1UL << page_table->level_bits[level]) - 1)];
+            }
+            if (!node) {
+                return -1;
+            }
+            entry->prefix = prefix;
+            entry->node = node;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include "checkpoint.h"
+#include "pte.h"
+
+#define PAGE_TABLE_MAX_LEVELS 8
+
+/**
+ Radix page table. The page number is split into num_levels indices, root
+ first; interior nodes are arrays of child pointers and leaves are arrays of
+ PTEs. Nodes are allocated the first time a page under them is walked, so a
+ sparse 48-bit address space only pays for the parts it touches. A single
+ level is a plain flat array.
+
+ A walk reads one node per level. The paging-structure cache remembers, per
+ level, the node reached for recently walked page-number prefixes, so a walk
+ can start below the root; it is direct-mapped and probed deepest level first.
+ */
+struct PscEntry {
+    unsigned long prefix;
+    void * node;   // NULL if the entry is empty
+};
+
+struct PageTable {
+    int num_levels;
+    int level_bits[PAGE_TABLE_MAX_LEVELS];   // index width of each level, root first
+    int level_shift[PAGE_TABLE_MAX_LEVELS];  // page number shift of each level's index
+    void * root;
+    // paging-structure cache, one per level below the root
+    struct PscEntry * psc[PAGE_TABLE_MAX_LEVELS];
+    int psc_mask;                            // entries per level - 1, -1 if there is no cache
+    long num_faults;
+    long num_walks;
+    long levels_touched;   // nodes read by all walks
+    long psc_hits;
+    long num_nodes;
+};
+
+int page_table_init(struct PageTable* page_table, int vpn_bits, const int* level_bits,
+                    int num_levels, int psc_entries);
+void page_table_free(struct PageTable* page_table);
+struct PTE* page_table_walk_levels(struct PageTable* page_table, unsigned long page_no);
+struct PTE* page_table_get_levels(struct PageTable* page_table, unsigned long page_no);
+void page_table_save(const struct PageTable* page_table, struct CkptWriter* out);
+int page_table_restore(struct PageTable* page_table, struct CkptReader* in);
+
+/**
+ Returns the PTE of page_no, allocating the nodes on its path if needed, and
+ counts the walk. The single level case stays inline.
+ */
+static inline struct PTE* page_table_walk(struct PageTable* page_table, unsigned long page_no) {
+    if (page_table->num_levels == 1) {
+        page_table->num_walks++;
+        page_table->levels_touched++;
+        return &((struct PTE *) page_table->root)[page_no];
+    }
+    return page_table_walk_levels(page_table, page_no);
+}
+
+/**
+ Returns the PTE of page_no without counting a hardware walk, for software
+ that updates the table (the prefetcher).
+ */
+static inline struct PTE* page_table_get(struct PageTable* page_table, unsigned long page_no) {
+    if (page_table->num_levels == 1) {
+        return &((struct PTE *) page_table->root)[page_no];
+    }
+    return page_table_get_levels(page_table, page_no);
+}
+
+#endif
@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "policy.h"
+
+/**
+ Shared state of the queue based policies (FIFO, LRU, second-chance): resident
+ frames in a list with the next victim at the head.
+ */
+struct QueueState {
+    int * prev;
+    int * next;
+    char * referenced;
+    struct FrameList list;
+};
+
+static int queue_init(struct ReplacementPolicy* policy) {
+    struct QueueState * state = (struct QueueState *) calloc(1, sizeof(struct QueueState));
+    if (!state) {
+        return -1;
+    }
+    policy->state = state;
+    state->prev = (int *) malloc(policy->num_frames * sizeof(int));
+    state->next = (int *) malloc(policy->num_frames * sizeof(int));
+    state->referenced = (char *) calloc(policy->num_frames, 1);
+    frame_list_init(&state->list);
+    return state->prev && state->next && state->referenced ? 0 : -1;
+}
+
+static void queue_free(struct ReplacementPolicy* policy) {
+    struct QueueState * state = (struct QueueState *) policy->state;
+    if (state) {
+        free(state->prev);
+        free(state->next);
+        free(state->referenced);
+        free(state);
+    }
+}
+
+static void queue_load(struct ReplacementPolicy* policy, int frame_no, long page_no, long now) {
+    struct QueueState * state = (struct QueueState *) policy->state;
+    frame_list_push(&state->list, state->prev, state->next, frame_no);
+    state->referenced[frame_no] = 0;
+}
+
+static void queue_evict(struct ReplacementPolicy* policy, int frame_no) {
+    struct QueueState * state = (struct QueueState *) policy->state;
+    frame_list_unlink(&state->list, state->prev, state->next, frame_no);
+}
+
+static int queue_victim(struct ReplacementPolicy* policy, long page_no) {
+    return ((struct QueueState *) policy->state)->list.head;
+}
+
+static void queue_save(const struct ReplacementPolicy* policy, struct CkptWriter* out) {
+    const struct QueueState * state = (const struct QueueState *) policy->state;
+    ckpt_write(out, &state->list, sizeof(state->list));
+    ckpt_write(out, state->prev, policy->num_frames * sizeof(int));
+    ckpt_write(out, state->next, policy->num_frames * sizeof(int));
+    ckpt_write(out, state->referenced, policy->num_frames);
+}
+
+static int queue_restore(struct ReplacementPolicy* policy, struct CkptReader* in) {
+    struct QueueState * state = (struct QueueState *) policy->state;
+    return ckpt_read(in, &state->list, sizeof(state->list)) ||
+           ckpt_read(in, state->prev, policy->num_frames * sizeof(int)) ||
+           ckpt_read(in, state->next, policy->num_frames * sizeof(int)) ||
+           ckpt_read(in, state->referenced, policy->num_frames) ? -1 : 0;
+}
+
+// FIFO: pages leave in load order, references are ignored
+static void fifo_access(struct ReplacementPolicy* policy, int frame_no, long now) {
+}
+
+static const struct PolicyOps fifo_policy_ops = {
+    "fifo", queue_init, queue_free, queue_load, fifo_access, queue_victim, queue_evict, NULL,
+    queue_save, queue_restore
+};
+
+// LRU: every reference moves the frame to the tail of the queue
+static void lru_access(struct ReplacementPolicy* policy, int frame_no, long now) {
+    struct QueueState * state = (struct QueueState *) policy->state;
+    if (state->list.tail != frame_no) {
+        frame_list_unlink(&state->list, state->prev, state->next, frame_no);
+        frame_list_push(&state->list, state->prev, state->next, frame_no);
+    }
+}
+
+static const struct PolicyOps lru_policy_ops = {
+    "lru", queue_init, queue_free, queue_load, lru_access, queue_victim, queue_evict, NULL,
+    queue_save, queue_restore
+};
+
+/**
+ Second-chance: FIFO, but a referenced page at the head is cleared and
+ requeued. The access that faulted a page in counts as a reference, as in
+ CLOCK, so the two make the same choices in a different layout.
+ */
+static void second_chance_load(struct ReplacementPolicy* policy, int frame_no, long page_no,
+                               long now) {
+    queue_load(policy, frame_no, page_no, now);
+    ((struct QueueState *) policy->state)->referenced[frame_no] = 1;
+}
+
+static void second_chance_access(struct ReplacementPolicy* policy, int frame_no, long now) {
+    ((struct QueueState *) policy->state)->referenced[frame_no] = 1;
+}
+
+static int second_chance_victim(struct ReplacementPolicy* policy, long page_no) {
+    struct QueueState * state = (struct QueueState *) policy->state;
+    int frame_no = state->list.head;
+    while (state->referenced[frame_no]) {
+        state->referenced[frame_no] = 0;
+        frame_list_unlink(&state->list, state->prev, state->next, frame_no);
+        frame_list_push(&state->list, state->prev, state->next, frame_no);
+        frame_no = state->list.head;
+    }
+    return frame_no;
+}
+
+static const struct PolicyOps second_chance_policy_ops = {
+    "second-chance", queue_init, queue_free, second_chance_load, second_chance_access,
+    second_chance_victim, queue_evict, NULL, queue_save, queue_restore
+};
+
+/**
+ CLOCK: a hand sweeps the frames in frame order, clearing reference bits and
+ stopping at the first resident frame whose bit is clear.
+ */
+struct ClockState {
+    char * resident;
+    char * referenced;
+    int hand;
+};
+
+static int clock_init(struct ReplacementPolicy* policy) {
+    struct ClockState * state = (struct ClockState *) calloc(1, sizeof(struct ClockState));
+    if (!state) {
+        return -1;
+    }
+    policy->state = state;
+    state->resident = (char *) calloc(policy->num_frames, 1);
+    state->referenced = (char *) calloc(policy->num_frames, 1);
+    return state->resident && state->referenced ? 0 : -1;
+}
+
+static void clock_free(struct ReplacementPolicy* policy) {
+    struct ClockState * state = (struct ClockState *) policy->state;
+    if (state) {
+        free(state->resident);
+        free(state->referenced);
+        free(state);
+    }
+}
+
+static void clock_load(struct ReplacementPolicy* policy, int frame_no, long page_no, long now) {
+    struct ClockState * state = (struct ClockState *) policy->state;
+    state->resident[frame_no] = 1;
+    state->referenced[frame_no] = 1;
+}
+
+static void clock_access(struct ReplacementPolicy* policy, int frame_no, long now) {
+    ((struct ClockState *) policy->state)->referenced[frame_no] = 1;
+}
+
+static int clock_victim(struct ReplacementPolicy* policy, long page_no) {
+    struct ClockState * state = (struct ClockState *) policy->state;
+    for (;;) {
+        int frame_no = state->hand;
+        state->hand = (state->hand + 1) % policy->num_frames;
+        if (!state->resident[frame_no]) {
+            continue;
+        }
+        if (!state->referenced[frame_no]) {
+            return frame_no;
+        }
+        state->referenced[frame_no] = 0;
+    }
+}
+
+static void clock_evict(struct ReplacementPolicy* policy, int frame_no) {
+    struct ClockState * state = (struct ClockState *) policy->state;
+    state->resident[frame_no] = 0;
+    state->referenced[frame_no] = 0;
+}
+
+static void clock_save(const struct ReplacementPolicy* policy, struct CkptWriter* out) {
+    const struct ClockState * state = (const struct ClockState *) policy->state;
+    ckpt_write(out, &state->hand, sizeof(state->hand));
+    ckpt_write(out, state->resident, policy->num_frames);
+    ckpt_write(out, state->referenced, policy->num_frames);
+}
+
+static int clock_restore(struct ReplacementPolicy* policy, struct CkptReader* in) {
+    struct ClockState * state = (struct ClockState *) policy->state;
+    return ckpt_read(in, &state->hand, sizeof(state->hand)) ||
+           ckpt_read(in, state->resident, policy->num_frames) ||
+           ckpt_read(in, state->referenced, policy->num_frames) ? -1 : 0;
+}
+
+static const struct PolicyOps clock_policy_ops = {
+    "clock", clock_init, clock_free, clock_load, clock_access, clock_victim, clock_evict, NULL,
+    clock_save, clock_restore
+};
+
+static const struct PolicyOps * const policies[] = {
+    &fifo_policy_ops,
+    &lru_policy_ops,
+    &clock_policy_ops,
+    &second_chance_policy_ops,
+    &lfu_policy_ops,
+    &arc_policy_ops,
+    &opt_policy_ops,
+};
+
+/**
+ Initialises policy as the policy called name for a pool of num_frames frames.
+ Returns 0 on success, -1 if name is unknown or allocation fails.
+ */
+int policy_init(struct ReplacementPolicy* policy, const char* name, int num_frames) {
+    memset(policy, 0, sizeof(*policy));
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        if (strcmp(policies[i]->name, name) == 0) {
+            policy->ops = policies[i];
+            policy->num_frames = num_frames;
+            if (policy->ops->init(policy)) {
+                policy_free(policy);
+                return -1;
+            }
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void policy_free(struct ReplacementPolicy* policy) {
+    if (policy->ops) {
+        policy->ops->free(policy);
+    }
+    memset(policy, 0, sizeof(*policy));
+}
+
+/**
+ Returns the names of all policies, separated by commas, for usage messages.
+ */
+const char* policy_names(void) {
+    return "fifo, lru, clock, second-chance, lfu, arc, opt";
+}
@@ -0,0 +1,99 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stddef.h>
+
+#include "checkpoint.h"
+
+/**
+ Page replacement policy interface. The simulator reports every page load,
+ every reference and every eviction by frame number; the policy answers which
+ resident frame to evict when no frame is free. All per-frame state is kept in
+ arrays indexed by frame number.
+
+ Calling protocol:
+ load(frame, page, now)   page was brought into a free frame at trace position now
+ access(frame, now)       the resident page in frame was referenced again at trace
+                          position now (the reference that loaded it is not repeated)
+ victim(page)             every frame is taken and page is about to be loaded;
+                          returns the frame to evict (still resident)
+ evict(frame)             frame was emptied, whether or not victim() chose it
+ prepare(pages, n)        optional, gives offline policies the page of every access
+ save(out)                writes the policy state to a checkpoint
+ restore(in)              replaces the state of a freshly initialised policy with
+                          one saved by save(); returns 0, or -1 if it is corrupt
+ */
+struct ReplacementPolicy;
+
+struct PolicyOps {
+    const char * name;
+    int (*init)(struct ReplacementPolicy* policy);
+    void (*free)(struct ReplacementPolicy* policy);
+    void (*load)(struct ReplacementPolicy* policy, int frame_no, long page_no, long now);
+    void (*access)(struct ReplacementPolicy* policy, int frame_no, long now);
+    int (*victim)(struct ReplacementPolicy* policy, long page_no);
+    void (*evict)(struct ReplacementPolicy* policy, int frame_no);
+    int (*prepare)(struct ReplacementPolicy* policy, const long* pages, size_t num_pages);
+    void (*save)(const struct ReplacementPolicy* policy, struct CkptWriter* out);
+    int (*restore)(struct ReplacementPolicy* policy, struct CkptReader* in);
+};
+
+struct ReplacementPolicy {
+    const struct PolicyOps * ops;
+    int num_frames;
+    void * state;
+};
+
+int policy_init(struct ReplacementPolicy* policy, const char* name, int num_frames);
+void policy_free(struct ReplacementPolicy* policy);
+const char* policy_names(void);
+
+/**
+ Doubly linked list of frames threaded through per-frame prev/next arrays, the
+ building block of the queue based policies. Oldest (or least recently used)
+ frame at the head.
+ */
+struct FrameList {
+    int head;
+    int tail;
+    int size;
+};
+
+static inline void frame_list_init(struct FrameList* list) {
+    list->head = -1;
+    list->tail = -1;
+    list->size = 0;
+}
+
+static inline void frame_list_push(struct FrameList* list, int* prev, int* next, int node) {
+    prev[node] = list->tail;
+    next[node] = -1;
+    if (list->tail >= 0) {
+        next[list->tail] = node;
+    } else {
+        list->head = node;
+    }
+    list->tail = node;
+    list->size++;
+}
+
+static inline void frame_list_unlink(struct FrameList* list, int* prev, int* next, int node) {
+    if (prev[node] >= 0) {
+        next[prev[node]] = next[node];
+    } else {
+        list->head = next[node];
+    }
+    if (next[node] >= 0) {
+        prev[next[node]] = prev[node];
+    } else {
+        list->tail = prev[node];
+    }
+    list->size--;
+}
+
+// policies implemented in their own files
+extern const struct PolicyOps lfu_policy_ops;
+extern const struct PolicyOps arc_policy_ops;
+extern const struct PolicyOps opt_policy_ops;
+
+#endif
@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "page_map.h"
+#include "policy.h"
+
+/**
+ ARC (Megiddo and Modha). Resident pages are split between T1 (seen once
+ recently) and T2 (seen at least twice); ghost lists B1 and B2 remember the
+ pages recently evicted from each. A hit in a ghost list moves the target size
+ p of T1 towards the list that would have kept the page. T1 and T2 are lists
+ of frames, B1 and B2 lists of ghost nodes found through a page map, so every
+ operation is O(1).
+ */
+enum { ARC_NONE, ARC_T1, ARC_T2, ARC_B1, ARC_B2 };
+
+struct ArcState {
+    int c;
+    int p;
+    // resident side, indexed by frame
+    int * prev;
+    int * next;
+    long * page_of;
+    char * list_of;
+    char * ghost_to; // list the page joins when its eviction completes
+    struct FrameList t1;
+    struct FrameList t2;
+    // ghost side, 2c nodes
+    int * gprev;
+    int * gnext;
+    long * gpage;
+    char * glist_of;
+    int gfree;
+    struct FrameList b1;
+    struct FrameList b2;
+    struct PageMap ghosts;
+    // adaptation happens once per fault, in victim() or load()
+    int adapted;
+    long adapted_page;
+    int replaced;
+};
+
+static int arc_init(struct ReplacementPolicy* policy) {
+    struct ArcState * state = (struct ArcState *) calloc(1, sizeof(struct ArcState));
+    if (!state) {
+        return -1;
+    }
+    policy->state = state;
+    int c = policy->num_frames;
+    state->c = c;
+    state->prev = (int *) malloc(c * sizeof(int));
+    state->next = (int *) malloc(c * sizeof(int));
+    state->page_of = (long *) malloc(c * sizeof(long));
+    state->list_of = (char *) calloc(c, 1);
+    state->ghost_to = (char *) calloc(c, 1);
+    state->gprev = (int *) malloc(2 * c * sizeof(int));
+    state->gnext = (int *) malloc(2 * c * sizeof(int));
+    state->gpage = (long *) malloc(2 * c * sizeof(long));
+    state->glist_of = (char *) calloc(2 * c, 1);
+    if (!state->prev || !state->next || !state->page_of || !state->list_of || !state->ghost_to ||
+        !state->gprev || !state->gnext || !state->gpage || !state->glist_of ||
+        page_map_init(&state->ghosts, 2 * c)) {
+        return -1;
+    }
+    frame_list_init(&state->t1);
+    frame_list_init(&state->t2);
+    frame_list_init(&state->b1);
+    frame_list_init(&state->b2);
+    // free ghost nodes are chained through gnext
+    for (int i = 0; i < 2 * c; i++) {
+        state->gnext[i] = i + 1 < 2 * c ? i + 1 : -1;
+    }
+    state->gfree = 0;
+    return 0;
+}
+
+static void arc_free(struct ReplacementPolicy* policy) {
+    struct ArcState * state = (struct ArcState *) policy->state;
+    if (state) {
+        free(state->prev);
+        free(state->next);
+        free(state->page_of);
+        free(state->list_of);
+        free(state->ghost_to);
+        free(state->gprev);
+        free(state->gnext);
+        free(state->gpage);
+        free(state->glist_of);
+        page_map_free(&state->ghosts);
+        free(state);
+    }
+}
+
+static struct FrameList* arc_ghost_list(struct ArcState* state, int list) {
+    return list == ARC_B1 ? &state->b1 : &state->b2;
+}
+
+static void arc_drop_ghost(struct ArcState* state, int node) {
+    frame_list_unlink(arc_ghost_list(state, state->glist_of[node]), state->gprev, state->gnext, node);
+    page_map_remove(&state->ghosts, state->gpage[node]);
+    state->glist_of[node] = ARC_NONE;
+    state->gnext[node] = state->gfree;
+    state->gfree = node;
+}
+
+static void arc_add_ghost(struct ArcState* state, long page_no, int list) {
+    if (state->gfree < 0) {
+        // only reachable when frames are emptied behind the policy's back
+        arc_drop_ghost(state, state->b2.size > 0 ? state->b2.head : state->b1.head);
+    }
+    int node = state->gfree;
+    state->gfree = state->gnext[node];
+    state->gpage[node] = page_no;
+    state->glist_of[node] = list;
+    frame_list_push(arc_ghost_list(state, list), state->gprev, state->gnext, node);
+    page_map_put(&state->ghosts, page_no, node);
+}
+
+/**
+ Adjusts p when the incoming page is remembered in a ghost list.
+ */
+static void arc_adapt(struct ArcState* state, long page_no) {
+    if (state->adapted && state->adapted_page == page_no) {
+        return;
+    }
+    state->adapted = 1;
+    state->adapted_page = page_no;
+    state->replaced = 0;
+    int node = page_map_get(&state->ghosts, page_no);
+    if (node < 0) {
+        return;
+    }
+    if (state->glist_of[node] == ARC_B1) {
+        int delta = state->b2.size > state->b1.size ? state->b2.size / state->b1.size : 1;
+        state->p = state->p + delta < state->c ? state->p + delta : state->c;
+    } else {
+        int delta = state->b1.size > state->b2.size ? state->b1.size / state->b2.size : 1;
+        state->p = state->p - delta > 0 ? state->p - delta : 0;
+    }
+}
+
+/**
+ REPLACE from the ARC paper: picks the LRU page of T1 or T2 and notes which
+ ghost list it joins.
+ */
+static int arc_replace(struct ArcState* state, int in_b2) {
+    int from_t1 = state->t1.size > 0 &&
+                  (state->t1.size > state->p || (in_b2 && state->t1.size == state->p));
+    if (!from_t1 && state->t2.size == 0) {
+        from_t1 = 1;
+    }
+    int frame_no = from_t1 ? state->t1.head : state->t2.head;
+    state->ghost_to[frame_no] = from_t1 ? ARC_B1 : ARC_B2;
+    return frame_no;
+}
+
+static int arc_victim(struct ReplacementPolicy* policy, long page_no) {
+    struct ArcState * state = (struct ArcState *) policy->state;
+    arc_adapt(state, page_no);
+    state->replaced = 1;
+    int node = page_map_get(&state->ghosts, page_no);
+    if (node >= 0) {
+        return arc_replace(state, state->glist_of[node] == ARC_B2);
+    }
+    // complete miss
+    if (state->t1.size + state->b1.size >= state->c) {
+        if (state->t1.size < state->c) {
+            arc_drop_ghost(state, state->b1.head);
+            return arc_replace(state, 0);
+        }
+        // B1 is empty: T1's LRU page leaves without a ghost
+        state->ghost_to[state->t1.head] = ARC_NONE;
+        return state->t1.head;
+    }
+    if (state->t1.size + state->t2.size + state->b1.size + state->b2.size >= 2 * state->c &&
+        state->b2.size > 0) {
+        arc_drop_ghost(state, state->b2.head);
+    }
+    return arc_replace(state, 0);
+}
+
+static void arc_load(struct ReplacementPolicy* policy, int frame_no, long page_no, long now) {
+    struct ArcState * state = (struct ArcState *) policy->state;
+    arc_adapt(state, page_no);
+    int node = page_map_get(&state->ghosts, page_no);
+    state->page_of[frame_no] = page_no;
+    state->ghost_to[frame_no] = ARC_NONE;
+    if (node >= 0) {
+        arc_drop_ghost(state, node);
+        state->list_of[frame_no] = ARC_T2;
+        frame_list_push(&state->t2, state->prev, state->next, frame_no);
+    } else {
+        if (!state->replaced) {
+            // loaded into a free frame: only the ghost lists need trimming
+            if (state->t1.size + state->b1.size >= state->c && state->b1.size > 0) {
+                arc_drop_ghost(state, state->b1.head);
+            } else if (state->t1.size + state->t2.size + state->b1.size + state->b2.size >= 2 * state->c &&
+                       state->b2.size > 0) {
+                arc_drop_ghost(state, state->b2.head);
+            }
+        }
+        state->list_of[frame_no] = ARC_T1;
+        frame_list_push(&state->t1, state->prev, state->next, frame_no);
+    }
+    state->adapted = 0;
+}
+
+static void arc_access(struct ReplacementPolicy* policy, int frame_no, long now) {
+    struct ArcState * state = (struct ArcState *) policy->state;
+    struct FrameList * list = state->list_of[frame_no] == ARC_T1 ? &state->t1 : &state->t2;
+    if (list == &state->t2 && state->t2.tail == frame_no) {
+        return;
+    }
+    frame_list_unlink(list, state->prev, state->next, frame_no);
+    state->list_of[frame_no] = ARC_T2;
+    frame_list_push(&state->t2, state->prev, state->next, frame_no);
+}
+
+static void arc_evict(struct ReplacementPolicy* policy, int frame_no) {
+    struct ArcState * state = (struct ArcState *) policy->state;
+    struct FrameList * list = state->list_of[frame_no] == ARC_T1 ? &state->t1 : &state->t2;
+    frame_list_unlink(list, state->prev, state->next, frame_no);
+    state->list_of[frame_no] = ARC_NONE;
+    if (state->ghost_to[frame_no] != ARC_NONE) {
+        arc_add_ghost(state, state->page_of[frame_no], state->ghost_to[frame_no]);
+        state->ghost_to[frame_no] = ARC_NONE;
+    }
+}
+
+static void arc_save(const struct ReplacementPolicy* policy, struct CkptWriter* out) {
+    const struct ArcState * state = (const struct ArcState *) policy->state;
+    int c = state->c;
+    ckpt_write(out, &state->p, sizeof(state->p));
+    ckpt_write(out, state->prev, c * sizeof(int));
+    ckpt_write(out, state->next, c * sizeof(int));
+    ckpt_write(out, state->page_of, c * sizeof(long));
+    ckpt_write(out, state->list_of, c);
+    ckpt_write(out, state->ghost_to, c);
+    ckpt_write(out, &state->t1, sizeof(state->t1));
+    ckpt_write(out, &state->t2, sizeof(state->t2));
+    ckpt_write(out, state->gprev, 2 * c * sizeof(int));
+    ckpt_write(out, state->gnext, 2 * c * sizeof(int));
+    ckpt_write(out, state->gpage, 2 * c * sizeof(long));
+    ckpt_write(out, state->glist_of, 2 * c);
+    ckpt_write(out, &state->gfree, sizeof(state->gfree));
+    ckpt_write(out, &state->b1, sizeof(state->b1));
+    ckpt_write(out, &state->b2, sizeof(state->b2));
+    ckpt_write(out, &state->adapted, sizeof(state->adapted));
+    ckpt_write(out, &state->adapted_page, sizeof(state->adapted_page));
+    ckpt_write(out, &state->replaced, sizeof(state->replaced));
+}
+
+// the ghost map is rebuilt from the nodes that are on a ghost list
+static int arc_restore(struct ReplacementPolicy* policy, struct CkptReader* in) {
+    struct ArcState * state = (struct ArcState *) policy->state;
+    int c = state->c;
+    if (ckpt_read(in, &state->p, sizeof(state->p)) ||
+        ckpt_read(in, state->prev, c * sizeof(int)) ||
+        ckpt_read(in, state->next, c * sizeof(int)) ||
+        ckpt_read(in, state->page_of, c * sizeof(long)) ||
+        ckpt_read(in, state->list_of, c) ||
+        ckpt_read(in, state->ghost_to, c) ||
+        ckpt_read(in, &state->t1, sizeof(state->t1)) ||
+        ckpt_read(in, &state->t2, sizeof(state->t2)) ||
+        ckpt_read(in, state->gprev, 2 * c * sizeof(int)) ||
+        ckpt_read(in, state->gnext, 2 * c * sizeof(int)) ||
+        ckpt_read(in, state->gpage, 2 * c * sizeof(long)) ||
+        ckpt_read(in, state->glist_of, 2 * c) ||
+        ckpt_read(in, &state->gfree, sizeof(state->gfree)) ||
+        ckpt_read(in, &state->b1, sizeof(state->b1)) ||
+        ckpt_read(in, &state->b2, sizeof(state->b2)) ||
+        ckpt_read(in, &state->adapted, sizeof(state->adapted)) ||
+        ckpt_read(in, &state->adapted_page, sizeof(state->adapted_page)) ||
+        ckpt_read(in, &state->replaced, sizeof(state->replaced))) {
+        return -1;
+    }
+    page_map_clear(&state->ghosts);
+    for (int node = 0; node < 2 * c; node++) {
+        if (state->glist_of[node] != ARC_NONE) {
+            page_map_put(&state->ghosts, state->gpage[node], node);
+        }
+    }
+    return 0;
+}
+
+const struct PolicyOps arc_policy_ops = {
+    "arc", arc_init, arc_free, arc_load, arc_access, arc_victim, arc_evict, NULL,
+    arc_save, arc_restore
+};
@@ -0,0 +1,56 @@
+#include <stdlib.h>
+
+#include "frame_heap.h"
+#include "policy.h"
+
+/**
+ LFU: evicts the resident page with the fewest references since it was loaded,
+ the least recently used one among equals. A heap keyed by (count, last
+ reference) keeps every operation O(log n).
+ */
+static int lfu_init(struct ReplacementPolicy* policy) {
+    struct FrameHeap * heap = (struct FrameHeap *) malloc(sizeof(struct FrameHeap));
+    if (!heap) {
+        return -1;
+    }
+    policy->state = heap;
+    return frame_heap_init(heap, policy->num_frames);
+}
+
+static void lfu_free(struct ReplacementPolicy* policy) {
+    struct FrameHeap * heap = (struct FrameHeap *) policy->state;
+    if (heap) {
+        frame_heap_free(heap);
+        free(heap);
+    }
+}
+
+static void lfu_load(struct ReplacementPolicy* policy, int frame_no, long page_no, long now) {
+    frame_heap_set((struct FrameHeap *) policy->state, frame_no, 1, now);
+}
+
+static void lfu_access(struct ReplacementPolicy* policy, int frame_no, long now) {
+    struct FrameHeap * heap = (struct FrameHeap *) policy->state;
+    frame_heap_set(heap, frame_no, heap->key[frame_no] + 1, now);
+}
+
+static int lfu_victim(struct ReplacementPolicy* policy, long page_no) {
+    return frame_heap_top((struct FrameHeap *) policy->state);
+}
+
+static void lfu_evict(struct ReplacementPolicy* policy, int frame_no) {
+    frame_heap_remove((struct FrameHeap *) policy->state, frame_no);
+}
+
+static void lfu_save(const struct ReplacementPolicy* policy, struct CkptWriter* out) {
+    frame_heap_save((const struct FrameHeap *) policy->state, policy->num_frames, out);
+}
+
+static int lfu_restore(struct ReplacementPolicy* policy, struct CkptReader* in) {
+    return frame_heap_restore((struct FrameHeap *) policy->state, policy->num_frames, in);
+}
+
+const struct PolicyOps lfu_policy_ops = {
+    "lfu", lfu_init, lfu_free, lfu_load, lfu_access, lfu_victim, lfu_evict, NULL,
+    lfu_save, lfu_restore
+};
@@ -0,0 +1,133 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_heap.h"
+#include "page_map.h"
+#include "policy.h"
+
+/**
+ Belady's OPT: evicts the resident page whose next reference lies furthest in
+ the future. prepare() computes the position of the next reference for every
+ access of the trace in one backward pass; a max-heap (keys negated) over the
+ frames then gives the victim in O(log n) per access.
+ */
+struct OptState {
+    struct FrameHeap heap;
+    long * next_use;
+    size_t num_accesses;
+};
+
+static int opt_init(struct ReplacementPolicy* policy) {
+    struct OptState * state = (struct OptState *) calloc(1, sizeof(struct OptState));
+    if (!state) {
+        return -1;
+    }
+    policy->state = state;
+    return frame_heap_init(&state->heap, policy->num_frames);
+}
+
+static void opt_free(struct ReplacementPolicy* policy) {
+    struct OptState * state = (struct OptState *) policy->state;
+    if (state) {
+        frame_heap_free(&state->heap);
+        free(state->next_use);
+        free(state);
+    }
+}
+
+static int opt_prepare(struct ReplacementPolicy* policy, const long* pages, size_t num_pages) {
+    struct OptState * state = (struct OptState *) policy->state;
+    free(state->next_use);
+    state->next_use = (long *) malloc(num_pages * sizeof(long));
+    if (!state->next_use && num_pages > 0) {
+        return -1;
+    }
+    state->num_accesses = num_pages;
+
+    // small page numbers index last_seen directly; anything else is first given
+    // a dense number through a map, so positions past INT_MAX stay exact
+    long max_page = 0;
+    for (size_t i = 0; i < num_pages; i++) {
+        if (pages[i] > max_page) {
+            max_page = pages[i];
+        }
+    }
+    struct PageMap ids;
+    int direct = max_page < (1 << 24);
+    long capacity = direct ? max_page + 1 : 1024;
+    long * last_seen = (long *) malloc(capacity * sizeof(long));
+    if (!last_seen) {
+        return -1;
+    }
+    if (!direct && page_map_init(&ids, num_pages < (1 << 20) ? (int) num_pages : 1 << 20)) {
+        free(last_seen);
+        return -1;
+    }
+    for (long i = 0; i < capacity; i++) {
+        last_seen[i] = LONG_MAX;
+    }
+
+    // LONG_MAX in last_seen means never again
+    long num_ids = 0;
+    for (size_t i = num_pages; i-- > 0;) {
+        long id = pages[i];
+        if (!direct) {
+            id = page_map_get(&ids, pages[i]);
+            if (id < 0) {
+                if (num_ids == capacity) {
+                    long * grown = (long *) realloc(last_seen, 2 * capacity * sizeof(long));
+                    if (!grown) {
+                        free(last_seen);
+                        page_map_free(&ids);
+                        return -1;
+                    }
+                    last_seen = grown;
+                    capacity *= 2;
+                }
+                id = num_ids++;
+                last_seen[id] = LONG_MAX;
+                page_map_put(&ids, pages[i], (int) id);
+            }
+        }
+        state->next_use[i] = last_seen[id];
+        last_seen[id] = i;
+    }
+    free(last_seen);
+    if (!direct) {
+        page_map_free(&ids);
+    }
+    return 0;
+}
+
+static void opt_access(struct ReplacementPolicy* policy, int frame_no, long now) {
+    struct OptState * state = (struct OptState *) policy->state;
+    long next = (size_t) now < state->num_accesses ? state->next_use[now] : LONG_MAX;
+    frame_heap_set(&state->heap, frame_no, -(long long) next, 0);
+}
+
+static void opt_load(struct ReplacementPolicy* policy, int frame_no, long page_no, long now) {
+    opt_access(policy, frame_no, now);
+}
+
+static int opt_victim(struct ReplacementPolicy* policy, long page_no) {
+    return frame_heap_top(&((struct OptState *) policy->state)->heap);
+}
+
+static void opt_evict(struct ReplacementPolicy* policy, int frame_no) {
+    frame_heap_remove(&((struct OptState *) policy->state)->heap, frame_no);
+}
+
+// the next uses come from prepare(), which a restored run calls again on the same trace
+static void opt_save(const struct ReplacementPolicy* policy, struct CkptWriter* out) {
+    frame_heap_save(&((const struct OptState *) policy->state)->heap, policy->num_frames, out);
+}
+
+static int opt_restore(struct ReplacementPolicy* policy, struct CkptReader* in) {
+    return frame_heap_restore(&((struct OptState *) policy->state)->heap, policy->num_frames, in);
+}
+
+const struct PolicyOps opt_policy_ops = {
+    "opt", opt_init, opt_free, opt_load, opt_access, opt_victim, opt_evict, opt_prepare,
+    opt_save, opt_restore
+};
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "prefetch.h"
+
+/**
+ Sets up an empty stream table. Returns 0 on success, -1 on a bad degree or
+ stream count or if memory runs out.
+ */
+int prefetcher_init(struct Prefetcher* prefetcher, int degree, int num_streams) {
+    memset(prefetcher, 0, sizeof(*prefetcher));
+    if (degree < 1 || num_streams < 1) {
+        return -1;
+    }
+    prefetcher->degree = degree;
+    prefetcher->num_streams = num_streams;
+    prefetcher->streams = (struct PrefetchStream *) calloc(num_streams,
+                                                           sizeof(struct PrefetchStream));
+    return prefetcher->streams ? 0 : -1;
+}
+
+void prefetcher_free(struct Prefetcher* prefetcher) {
+    free(prefetcher->streams);
+    prefetcher->streams = NULL;
+}
+
+/**
+ Feeds page_no, a demand fault or the first reference to a prefetched page,
+ to the stream it belongs to. Returns the stride along which the next degree
+ pages should be prefetched, or 0 if the stream has no confirmed stride yet.
+ */
+long prefetcher_train(struct Prefetcher* prefetcher, long page_no) {
+    struct PrefetchStream * best = NULL;
+    long best_distance = PREFETCH_WINDOW + 1;
+    for (int i = 0; i < prefetcher->num_active; i++) {
+        struct PrefetchStream * stream = &prefetcher->streams[i];
+        long distance = labs(page_no - stream->last_page);
+        if (distance < best_distance) {
+            best = stream;
+            best_distance = distance;
+        }
+    }
+    prefetcher->clock++;
+
+    if (!best) {
+        // a new stream, in a free slot or in place of the least recently used
+        if (prefetcher->num_active < prefetcher->num_streams) {
+            best = &prefetcher->streams[prefetcher->num_active++];
+        } else {
+            best = &prefetcher->streams[0];
+            for (int i = 1; i < prefetcher->num_streams; i++) {
+                if (prefetcher->streams[i].last_used < best->last_used) {
+                    best = &prefetcher->streams[i];
+                }
+            }
+        }
+        best->last_page = page_no;
+        best->stride = 0;
+        best->confirmed = 0;
+        best->last_used = prefetcher->clock;
+        return 0;
+    }
+
+    best->last_used = prefetcher->clock;
+    long stride = page_no - best->last_page;
+    if (stride == 0) {
+        return 0;
+    }
+    best->confirmed = stride == best->stride;
+    best->stride = stride;
+    best->last_page = page_no;
+    return best->confirmed ? stride : 0;
+}
+
+void prefetcher_save(const struct Prefetcher* prefetcher, struct CkptWriter* out) {
+    ckpt_write(out, &prefetcher->num_streams, sizeof(prefetcher->num_streams));
+    ckpt_write(out, &prefetcher->num_active, sizeof(prefetcher->num_active));
+    ckpt_write(out, &prefetcher->clock, sizeof(prefetcher->clock));
+    ckpt_write(out, &prefetcher->num_issued, sizeof(prefetcher->num_issued));
+    ckpt_write(out, &prefetcher->num_useful, sizeof(prefetcher->num_useful));
+    ckpt_write(out, prefetcher->streams, prefetcher->num_streams * sizeof(struct PrefetchStream));
+}
+
+int prefetcher_restore(struct Prefetcher* prefetcher, struct CkptReader* in) {
+    int num_streams;
+    if (ckpt_read(in, &num_streams, sizeof(num_streams)) ||
+        num_streams != prefetcher->num_streams ||
+        ckpt_read(in, &prefetcher->num_active, sizeof(prefetcher->num_active)) ||
+        prefetcher->num_active < 0 || prefetcher->num_active > num_streams ||
+        ckpt_read(in, &prefetcher->clock, sizeof(prefetcher->clock)) ||
+        ckpt_read(in, &prefetcher->num_issued, sizeof(prefetcher->num_issued)) ||
+        ckpt_read(in, &prefetcher->num_useful, sizeof(prefetcher->num_useful)) ||
+        ckpt_read(in, prefetcher->streams, num_streams * sizeof(struct PrefetchStream))) {
+        return -1;
+    }
+    return 0;
+}
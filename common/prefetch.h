@@ -0,0 +1,42 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "checkpoint.h"
+
+#define PREFETCH_WINDOW 64  // pages a fault may be from a stream's last page and still belong to it
+
+/**
+ Stride prefetcher for the page-fault path. It keeps a small table of
+ streams, each the last page it saw and the stride between its last two
+ pages. A page is matched to the nearest stream within PREFETCH_WINDOW pages
+ (or starts a new one in place of the least recently used); once a stream has
+ made the same stride twice in a row, the next degree pages along it are
+ worth bringing in. Sequential access is the stride 1 case.
+
+ The prefetcher only predicts; the simulator loads the pages and reports
+ back which ones were referenced before being evicted.
+ */
+struct PrefetchStream {
+    long last_page;
+    long stride;      // 0 until the stream has two pages
+    int confirmed;    // the last two strides were equal
+    long last_used;   // clock of the last match, for replacement
+};
+
+struct Prefetcher {
+    int degree;       // pages brought in per prediction, 0 if prefetching is off
+    int num_streams;
+    int num_active;
+    struct PrefetchStream * streams;
+    long clock;
+    long num_issued;  // pages loaded by the prefetcher
+    long num_useful;  // of those, pages referenced before eviction
+};
+
+int prefetcher_init(struct Prefetcher* prefetcher, int degree, int num_streams);
+void prefetcher_free(struct Prefetcher* prefetcher);
+long prefetcher_train(struct Prefetcher* prefetcher, long page_no);
+void prefetcher_save(const struct Prefetcher* prefetcher, struct CkptWriter* out);
+int prefetcher_restore(struct Prefetcher* prefetcher, struct CkptReader* in);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef PTE_H
+#define PTE_H
+
+#define PTE_FRAME_BITS 27
+#define PTE_MAX_FRAMES (1 << (PTE_FRAME_BITS - 1))  // frame_no is signed: -1 when unmapped
+
+#define PTE_PROT_READ 1
+#define PTE_PROT_WRITE 2
+
+/**
+ Page table entry packed into one 32-bit word, so a leaf of the page table
+ and the TLB hold four times as many entries per cache line as three ints
+ would. Mapped pages are readable and writable.
+ */
+struct PTE {
+    signed int frame_no : PTE_FRAME_BITS;
+    unsigned int valid : 1;
+    unsigned int dirty : 1;
+    unsigned int referenced : 1;  // set by every walk that finds the page mapped
+    unsigned int prot : 2;        // PTE_PROT_READ | PTE_PROT_WRITE
+};
+
+_Static_assert(sizeof(struct PTE) == 4, "a PTE must fit in 32 bits");
+
+#endif
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "resident_set.h"
+
+/**
+ Sets up a controller in mode for num_frames frames shared by num_processes
+ processes, all resident sets empty. The caller sets the window or thresholds
+ of the mode. With series_fname set, the time series is written there.
+ Returns 0 on success, -1 on allocation failure or if the file cannot be
+ created.
+ */
+int rs_init(struct ResidentSets* rs, int mode, int num_frames, int num_processes,
+            long interval, const char* series_fname) {
+    memset(rs, 0, sizeof(*rs));
+    rs->mode = mode;
+    rs->interval = interval;
+    rs->next_sample = interval;
+    rs->prev = (int *) malloc(num_frames * sizeof(int));
+    rs->next = (int *) malloc(num_frames * sizeof(int));
+    rs->last_ref = (long *) malloc(num_frames * sizeof(long));
+    rs->processes = (struct RsProcess *) calloc(num_processes, sizeof(struct RsProcess));
+    if (!rs->prev || !rs->next || !rs->last_ref || !rs->processes || interval < 1) {
+        rs_free(rs);
+        return -1;
+    }
+    rs->num_processes = num_processes;
+    for (int p = 0; p < num_processes; p++) {
+        frame_list_init(&rs->processes[p].resident);
+    }
+    if (series_fname) {
+        rs->series = fopen(series_fname, "w");
+        if (!rs->series) {
+            rs_free(rs);
+            return -1;
+        }
+        fprintf(rs->series, "time,process,resident_pages,page_fault_rate,thrashing\n");
+    }
+    return 0;
+}
+
+void rs_free(struct ResidentSets* rs) {
+    if (rs->series) {
+        fclose(rs->series);
+    }
+    free(rs->prev);
+    free(rs->next);
+    free(rs->last_ref);
+    free(rs->processes);
+    memset(rs, 0, sizeof(*rs));
+}
+
+/**
+ Samples process pid at trace position now, given its reference and fault
+ counts so far. The fault rate covers the references it made since the last
+ sample.
+ */
+void rs_sample(struct ResidentSets* rs, long now, unsigned pid, long num_entries, long num_faults) {
+    struct RsProcess * process = &rs->processes[pid];
+    long entries = num_entries - process->sample_entries;
+    long faults = num_faults - process->sample_faults;
+    process->sample_entries = num_entries;
+    process->sample_faults = num_faults;
+    rs->resident_sum += process->resident.size;
+    if (rs->series) {
+        fprintf(rs->series, "%ld,%u,%d,%f,%d\n", now, pid, process->resident.size,
+                entries > 0 ? faults / (double) entries : 0.0, rs->interval_forced > 0);
+    }
+}
+
+/**
+ Closes the current interval once every process has been sampled.
+ */
+void rs_end_interval(struct ResidentSets* rs) {
+    rs->num_intervals++;
+    rs->num_thrashing += rs->interval_forced > 0;
+    rs->interval_forced = 0;
+    rs->next_sample += rs->interval;
+}
+
+void rs_print_stats(const struct ResidentSets* rs, FILE* out) {
+    if (rs->mode == RS_WORKING_SET) {
+        fprintf(out, "Resident sets: working set, window %ld\n", rs->tau);
+    } else {
+        fprintf(out, "Resident sets: page-fault frequency, %f to %f faults per access\n",
+                rs->pff_lower, rs->pff_upper);
+    }
+    fprintf(out, "Mean resident pages: %f\n",
+            rs->num_intervals ? rs->resident_sum / rs->num_intervals : 0.0);
+    fprintf(out, "Pages released by the controller: %ld\n", rs->num_released);
+    fprintf(out, "Forced evictions: %ld\n", rs->num_forced);
+    fprintf(out, "Thrashing intervals: %ld of %ld\n", rs->num_thrashing, rs->num_intervals);
+}
+
+/**
+ Writes the resident lists and counters to a checkpoint. The time series
+ file is not part of it.
+ */
+void rs_save(const struct ResidentSets* rs, int num_frames, struct CkptWriter* out) {
+    ckpt_write(out, &rs->mode, sizeof(rs->mode));
+    ckpt_write(out, &rs->num_processes, sizeof(rs->num_processes));
+    ckpt_write(out, rs->prev, num_frames * sizeof(int));
+    ckpt_write(out, rs->next, num_frames * sizeof(int));
+    ckpt_write(out, rs->last_ref, num_frames * sizeof(long));
+    ckpt_write(out, rs->processes, rs->num_processes * sizeof(struct RsProcess));
+    ckpt_write(out, &rs->next_sample, sizeof(rs->next_sample));
+    ckpt_write(out, &rs->num_released, sizeof(rs->num_released));
+    ckpt_write(out, &rs->num_forced, sizeof(rs->num_forced));
+    ckpt_write(out, &rs->interval_forced, sizeof(rs->interval_forced));
+    ckpt_write(out, &rs->num_intervals, sizeof(rs->num_intervals));
+    ckpt_write(out, &rs->num_thrashing, sizeof(rs->num_thrashing));
+    ckpt_write(out, &rs->resident_sum, sizeof(rs->resident_sum));
+}
+
+/**
+ Loads a controller saved by rs_save into a fresh one of the same mode.
+ Returns 0 on success, -1 if it does not fit or is corrupt.
+ */
+int rs_restore(struct ResidentSets* rs, int num_frames, struct CkptReader* in) {
+    int mode, num_processes;
+    if (ckpt_read(in, &mode, sizeof(mode)) || mode != rs->mode ||
+        ckpt_read(in, &num_processes, sizeof(num_processes)) ||
+        num_processes != rs->num_processes ||
+        ckpt_read(in, rs->prev, num_frames * sizeof(int)) ||
+        ckpt_read(in, rs->next, num_frames * sizeof(int)) ||
+        ckpt_read(in, rs->last_ref, num_frames * sizeof(long)) ||
+        ckpt_read(in, rs->processes, num_processes * sizeof(struct RsProcess)) ||
+        ckpt_read(in, &rs->next_sample, sizeof(rs->next_sample)) ||
+        ckpt_read(in, &rs->num_released, sizeof(rs->num_released)) ||
+        ckpt_read(in, &rs->num_forced, sizeof(rs->num_forced)) ||
+        ckpt_read(in, &rs->interval_forced, sizeof(rs->interval_forced)) ||
+        ckpt_read(in, &rs->num_intervals, sizeof(rs->num_intervals)) ||
+        ckpt_read(in, &rs->num_thrashing, sizeof(rs->num_thrashing)) ||
+        ckpt_read(in, &rs->resident_sum, sizeof(rs->resident_sum))) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#ifndef RESIDENT_SET_H
+#define RESIDENT_SET_H
+
+#include <stdio.h>
+
+#include "checkpoint.h"
+#include "policy.h"
+
+#define RS_NONE 0
+#define RS_WORKING_SET 1  // Denning's working set with window tau
+#define RS_PFF 2          // page-fault frequency with lower and upper thresholds
+
+/**
+ Resident-set controller. Instead of leaving the frame pool to the global
+ replacement policy, it sizes each address space's resident set as the trace
+ runs, in the virtual time of that process (its own count of references).
+
+ Working set: a page stays resident while it was referenced within the last
+ tau references of its process; older pages are released as soon as they fall
+ out of the window. Page-fault frequency: at each fault the process's fault
+ rate is 1 / (references since its previous fault). Above the upper threshold
+ the resident set grows by a frame; below the lower one the pages not
+ referenced since the previous fault are released; in between the process
+ replaces its own least recently used page.
+
+ Resident pages of each process are kept on a list in order of last
+ reference, threaded through per-frame arrays, so the oldest page is always at
+ the head and every decision takes constant time. Growing when no frame is
+ free evicts the global policy's victim, a page that its own resident set
+ still wants: the resident sets no longer fit in memory, and an interval in
+ which that happens counts as thrashing.
+
+ Every interval references the controller samples each process's resident set
+ size and fault rate over the interval, from counters kept up to date on every
+ load and eviction, and writes them as CSV rows if series is set.
+ */
+struct RsProcess {
+    struct FrameList resident;  // frames in order of last reference, oldest first
+    long last_fault;            // virtual time of the latest fault
+    long prev_fault;            // virtual time of the fault before it
+    long sample_entries;        // references at the previous sample
+    long sample_faults;         // faults at the previous sample
+};
+
+struct ResidentSets {
+    int mode;                // RS_NONE, RS_WORKING_SET or RS_PFF
+    long tau;                // working-set window, in references of the process
+    double pff_lower;        // faults per reference
+    double pff_upper;
+    int * prev;              // resident list links, per frame
+    int * next;
+    long * last_ref;         // virtual time of the latest reference, per frame
+    struct RsProcess * processes;
+    int num_processes;
+    long interval;           // references between samples
+    long next_sample;        // trace position that ends the current interval
+    FILE * series;           // time series CSV, NULL for none
+    long num_released;       // pages the controller took from their own resident set
+    long num_forced;         // faults that evicted a page its resident set still wanted
+    long interval_forced;
+    long num_intervals;
+    long num_thrashing;      // intervals with forced evictions
+    double resident_sum;     // resident pages summed over samples
+};
+
+int rs_init(struct ResidentSets* rs, int mode, int num_frames, int num_processes,
+            long interval, const char* series_fname);
+void rs_free(struct ResidentSets* rs);
+void rs_sample(struct ResidentSets* rs, long now, unsigned pid, long num_entries, long num_faults);
+void rs_end_interval(struct ResidentSets* rs);
+void rs_print_stats(const struct ResidentSets* rs, FILE* out);
+void rs_save(const struct ResidentSets* rs, int num_frames, struct CkptWriter* out);
+int rs_restore(struct ResidentSets* rs, int num_frames, struct CkptReader* in);
+
+/**
+ Records that frame_no now holds a page of pid, referenced at virtual time vtime.
+ */
+static inline void rs_load(struct ResidentSets* rs, int frame_no, unsigned pid, long vtime) {
+    rs->last_ref[frame_no] = vtime;
+    frame_list_push(&rs->processes[pid].resident, rs->prev, rs->next, frame_no);
+}
+
+static inline void rs_evict(struct ResidentSets* rs, int frame_no, unsigned pid) {
+    frame_list_unlink(&rs->processes[pid].resident, rs->prev, rs->next, frame_no);
+}
+
+/**
+ Moves frame_no, referenced by pid at virtual time vtime, to the young end.
+ */
+static inline void rs_touch(struct ResidentSets* rs, int frame_no, unsigned pid, long vtime) {
+    struct FrameList * list = &rs->processes[pid].resident;
+    rs->last_ref[frame_no] = vtime;
+    if (list->tail != frame_no) {
+        frame_list_unlink(list, rs->prev, rs->next, frame_no);
+        frame_list_push(list, rs->prev, rs->next, frame_no);
+    }
+}
+
+/**
+ Returns the least recently referenced frame of pid if its latest reference
+ was before vtime, -1 otherwise.
+ */
+static inline int rs_oldest_before(const struct ResidentSets* rs, unsigned pid, long vtime) {
+    int frame_no = rs->processes[pid].resident.head;
+    return frame_no >= 0 && rs->last_ref[frame_no] < vtime ? frame_no : -1;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <stdint.h>
+
+/**
+ Spatial sampling of a page reference string in the manner of SHARDS
+ (Waldspurger et al., FAST '15). A page is in the sample when a hash of its
+ number, taken modulo 2^24, falls below rate * 2^24; every access to a
+ sampled page is kept and every access to any other page dropped. Reuse
+ between sampled pages is therefore seen in full, and the sampled reference
+ string behaves like the whole one run against a memory rate times the size:
+ a stack distance d in the sample stands for about d / rate in the trace.
+ */
+#define SAMPLE_MODULUS (UINT64_C(1) << 24)
+
+/**
+ Returns the hash threshold of a sampling rate in (0, 1].
+ */
+static inline uint64_t sample_threshold(double rate) {
+    return (uint64_t) (rate * SAMPLE_MODULUS + 0.5);
+}
+
+/**
+ Returns whether page is in the sample of threshold. The hash is the
+ MurmurHash3 finalizer, so neighbouring pages are sampled independently.
+ */
+static inline int sample_page(uint64_t threshold, uint64_t page) {
+    page ^= page >> 33;
+    page *= UINT64_C(0xff51afd7ed558ccd);
+    page ^= page >> 33;
+    page *= UINT64_C(0xc4ceb9fe1a85ec53);
+    page ^= page >> 33;
+    return (page & (SAMPLE_MODULUS - 1)) < threshold;
+}
+
+#endif
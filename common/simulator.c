@@ -0,0 +1,1845 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "simulator.h"
+#include "stack_distance.h"
+#include "trace.h"
+
+static void tier_write_back(void* ctx, long page_no, void* data);
+static int sim_init_exact(struct Simulator* sim);
+
+#define SIM_CHECKPOINT_CHUNK 65536  // accesses between checks for a checkpoint requested by signal
+#define SIM_STORE_CHUNK (1 << 20)   // bytes of the backing store image copied at a time
+#define SIM_SAMPLE_CHUNK 4096       // sampled records gathered before they are translated
+
+/**
+ Fills config with the geometry of the original assignment: 16-bit addresses,
+ 256-byte pages, one frame per page and a fully associative 16-entry FIFO TLB.
+ */
+void sim_default_config(struct SimConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->address_bits = 16;
+    config->page_size = 256;
+    config->num_frames = 0;
+    config->tlb_sets = 1;
+    config->tlb_ways = 16;
+    config->policy = "fifo";
+    config->back_store = "stdio";
+    config->prefetch_streams = 8;
+    config->output_format = OUTPUT_TEXT;
+    config->sample_every = 1;
+    config->num_processes = 1;
+    config->shootdown_batch = 1;
+    config->core_quantum = 64;
+    config->rs_interval = 1000;
+    config->huge_tlb_entries = 8;
+    config->promote_misses = 4;
+    config->sample_rate = 1;
+    config->page_runs = 1;
+}
+
+/**
+ Returns size scaled down by a sampling rate, rounded, and at least min.
+ */
+static int sim_sample_size(int size, double rate, int min) {
+    long scaled = (long) (size * rate + 0.5);
+    return scaled < min ? min : (int) scaled;
+}
+
+/**
+ Scales a TLB of *sets x *ways down by a sampling rate: the total number of
+ entries becomes sets x ways x rate, rounded, with the number of sets still a
+ power of two. Sets go before ways, keeping the associativity where it can.
+ Returns -1 if the scaled TLB would have no entries.
+ */
+static int sim_sample_tlb(int* sets, int* ways, double rate) {
+    long entries = (long) ((double) *sets * *ways * rate + 0.5);
+    if (entries < 1) {
+        return -1;
+    }
+    int scaled_sets = *sets;
+    while (scaled_sets > 1 && (long) scaled_sets * *ways > entries) {
+        scaled_sets /= 2;
+    }
+    *ways = (int) ((entries + scaled_sets / 2) / scaled_sets);
+    *sets = scaled_sets;
+    return 0;
+}
+
+/**
+ Builds the TLB, page table, frame table and physical memory described by
+ config. Returns 0 on success; on failure prints the reason and returns -1.
+ parameters:
+ struct Simulator* sim: simulator to initialise
+ const struct SimConfig* config: geometry and policy
+ struct BackStore* back_store: open backing store, pages are read from and written to it
+ */
+int sim_init(struct Simulator* sim, const struct SimConfig* config, struct BackStore* back_store) {
+    memset(sim, 0, sizeof(*sim));
+    sim->config = *config;
+    sim->back_store = back_store;
+
+    if (config->address_bits < 1 || config->address_bits > TRACE_MAX_ADDRESS_BITS) {
+        fprintf(stderr, "Invalid address width %d bits\n", config->address_bits);
+        return -1;
+    }
+    sim->address_mask = (1UL << config->address_bits) - 1;
+    int page_size = config->page_size;
+    if (page_size < 1 || (unsigned long) page_size > sim->address_mask + 1) {
+        fprintf(stderr, "Invalid page size %d\n", page_size);
+        return -1;
+    }
+    sim->page_shift = -1;
+    if ((page_size & (page_size - 1)) == 0) {
+        sim->page_shift = __builtin_ctz(page_size);
+    }
+    sim->num_pages = (long) ((sim->address_mask + page_size) / page_size);
+    int vpn_bits = 1;
+    while ((1L << vpn_bits) < sim->num_pages) {
+        vpn_bits++;
+    }
+    sim->vpn_bits = vpn_bits;
+    // backing store offsets of every process's pages must fit in a long
+    if (config->num_processes < 1 || config->num_processes > TRACE_MAX_PROCESSES ||
+        (double) config->num_processes * (1L << vpn_bits) * page_size >= (double) LONG_MAX) {
+        fprintf(stderr, "Invalid number of processes %d\n", config->num_processes);
+        return -1;
+    }
+    int num_partitions = config->local_replacement ? config->num_processes : 1;
+    if (!(config->sample_rate > 0 && config->sample_rate <= 1) ||
+        sample_threshold(config->sample_rate) == 0 ||
+        (config->sample_check && config->sample_rate == 1)) {
+        fprintf(stderr, "Invalid sample rate %f\n", config->sample_rate);
+        return -1;
+    }
+    if (config->num_frames < 0 ||
+        (config->num_frames == 0 && sim->num_pages * config->num_processes > INT_MAX) ||
+        (config->num_frames > 0 && config->num_frames < num_partitions)) {
+        fprintf(stderr, "Invalid number of frames %d\n", config->num_frames);
+        return -1;
+    }
+    sim->num_frames = config->num_frames > 0 ? config->num_frames
+                                             : (int) (sim->num_pages * config->num_processes);
+    // a sample of the pages runs against a memory and TLB smaller by the same rate
+    int tlb_sets = config->tlb_sets;
+    int tlb_ways = config->tlb_ways;
+    if (config->sample_rate < 1) {
+        sim->sample_threshold = sample_threshold(config->sample_rate);
+        if (config->num_frames > 0) {
+            sim->num_frames = sim_sample_size(config->num_frames, config->sample_rate,
+                                              num_partitions);
+        }
+        if (tlb_sets >= 1 && tlb_ways >= 1 &&
+            sim_sample_tlb(&tlb_sets, &tlb_ways, config->sample_rate)) {
+            // the curves do not use the TLB, so one entry does for them
+            if (!config->mrc) {
+                fprintf(stderr, "A TLB of %d entries is too small to sample at rate %f\n",
+                        config->tlb_sets * config->tlb_ways, config->sample_rate);
+                return -1;
+            }
+            tlb_sets = tlb_ways = 1;
+        }
+        // the translations of a sample are of no use, only its statistics
+        sim->config.quiet = 1;
+    }
+    if (sim->num_frames > PTE_MAX_FRAMES) {
+        fprintf(stderr, "%d frames do not fit in a page table entry\n", sim->num_frames);
+        return -1;
+    }
+
+    // write-behind writes the file directly; zero-copy frames have nothing to queue
+    sim->back_store_size = back_store->size;
+    sim->write_behind_fd = -1;
+    if (config->write_behind < 0 ||
+        (config->write_behind > 0 &&
+         (back_store->zero_copy || (sim->write_behind_fd = back_store_direct_fd(back_store)) < 0))) {
+        fprintf(stderr, "Cannot queue %d pages for write-behind\n", config->write_behind);
+        return -1;
+    }
+
+    if (tlb_init(&sim->tlb, tlb_sets, tlb_ways)) {
+        fprintf(stderr, "Invalid TLB geometry: %d sets x %d ways\n",
+                config->tlb_sets, config->tlb_ways);
+        return -1;
+    }
+    if (config->tlb_lookup && tlb_set_lookup(&sim->tlb, config->tlb_lookup)) {
+        fprintf(stderr, "TLB lookup %s is not available for %d ways\n",
+                config->tlb_lookup, tlb_ways);
+        sim_free(sim);
+        return -1;
+    }
+    sim->processes = (struct Process *) calloc(config->num_processes, sizeof(struct Process));
+    if (!sim->processes) {
+        fprintf(stderr, "Cannot allocate %d processes\n", config->num_processes);
+        sim_free(sim);
+        return -1;
+    }
+    for (int p = 0; p < config->num_processes; p++) {
+        struct Process* process = &sim->processes[p];
+        process->partition = config->local_replacement ? p : 0;
+        sim->num_processes++;
+        if (page_table_init(&process->page_table, vpn_bits, config->level_bits,
+                            config->num_levels, config->psc_entries)) {
+            fprintf(stderr, "Invalid page table for %d-bit page numbers\n", vpn_bits);
+            sim_free(sim);
+            return -1;
+        }
+    }
+    sim->physical_mem = (char *) malloc((size_t) sim->num_frames * page_size);
+    sim->frame_mem = (char **) malloc(sim->num_frames * sizeof(char *));
+    if (!sim->config.quiet &&
+        output_init(&sim->output, STDOUT_FILENO, config->output_format, config->sample_every)) {
+        fprintf(stderr, "Invalid output: format %d, every %ld accesses\n",
+                config->output_format, config->sample_every);
+        sim_free(sim);
+        return -1;
+    }
+    if (!sim->physical_mem || !sim->frame_mem || page_map_init(&sim->spill_index, 16) ||
+        (config->write_behind > 0 &&
+         write_behind_init(&sim->write_behind, config->write_behind, page_size))) {
+        fprintf(stderr, "Cannot allocate %d frames of %d bytes\n", sim->num_frames, page_size);
+        sim_free(sim);
+        return -1;
+    }
+    if (frame_table_init(&sim->frame_table, sim->num_frames, num_partitions, config->policy)) {
+        fprintf(stderr, "Unknown replacement policy %s\n", config->policy);
+        sim_free(sim);
+        return -1;
+    }
+    // a policy that looks ahead in the trace only knows the next use of the faulting page
+    if (config->prefetch < 0 ||
+        (config->prefetch > 0 &&
+         (frame_table_policy_ops(&sim->frame_table)->prepare ||
+          prefetcher_init(&sim->prefetcher, config->prefetch, config->prefetch_streams)))) {
+        fprintf(stderr, "Cannot prefetch %d pages with %d streams and policy %s\n",
+                config->prefetch, config->prefetch_streams, config->policy);
+        sim_free(sim);
+        return -1;
+    }
+    // resident sets are sized across the whole frame pool
+    int rs_mode = config->working_set > 0 ? RS_WORKING_SET
+                  : config->pff_upper > 0 ? RS_PFF : RS_NONE;
+    if (config->working_set < 0 || (config->working_set > 0 && config->pff_upper > 0) ||
+        config->pff_lower < 0 || (config->pff_lower > 0 && config->pff_lower >= config->pff_upper) ||
+        (rs_mode != RS_NONE &&
+         (num_partitions > 1 || rs_init(&sim->resident_sets, rs_mode, sim->num_frames,
+                                        config->num_processes, config->rs_interval,
+                                        config->rs_series)))) {
+        fprintf(stderr, "Invalid resident-set control: window %ld, thresholds %f to %f, "
+                "every %ld accesses\n", config->working_set, config->pff_lower,
+                config->pff_upper, config->rs_interval);
+        sim_free(sim);
+        return -1;
+    }
+    sim->resident_sets.tau = config->working_set;
+    sim->resident_sets.pff_lower = config->pff_lower;
+    sim->resident_sets.pff_upper = config->pff_upper;
+    // zero-copy frames are the store itself, there is nothing to compress
+    if (config->compressed_tier < 0 ||
+        (config->compressed_tier > 0 &&
+         (back_store->zero_copy ||
+          ctier_init(&sim->tier, config->compressed_tier, page_size, tier_write_back, sim)))) {
+        fprintf(stderr, "Invalid compressed tier of %ld bytes\n", config->compressed_tier);
+        sim_free(sim);
+        return -1;
+    }
+    // a region must not span two processes
+    if (config->huge_pages != 0 &&
+        (config->huge_pages > (1L << vpn_bits) ||
+         huge_init(&sim->huge, config->huge_pages, config->huge_tlb_entries,
+                   config->promote_misses))) {
+        fprintf(stderr, "Invalid huge pages: %d base pages, %d TLB entries, promotion after "
+                "%d misses\n", config->huge_pages, config->huge_tlb_entries,
+                config->promote_misses);
+        sim_free(sim);
+        return -1;
+    }
+#ifdef VMM_STATS
+    if (stats_init(&sim->stats, config->stats_interval)) {
+        fprintf(stderr, "Invalid statistics interval %ld\n", config->stats_interval);
+        sim_free(sim);
+        return -1;
+    }
+#else
+    if (config->stats_file) {
+        fprintf(stderr, "Statistics export is not built in, rebuild with make STATS=1\n");
+        sim_free(sim);
+        return -1;
+    }
+#endif
+    if (config->checkpoint_every < 0 ||
+        (config->checkpoint_every > 0 && !config->checkpoint_file)) {
+        fprintf(stderr, "Invalid checkpoint interval %ld\n", config->checkpoint_every);
+        sim_free(sim);
+        return -1;
+    }
+    if (config->checkpoint_file) {
+        ckpt_catch_signal(SIGUSR1);
+    }
+    // a sample stands in for the whole trace only where sizes scale with it
+    if (config->sample_rate < 1 &&
+        (config->prefetch > 0 || rs_mode != RS_NONE || config->compressed_tier > 0 ||
+         config->huge_pages > 0 || config->checkpoint_file || config->restore_file)) {
+        fprintf(stderr, "Sampling supports neither prefetching, resident-set control, the "
+                "compressed tier, huge pages nor checkpoints\n");
+        sim_free(sim);
+        return -1;
+    }
+    if (config->sample_check && !config->mrc && sim_init_exact(sim)) {
+        fprintf(stderr, "Cannot set up the full simulation to check the sample against\n");
+        sim_free(sim);
+        return -1;
+    }
+    for (int i = 0; i < sim->num_frames; i++) {
+        sim->frame_mem[i] = sim->physical_mem + (size_t) i * page_size;
+    }
+    return 0;
+}
+
+void sim_free(struct Simulator* sim) {
+    if (sim->exact) {
+        sim_free(sim->exact);
+        back_store_close(sim->exact_store);
+        free(sim->exact);
+        free(sim->exact_store);
+        sim->exact = NULL;
+        sim->exact_store = NULL;
+    }
+    sim_flush(sim);
+    ctier_free(&sim->tier);
+    write_behind_free(&sim->write_behind);
+    prefetcher_free(&sim->prefetcher);
+    rs_free(&sim->resident_sets);
+    huge_free(&sim->huge);
+    STATS(stats_free(&sim->stats));
+    output_free(&sim->output);
+    tlb_free(&sim->tlb);
+    frame_table_free(&sim->frame_table);
+    for (int p = 0; p < sim->num_processes; p++) {
+        page_table_free(&sim->processes[p].page_table);
+    }
+    free(sim->processes);
+    sim->processes = NULL;
+    sim->num_processes = 0;
+    page_map_free(&sim->spill_index);
+    free(sim->physical_mem);
+    free(sim->frame_mem);
+    free(sim->spill_mem);
+    sim->physical_mem = NULL;
+    sim->frame_mem = NULL;
+    sim->spill_mem = NULL;
+}
+
+/**
+ Sets up the full simulation a sampled one is checked against: the same
+ configuration without sampling that only counts, on a private copy of the
+ backing store, so the file sees the writes of the sampled run alone.
+ Returns 0 on success.
+ */
+static int sim_init_exact(struct Simulator* sim) {
+    struct SimConfig config = sim->config;
+    config.sample_rate = 1;
+    config.sample_check = 0;
+    config.quiet = 1;
+    config.write_behind = 0;
+    config.stats_file = NULL;
+    long size = sim->back_store_size;
+    char* data = (char *) malloc(size > 0 ? size : 1);
+    struct BackStore* store = (struct BackStore *) calloc(1, sizeof(struct BackStore));
+    struct Simulator* exact = (struct Simulator *) malloc(sizeof(struct Simulator));
+    int ret = -1;
+    if (data && store && exact && back_store_read(sim->back_store, data, 0, size) == 0 &&
+        back_store_open_memory(store, data, size) == 0) {
+        ret = sim_init(exact, &config, store);
+    }
+    free(data);
+    if (ret) {
+        if (store) {
+            back_store_close(store);
+        }
+        free(store);
+        free(exact);
+        return -1;
+    }
+    sim->exact = exact;
+    sim->exact_store = store;
+    return 0;
+}
+
+/**
+ Keeps pages beyond the end of the backing store in memory. A page that was
+ never written back reads as zeros, like a fresh anonymous page.
+ */
+static void spill_page_data(struct Simulator* sim, void* memory, long page_num, int is_write) {
+    int page_size = sim->config.page_size;
+    int slot = page_map_get(&sim->spill_index, page_num);
+    if (!is_write) {
+        if (slot >= 0) {
+            memcpy(memory, sim->spill_mem + (size_t) slot * page_size, page_size);
+        } else {
+            memset(memory, 0, page_size);
+        }
+        return;
+    }
+    if (slot < 0) {
+        if (sim->num_spilled == sim->spill_cap) {
+            int cap = sim->spill_cap ? 2 * sim->spill_cap : 16;
+            char * spill_mem = (char *) realloc(sim->spill_mem, (size_t) cap * page_size);
+            if (!spill_mem) {
+                fprintf(stderr, "Cannot keep %d pages past the end of the back store\n", cap);
+                sim->failed = 1;
+                return;
+            }
+            sim->spill_mem = spill_mem;
+            sim->spill_cap = cap;
+        }
+        slot = sim->num_spilled++;
+        page_map_put(&sim->spill_index, page_num, slot);
+    }
+    memcpy(sim->spill_mem + (size_t) slot * page_size, memory, page_size);
+}
+
+/**
+ This function reads/writes pages through the backing store. A page may extend past the end of
+ the backing store when the page size does not divide it; the missing bytes
+ read as zero and are not written back. Wide address spaces are much larger
+ than the backing store; pages entirely past its end go to spill_page_data.
+ An I/O error is reported and sets sim->failed; a page that cannot be read
+ reads as zeros.
+ */
+static void read_write_page_data(struct Simulator* sim, void* memory, long page_num, int is_write) {
+    int page_size = sim->config.page_size;
+    long start = page_num * page_size;
+    if (start >= sim->back_store_size) {
+        spill_page_data(sim, memory, page_num, is_write);
+        return;
+    }
+    if (sim->write_behind.capacity > 0) {
+        // queued pages are newer than the file
+        if (is_write) {
+            // several dirty pages can leave the compressed tier for one eviction
+            if (sim->write_behind.num_queued == sim->write_behind.capacity) {
+                write_behind_flush(&sim->write_behind, sim->write_behind_fd,
+                                   sim->back_store_size);
+            }
+            write_behind_put(&sim->write_behind, page_num, memory);
+            return;
+        }
+        const char * queued = write_behind_find(&sim->write_behind, page_num);
+        if (queued) {
+            memcpy(memory, queued, page_size);
+            return;
+        }
+    }
+    long len = sim->back_store_size - start < page_size ? sim->back_store_size - start : page_size;
+
+    if (is_write) {
+        // printf("Writing page 0x%04X\n", page_num * PAGE_SIZE);
+        if (back_store_write(sim->back_store, memory, start, len)) {
+            fprintf(stderr, "Cannot write to back store: %s\n",
+                    strerror(errno));
+            sim->failed = 1;
+        }
+    } else {
+        // printf("Reading page 0x%04X\n", page_num * PAGE_SIZE);
+        if (back_store_read(sim->back_store, memory, start, len)) {
+            fprintf(stderr, "Cannot read from back store: %s\n",
+                    strerror(errno));
+            sim->failed = 1;
+            len = 0;
+        }
+        memset((char *) memory + len, 0, page_size - len);
+    }
+}
+
+/**
+ Hands the dirty bits held in entry index of the huge-page TLB to the frame
+ table, before the entry goes.
+ */
+static void huge_write_dirty(struct Simulator* sim, int index) {
+    struct HugePages* huge = &sim->huge;
+    struct PTE* ptes = &huge->ptes[(long) index << huge->shift];
+    for (int i = 0; i < huge->pages_per_huge; i++) {
+        if (ptes[i].dirty) {
+            sim->frame_table.frames[ptes[i].frame_no].dirty = 1;
+        }
+    }
+}
+
+/**
+ Counts the eviction of page tag from its region. A promoted region is
+ demoted and its huge-page TLB entry invalidated.
+ */
+static void huge_evict_page(struct Simulator* sim, long tag) {
+    struct HugePages* huge = &sim->huge;
+    struct HugeRegion* region = huge_region(huge, tag);
+    region->resident--;
+    region->misses = 0;
+    if (region->promoted) {
+        region->promoted = 0;
+        huge->num_demotions++;
+        int index = tlb_find_entry(&huge->tlb, tag >> huge->shift);
+        if (index >= 0) {
+            huge_write_dirty(sim, index);
+            tlb_remove_entry(&huge->tlb, tag >> huge->shift);
+        }
+    }
+}
+
+/**
+ Loads the huge-page TLB entry of the promoted region of logical_pg of process
+ pid, tagged tag, with copies of the PTEs of all its base pages. Returns the
+ copy for logical_pg.
+ */
+static struct PTE* huge_fill(struct Simulator* sim, unsigned pid, long logical_pg, long tag) {
+    struct HugePages* huge = &sim->huge;
+    struct PageTable* page_table = &sim->processes[pid].page_table;
+    struct PTE region_pte = { 0, 1, 0, 1, PTE_PROT_READ | PTE_PROT_WRITE };
+    struct TLBE evicted;
+    int index = (int) (tlb_add_entry(&huge->tlb, tag >> huge->shift, region_pte, &evicted) -
+                       huge->tlb.ptes);
+    if (evicted.pte.valid) {
+        huge_write_dirty(sim, index);
+    }
+    struct PTE* ptes = &huge->ptes[(long) index << huge->shift];
+    long first = logical_pg & ~(long) (huge->pages_per_huge - 1);
+    for (int i = 0; i < huge->pages_per_huge; i++) {
+        ptes[i] = *page_table_get(page_table, first + i);
+        ptes[i].dirty = sim->frame_table.frames[ptes[i].frame_no].dirty;
+    }
+    return &ptes[logical_pg - first];
+}
+
+/**
+ Promotes the region of tag, all of whose pages are resident: the base TLB
+ entries of its pages go, their dirty bits to the frame table.
+ */
+static void huge_promote(struct Simulator* sim, long tag, struct HugeRegion* region) {
+    struct HugePages* huge = &sim->huge;
+    long first = tag & ~(long) (huge->pages_per_huge - 1);
+    for (long page = first; page < first + huge->pages_per_huge; page++) {
+        int index = tlb_find_entry(&sim->tlb, page);
+        if (index >= 0) {
+            if (sim->tlb.ptes[index].dirty) {
+                sim->frame_table.frames[sim->tlb.ptes[index].frame_no].dirty = 1;
+            }
+            tlb_remove_entry(&sim->tlb, page);
+        }
+    }
+    region->promoted = 1;
+    huge->num_promotions++;
+}
+
+/**
+ Writes a dirty page pushed out of the compressed tier to the backing store.
+ */
+static void tier_write_back(void* ctx, long page_no, void* data) {
+    read_write_page_data((struct Simulator *) ctx, data, page_no, 1);
+}
+
+/**
+ Evicts the page held by frame_no: writes it back if it is dirty, in the frame table or in its
+ TLB entry, invalidates its page table entry and removes it from the TLB. The frame table names
+ the owner page, so this takes constant time.
+ parameters:
+ struct Simulator* sim: simulator owning the frame
+ int frame_no: victim frame
+ */
+static void evict_frame(struct Simulator* sim, int frame_no) {
+    struct Frame* victim = &sim->frame_table.frames[frame_no];
+    if (victim->page_no < 0) {
+        return;
+    }
+    STATS(sim->stats.num_evictions++; stats_page(&sim->stats, victim->page_no)->evictions++);
+    if (sim->huge.pages_per_huge > 0) {
+        huge_evict_page(sim, victim->page_no);
+    }
+    // a write may so far be recorded only in the TLB copy of the entry
+    int tlb_index = tlb_find_entry(&sim->tlb, victim->page_no);
+    if (tlb_index >= 0 && sim->tlb.ptes[tlb_index].dirty) {
+        victim->dirty = 1;
+    }
+    // the compressed tier takes the page if it compresses, clean or dirty
+    if (sim->tier.budget > 0 &&
+        ctier_store(&sim->tier, victim->page_no, sim->frame_mem[frame_no], victim->dirty) == 0) {
+        victim->dirty = 0;
+    }
+    sim->failed |= sim->tier.failed;
+    if (victim->dirty) {
+        //will need to write the frame to the BACKING STORE
+        STATS_TIMER_START(write_start);
+        read_write_page_data(sim, sim->frame_mem[frame_no], victim->page_no, 1);
+        STATS_TIMER_STOP(&sim->stats, STATS_WRITE_BACK, write_start);
+        STATS(sim->stats.num_write_backs++;
+              stats_page(&sim->stats, victim->page_no)->write_backs++);
+        victim->dirty = 0;
+    }
+    //remove frame_no from physical memory
+    victim->pte->valid = 0;
+    victim->pte->referenced = 0;
+    victim->pte->frame_no = -1;
+    // remove logical page from tlb
+    tlb_remove_entry(&sim->tlb, victim->page_no);
+    if (sim->resident_sets.mode != RS_NONE) {
+        rs_evict(&sim->resident_sets, frame_no, victim->page_no >> sim->vpn_bits);
+    }
+    frame_table_release(&sim->frame_table, frame_no);
+}
+
+/**
+ Reads page_no, a tagged page (see sim_tag), from the backing store into
+ frame_no and maps it. In zero-copy
+ mode the frame becomes a window on the mapped backing store instead.
+ */
+static void load_page(struct Simulator* sim, int frame_no, long page_no, struct PTE* table_entry,
+                      long now) {
+    int page_size = sim->config.page_size;
+    char* alias = back_store_alias(sim->back_store, page_no * page_size, page_size);
+    sim->frame_mem[frame_no] = alias ? alias : sim->physical_mem + (size_t) frame_no * page_size;
+    STATS_TIMER_START(read_start);
+    // a page served from the compressed tier may be newer than the store
+    int dirty = 0;
+    if (sim->tier.budget == 0 ||
+        ctier_load(&sim->tier, page_no, sim->frame_mem[frame_no], &dirty)) {
+        read_write_page_data(sim, sim->frame_mem[frame_no], page_no, 0);
+    }
+    sim->failed |= sim->tier.failed;
+    STATS_TIMER_STOP(&sim->stats, STATS_PAGE_IN, read_start);
+    frame_table_assign(&sim->frame_table, frame_no, page_no, table_entry, now);
+    sim->frame_table.frames[frame_no].dirty = dirty;
+    table_entry->frame_no = frame_no;
+    table_entry->valid = 1;
+    table_entry->referenced = 1;
+    table_entry->prot = PTE_PROT_READ | PTE_PROT_WRITE;
+    if (sim->huge.pages_per_huge > 0) {
+        huge_region(&sim->huge, page_no)->resident++;
+    }
+    if (sim->resident_sets.mode != RS_NONE) {
+        unsigned pid = page_no >> sim->vpn_bits;
+        rs_load(&sim->resident_sets, frame_no, pid, sim->processes[pid].num_entries);
+    }
+    // a full write-behind queue is flushed only after the page is in
+    if (sim->write_behind.capacity > 0 &&
+        sim->write_behind.num_queued == sim->write_behind.capacity) {
+        write_behind_flush(&sim->write_behind, sim->write_behind_fd, sim->back_store_size);
+    }
+}
+
+/**
+ Trains the prefetcher on page_no and, if it sees a stride, loads the pages
+ that follow along it. Prefetching happens after the access to page_no has
+ been served, so it never delays it: the simulated equivalent of issuing the
+ reads asynchronously. Prefetched pages take free frames or evict through the
+ replacement policy like any page-in, but never evict the frame of page_no,
+ and are not counted as faults.
+ parameters:
+ struct Simulator* sim: simulator state
+ unsigned pid: process the page belongs to
+ long page_no: page that faulted, or a prefetched page referenced for the first time
+ int frame_no: frame holding page_no
+ long now: position of the access in the trace
+ */
+static void prefetch_pages(struct Simulator* sim, unsigned pid, long page_no, int frame_no,
+                           long now) {
+    struct Prefetcher* prefetcher = &sim->prefetcher;
+    struct FrameTable* frame_table = &sim->frame_table;
+    struct Process* process = &sim->processes[pid];
+    long stride = prefetcher_train(prefetcher, sim_tag(sim, pid, page_no));
+    if (stride == 0) {
+        return;
+    }
+    for (int k = 1; k <= prefetcher->degree; k++) {
+        long target = page_no + k * stride;
+        if (target < 0 || target >= sim->num_pages) {
+            break;
+        }
+        struct PTE* table_entry = page_table_get(&process->page_table, target);
+        if (table_entry->valid) {
+            continue;
+        }
+        long target_tag = sim_tag(sim, pid, target);
+        int target_frame = frame_table_alloc(frame_table, process->partition);
+        if (target_frame < 0) {
+            target_frame = frame_table_select_victim(frame_table, process->partition, target_tag);
+            if (target_frame == frame_no) {
+                // memory is too small to hold the stream ahead of its use
+                break;
+            }
+            evict_frame(sim, target_frame);
+        }
+        load_page(sim, target_frame, target_tag, table_entry, now);
+        // not referenced until the process gets to it
+        table_entry->referenced = 0;
+        frame_table->frames[target_frame].prefetched = 1;
+        prefetcher->num_issued++;
+    }
+}
+
+/**
+ Evicts frame_no on behalf of the resident-set controller and frees it.
+ */
+static void release_frame(struct Simulator* sim, int frame_no) {
+    evict_frame(sim, frame_no);
+    frame_table_recycle(&sim->frame_table, frame_no);
+    sim->resident_sets.num_released++;
+}
+
+/**
+ Chooses the frame a page fault of process pid loads tag into while a
+ resident-set controller runs. Under page-fault frequency the fault rate
+ decides whether the resident set shrinks, keeps its size by replacing its own
+ oldest page, or grows. A resident set grows into a free frame if there is
+ one, or else evicts the global policy's victim, a page some resident set
+ still wants.
+ */
+static int resident_set_fault(struct Simulator* sim, unsigned pid, long tag) {
+    struct ResidentSets* rs = &sim->resident_sets;
+    struct RsProcess* rs_process = &rs->processes[pid];
+    struct FrameTable* frame_table = &sim->frame_table;
+    if (rs->mode == RS_PFF) {
+        rs_process->prev_fault = rs_process->last_fault;
+        rs_process->last_fault = sim->processes[pid].num_entries;
+        // the fault rate is 1 / gap
+        long gap = rs_process->last_fault - rs_process->prev_fault;
+        if (gap * rs->pff_lower > 1.0) {
+            int frame_no;
+            while ((frame_no = rs_oldest_before(rs, pid, rs_process->prev_fault)) >= 0) {
+                release_frame(sim, frame_no);
+            }
+        } else if (gap * rs->pff_upper >= 1.0 && rs_process->resident.size > 0) {
+            int frame_no = rs_process->resident.head;
+            evict_frame(sim, frame_no);
+            return frame_no;
+        }
+    }
+    int frame_no = frame_table_alloc(frame_table, 0);
+    if (frame_no < 0) {
+        // the resident sets no longer fit in memory
+        frame_no = frame_table_select_victim(frame_table, 0, tag);
+        evict_frame(sim, frame_no);
+        rs->num_forced++;
+        rs->interval_forced++;
+    }
+    return frame_no;
+}
+
+/**
+ Samples every process's resident set at trace position now.
+ */
+static void sample_resident_sets(struct Simulator* sim, long now) {
+    for (int p = 0; p < sim->num_processes; p++) {
+        rs_sample(&sim->resident_sets, now, p, sim->processes[p].num_entries,
+                  sim->processes[p].page_table.num_faults);
+    }
+    rs_end_interval(&sim->resident_sets);
+}
+
+/**
+ Tells the resident-set controller that process pid referenced frame_no at
+ trace position now. Under the working-set policy, the process's pages that
+ just left the window are released.
+ */
+static void resident_set_access(struct Simulator* sim, unsigned pid, int frame_no, long now) {
+    struct ResidentSets* rs = &sim->resident_sets;
+    long vtime = sim->processes[pid].num_entries;
+    rs_touch(rs, frame_no, pid, vtime);
+    if (rs->mode == RS_WORKING_SET) {
+        int oldest;
+        while ((oldest = rs_oldest_before(rs, pid, vtime - rs->tau + 1)) >= 0) {
+            release_frame(sim, oldest);
+        }
+    }
+    if (now + 1 == rs->next_sample) {
+        sample_resident_sets(sim, now + 1);
+    }
+}
+
+/**
+ Gets table entry from either TLB or, if not found in TLB then walks the page table. Handles page
+ fault if not found in page table. Finally (if it was not found in TLB) updates TLB and returns the
+ new TLB entry.
+ parameters:
+ struct Simulator* sim: TLB, page tables, frame pool and backing store to use
+ unsigned pid: process making the access
+ long logical_pg: the logical_pg to be searched
+ long now: position of this access in the trace, for the replacement policy
+ int* tlb_index: set to the index of the returned entry in sim->tlb, or -1 if it is not
+                 in the base TLB (a huge-page TLB entry)
+ */
+static struct PTE* get_table_entry(struct Simulator* sim, unsigned pid, long logical_pg, long now,
+                                   int* tlb_index) {
+    struct Tlb* tlb_table = &sim->tlb;
+    struct Process* process = &sim->processes[pid];
+    struct PageTable* page_table = &process->page_table;
+    struct FrameTable* frame_table = &sim->frame_table;
+    // the TLB, frame table and backing store know the page by its ASID-tagged number
+    long tag = sim_tag(sim, pid, logical_pg);
+
+    STATS(stats_access(&sim->stats, tag, now));
+    STATS_TIMER_START(lookup_start);
+    *tlb_index = tlb_find_entry(tlb_table, tag);
+    STATS_TIMER_STOP(&sim->stats, STATS_TLB_LOOKUP, lookup_start);
+    if (*tlb_index >= 0) {
+        // found
+        tlb_table->num_hits++;
+        process->num_tlb_hits++;
+        frame_table_touch(frame_table, tlb_table->ptes[*tlb_index].frame_no, now);
+        return &tlb_table->ptes[*tlb_index];
+    }
+    if (sim->huge.pages_per_huge > 0) {
+        struct PTE* huge_pte = huge_find(&sim->huge, tag);
+        if (huge_pte) {
+            tlb_table->num_hits++;
+            process->num_tlb_hits++;
+            sim->huge.num_hits++;
+            frame_table_touch(frame_table, huge_pte->frame_no, now);
+            frame_table->frames[huge_pte->frame_no].prefetched = 0;
+            return huge_pte;
+        }
+    }
+
+    // tlb did not find logical page
+    // translate from page table to frame
+    STATS_TIMER_START(walk_start);
+    struct PTE* table_entry = page_table_walk(page_table, logical_pg);
+    STATS_TIMER_STOP(&sim->stats, STATS_PAGE_WALK, walk_start);
+    if(!table_entry->valid) {
+        //page fault: the entry in the page table at logical_pg is not valid
+        //read in logical_pg from BACKING STORE and store it in physical memory
+        //First, need to check if there is a free frame in physical memory
+        //If there are no free frames, must perform page replacement, aka:
+        //Replace one of the frames in physical memory with logical_pg that is read from the.
+        //BACKING STORE. Before replacing it, may need to write the frame in physical mem
+        //into the BACKING STORE - that is, if this frame has been modified since its last load.
+        int frame_no;
+        if (sim->resident_sets.mode != RS_NONE) {
+            frame_no = resident_set_fault(sim, pid, tag);
+        } else if ((frame_no = frame_table_alloc(frame_table, process->partition)) < 0) {
+            // there are no free frames in physical memory
+            //must perform page replacement, the policy picks the victim
+            frame_no = frame_table_select_victim(frame_table, process->partition, tag);
+            evict_frame(sim, frame_no);
+        }
+
+        // We have a free frame to load page to
+        load_page(sim, frame_no, tag, table_entry, now);
+        page_table->num_faults++;
+        STATS(stats_page(&sim->stats, tag)->faults++);
+        if (sim->prefetcher.degree > 0) {
+            prefetch_pages(sim, pid, logical_pg, frame_no, now);
+        }
+    } else {
+        table_entry->referenced = 1;
+        frame_table_touch(frame_table, table_entry->frame_no, now);
+        // a prefetched page is never in the TLB before its first reference
+        struct Frame* frame = &frame_table->frames[table_entry->frame_no];
+        if (frame->prefetched) {
+            frame->prefetched = 0;
+            sim->prefetcher.num_useful++;
+            prefetch_pages(sim, pid, logical_pg, table_entry->frame_no, now);
+        }
+    }
+
+    // a dense region that keeps missing is promoted to a huge page
+    if (sim->huge.pages_per_huge > 0) {
+        struct HugeRegion* region = huge_region(&sim->huge, tag);
+        if (!region->promoted && region->resident == sim->huge.pages_per_huge &&
+            ++region->misses >= sim->huge.promote_misses) {
+            huge_promote(sim, tag, region);
+        }
+        if (region->promoted) {
+            return huge_fill(sim, pid, logical_pg, tag);
+        }
+    }
+
+    //update tlb, the cached entry carries the dirty state recorded in the frame table
+    struct PTE pte = *table_entry;
+    pte.dirty = frame_table->frames[pte.frame_no].dirty;
+    struct TLBE old_tlb_entry;
+    struct PTE* new_tlb_pte = tlb_add_entry(tlb_table, tag, pte, &old_tlb_entry);
+    // if removed tlb entry is dirty, we update the frame it maps
+    if (old_tlb_entry.pte.valid && old_tlb_entry.pte.dirty) {
+        frame_table->frames[old_tlb_entry.pte.frame_no].dirty = 1;
+    }
+    STATS(sim->stats.num_tlb_evictions += old_tlb_entry.pte.valid);
+
+    *tlb_index = (int) (new_tlb_pte - tlb_table->ptes);
+    return new_tlb_pte;
+}
+
+#ifdef VMM_STATS
+/**
+ Returns the running totals of the statistics counters.
+ */
+static struct StatsSnapshot sim_stats_totals(const struct Simulator* sim) {
+    struct StatsSnapshot totals = {
+        sim->num_entries, sim_num_faults(sim), sim->tlb.num_hits, sim->stats.num_evictions,
+        sim->stats.num_write_backs, sim->stats.num_tlb_evictions
+    };
+    return totals;
+}
+
+static void sim_snapshot_stats(struct Simulator* sim) {
+    struct StatsSnapshot totals = sim_stats_totals(sim);
+    stats_snapshot(&sim->stats, &totals);
+}
+
+/**
+ Writes the statistics to config.stats_file, closing the last interval if the
+ trace cut it short.
+ */
+static void sim_write_stats(struct Simulator* sim) {
+    struct SimStats* stats = &sim->stats;
+    if (stats->interval > 0 && sim->num_entries > stats->next_snapshot - stats->interval) {
+        sim_snapshot_stats(sim);
+    }
+    FILE* out = fopen(sim->config.stats_file, "w");
+    if (!out) {
+        fprintf(stderr, "Cannot write statistics to %s\n", sim->config.stats_file);
+        return;
+    }
+    struct StatsSnapshot totals = sim_stats_totals(sim);
+    stats_write(stats, out, sim->config.stats_format, &totals, sim->vpn_bits);
+    fclose(out);
+}
+#endif
+
+/**
+ Splits a logical address into page number and offset. With a constant
+ page_shift (>= 0) this folds into a shift and a mask; -1 selects divide and
+ modulo for page sizes that are not a power of two.
+ */
+#define SIM_PAGE_OF(addr, page_shift, page_size) \
+    ((page_shift) >= 0 ? (addr) >> (page_shift) : (addr) / (page_size))
+#define SIM_OFFSET_OF(addr, page_shift, page_size) \
+    ((page_shift) >= 0 ? (addr) & ((1UL << (page_shift)) - 1) : (addr) % (page_size))
+
+/**
+ Completes an access to the byte at offset in the frame pte maps: a write
+ increments the byte and dirties the page, then the translation is printed
+ if print is set and stored in *out if out is not NULL.
+ */
+static inline __attribute__((always_inline))
+void sim_access_byte(struct Simulator* sim, struct PTE* pte, unsigned long logical_addr,
+                     unsigned long offset, int write_bit, const int page_shift, const int print,
+                     struct VmmTranslation* out) {
+    unsigned long physical_addr = page_shift >= 0
+                                  ? ((unsigned long) pte->frame_no << page_shift) + offset
+                                  : pte->frame_no * sim->config.page_size + offset;
+    char* byte = sim->frame_mem[pte->frame_no] + offset;
+
+    if(write_bit) {
+        // page is dirty
+        (*byte)++;
+        pte->dirty = 1;
+    }
+
+    if (print) {
+        output_access(&sim->output, logical_addr, physical_addr, (int) *byte, pte->dirty);
+    }
+    if (out) {
+        out->physical_addr = physical_addr;
+        out->value = *byte;
+        out->dirty = pte->dirty;
+    }
+}
+
+/**
+ Translates a block of trace entries and, if print is set, prints one line per
+ access; if out is not NULL, stores the translation of record r in out[r].
+ Always inlined into sim_run and sim_translate, which call it with a literal
+ page_shift for the common page sizes so each of those gets its own
+ shift-and-mask loop.
+
+ Traces touch the same page many times in a row. With config.page_runs set,
+ the PTE of an access that ends up in the TLB is kept as a one-entry cache in
+ front of it, and the accesses after it that go to the same page of the same
+ process are translated through that PTE in a tight loop: no process check,
+ no TLB lookup, nothing evicted. Each still counts as a TLB hit and touches
+ its frame for the replacement policy, so every counter and every policy
+ decision is the one the full path would have made. The cache lives only for
+ the run; resident-set control, which may take pages away after any access,
+ turns it off.
+
+ Returns 0, or -1 once an access is by a process beyond num_processes or has
+ set sim->failed; the records after it are not translated.
+ */
+static inline __attribute__((always_inline))
+int sim_run_records(struct Simulator* sim, const uint64_t* records, size_t num_records,
+                     const int page_shift, const int print, struct VmmTranslation* out) {
+    const unsigned long page_size = sim->config.page_size;
+    const unsigned long address_mask = sim->address_mask;
+    const unsigned num_processes = sim->num_processes;
+    const int page_runs = sim->config.page_runs && sim->resident_sets.mode == RS_NONE;
+    struct Tlb* tlb_table = &sim->tlb;
+    for (size_t r = 0; r < num_records; r++) {
+        uint64_t record = records[r];
+        long now = sim->num_entries++;
+        //extract offset and page number
+        unsigned long logical_addr = trace_address(record) & address_mask;
+        int write_bit = trace_is_write(record);
+        unsigned pid = trace_pid(record);
+        if (pid >= num_processes) {
+            fprintf(stderr, "Access by process %u, but only %u processes are simulated\n",
+                    pid, num_processes);
+            return -1;
+        }
+        struct Process* process = &sim->processes[pid];
+        process->num_entries++;
+
+        unsigned long offset = SIM_OFFSET_OF(logical_addr, page_shift, page_size);
+        long logical_pg = SIM_PAGE_OF(logical_addr, page_shift, page_size);
+
+        int tlb_index;
+        struct PTE* pte = get_table_entry(sim, pid, logical_pg, now, &tlb_index);
+        if (sim->failed) {
+            return -1;
+        }
+        sim_access_byte(sim, pte, logical_addr, offset, write_bit, page_shift, print,
+                        out ? &out[r] : NULL);
+        // last, as releasing pages may move the TLB entry pte points to
+        if (sim->resident_sets.mode != RS_NONE) {
+            resident_set_access(sim, pid, pte->frame_no, now);
+        }
+        STATS(if (now + 1 == sim->stats.next_snapshot) {
+                  sim_snapshot_stats(sim);
+              });
+
+        // the rest of the run hits the TLB entry just used; huge-page entries are left to
+        // the full path, which also counts them as huge-page TLB hits
+        if (!page_runs || tlb_index < 0) {
+            continue;
+        }
+        while (r + 1 < num_records) {
+            record = records[r + 1];
+            logical_addr = trace_address(record) & address_mask;
+            if (trace_pid(record) != pid ||
+                SIM_PAGE_OF(logical_addr, page_shift, page_size) != (unsigned long) logical_pg) {
+                break;
+            }
+            r++;
+            now = sim->num_entries++;
+            process->num_entries++;
+            tlb_table->num_hits++;
+            process->num_tlb_hits++;
+            STATS(stats_access(&sim->stats, sim_tag(sim, pid, logical_pg), now);
+                  sim->stats.num_run_hits++);
+            frame_table_touch(&sim->frame_table, pte->frame_no, now);
+            sim_access_byte(sim, pte, logical_addr,
+                            SIM_OFFSET_OF(logical_addr, page_shift, page_size),
+                            trace_is_write(record), page_shift, print, out ? &out[r] : NULL);
+            STATS(if (now + 1 == sim->stats.next_snapshot) {
+                      sim_snapshot_stats(sim);
+                  });
+        }
+    }
+    // pages released after the last access may have failed to write back
+    return sim->failed ? -1 : 0;
+}
+
+#define SIM_RUN_CASE(shift) \
+    case shift: \
+        return print ? sim_run_records(sim, records, num_records, shift, 1, NULL) \
+                     : sim_run_records(sim, records, num_records, shift, 0, NULL);
+
+/**
+ Translates a block of trace entries, dispatching to a loop specialised for
+ the page size. Quiet simulators only count. Returns 0 or, on an error, -1.
+ */
+static int sim_run_block(struct Simulator* sim, const uint64_t* records, size_t num_records) {
+    const int print = !sim->config.quiet;
+    switch (sim->page_shift) {
+        SIM_RUN_CASE(6)
+        SIM_RUN_CASE(7)
+        SIM_RUN_CASE(8)
+        SIM_RUN_CASE(9)
+        SIM_RUN_CASE(10)
+        SIM_RUN_CASE(11)
+        SIM_RUN_CASE(12)
+        default:
+            return sim_run_records(sim, records, num_records, -1, print, NULL);
+    }
+}
+
+#define SIM_TRANSLATE_CASE(shift) \
+    case shift: \
+        return sim_run_records(sim, records, num_records, shift, 0, out);
+
+/**
+ Translates a block of trace entries into out, one translation per record,
+ without printing them. Checkpoints and sampling, which sim_run applies, do
+ not apply here: every record is translated.
+ parameters:
+ struct Simulator* sim: simulator state
+ const uint64_t* records: trace records (address in bits 0-47, write bit 63)
+ size_t num_records: number of records
+ struct VmmTranslation* out: num_records translations
+ Returns 0, or -1 with the reason on stderr if a record is by a process beyond
+ num_processes or an access hit an I/O or compressed-tier error. After an
+ error the simulator translates nothing more.
+ */
+int sim_translate(struct Simulator* sim, const uint64_t* records, size_t num_records,
+                  struct VmmTranslation* out) {
+    if (sim->failed) {
+        return -1;
+    }
+    switch (sim->page_shift) {
+        SIM_TRANSLATE_CASE(6)
+        SIM_TRANSLATE_CASE(7)
+        SIM_TRANSLATE_CASE(8)
+        SIM_TRANSLATE_CASE(9)
+        SIM_TRANSLATE_CASE(10)
+        SIM_TRANSLATE_CASE(11)
+        SIM_TRANSLATE_CASE(12)
+        default:
+            return sim_run_records(sim, records, num_records, -1, 0, out);
+    }
+}
+
+/**
+ Returns whether the page of record is in the sample of a sampled simulator.
+ */
+static inline int sim_samples(const struct Simulator* sim, uint64_t record) {
+    unsigned long logical_addr = trace_address(record) & sim->address_mask;
+    long page_no = SIM_PAGE_OF(logical_addr, sim->page_shift, sim->config.page_size);
+    return sample_page(sim->sample_threshold, sim_tag(sim, trace_pid(record), page_no));
+}
+
+/**
+ Translates the records of the pages in the sample, gathered a chunk at a
+ time, and counts the rest as skipped. Returns 0 or, on an error, -1.
+ */
+static int sim_run_sampled(struct Simulator* sim, const uint64_t* records, size_t num_records) {
+    uint64_t kept[SIM_SAMPLE_CHUNK];
+    size_t num_kept = 0;
+    for (size_t r = 0; r < num_records; r++) {
+        if (!sim_samples(sim, records[r])) {
+            sim->num_skipped++;
+            continue;
+        }
+        kept[num_kept++] = records[r];
+        if (num_kept == SIM_SAMPLE_CHUNK) {
+            if (sim_run_block(sim, kept, num_kept)) {
+                return -1;
+            }
+            num_kept = 0;
+        }
+    }
+    return sim_run_block(sim, kept, num_kept);
+}
+
+/**
+ Translates a block of trace entries. With checkpoints enabled the block is
+ cut at every checkpoint_every accesses, and every SIM_CHECKPOINT_CHUNK
+ accesses to see whether SIGUSR1 asked for one, and a checkpoint is written
+ at those points; a checkpoint that fails is reported and the run goes on.
+ parameters:
+ struct Simulator* sim: simulator state
+ const uint64_t* records: trace records (address in bits 0-47, write bit 63)
+ size_t num_records: number of records
+ Returns 0, or -1 with the reason on stderr if a record is by a process beyond
+ num_processes or an access hit an I/O or compressed-tier error.
+ */
+int sim_run(struct Simulator* sim, const uint64_t* records, size_t num_records) {
+    if (sim->failed) {
+        return -1;
+    }
+    if (sim->exact && sim_run(sim->exact, records, num_records)) {
+        return -1;
+    }
+    if (sim->sample_threshold) {
+        return sim_run_sampled(sim, records, num_records);
+    }
+    const char* path = sim->config.checkpoint_file;
+    if (!path) {
+        return sim_run_block(sim, records, num_records);
+    }
+    long every = sim->config.checkpoint_every;
+    while (num_records > 0) {
+        size_t n = num_records < SIM_CHECKPOINT_CHUNK ? num_records : SIM_CHECKPOINT_CHUNK;
+        if (every > 0 && (size_t) (every - sim->num_entries % every) < n) {
+            n = every - sim->num_entries % every;
+        }
+        if (sim_run_block(sim, records, n)) {
+            return -1;
+        }
+        records += n;
+        num_records -= n;
+        if ((ckpt_requested() || (every > 0 && sim->num_entries % every == 0)) &&
+            sim_checkpoint(sim, path)) {
+            fprintf(stderr, "Cannot write checkpoint %s after %ld accesses\n", path,
+                    sim->num_entries);
+        }
+    }
+    return 0;
+}
+
+/**
+ Writes back every dirty page still held in the write-behind queue. Frames
+ that are still resident are not written.
+ */
+void sim_flush(struct Simulator* sim) {
+    if (sim->tier.budget > 0) {
+        ctier_flush(&sim->tier);
+    }
+    if (sim->write_behind.capacity > 0) {
+        write_behind_flush(&sim->write_behind, sim->write_behind_fd, sim->back_store_size);
+    }
+}
+
+/**
+ Settings a checkpoint can only be restored under if they are the same. The
+ replacement policy, the TLB lookup method, the output and the backing store
+ backend may change; thresholds are compared bit for bit.
+ */
+static const char * const sim_echo_names[] = {
+    "address width", "page size", "number of frames", "number of processes",
+    "local replacement", "page-table levels", "paging-structure cache", "TLB sets", "TLB ways",
+    "write-behind queue", "zero-copy mode", "prefetch degree", "prefetch streams",
+    "working-set window", "lower PFF threshold", "upper PFF threshold", "resident-set interval",
+    "compressed tier", "huge pages", "huge-page TLB", "promotion misses", "backing store size",
+    "statistics build", "statistics interval"
+};
+
+#define SIM_ECHO_FIELDS (sizeof(sim_echo_names) / sizeof(sim_echo_names[0]))
+
+static void sim_config_echo(const struct Simulator* sim, int64_t* echo) {
+    const struct SimConfig* config = &sim->config;
+    int64_t pff_lower, pff_upper;
+    memcpy(&pff_lower, &config->pff_lower, sizeof(pff_lower));
+    memcpy(&pff_upper, &config->pff_upper, sizeof(pff_upper));
+    int64_t values[SIM_ECHO_FIELDS] = {
+        config->address_bits, config->page_size, sim->num_frames, sim->num_processes,
+        config->local_replacement, sim->processes[0].page_table.num_levels, config->psc_entries,
+        config->tlb_sets, config->tlb_ways, config->write_behind, config->zero_copy,
+        config->prefetch, config->prefetch_streams, config->working_set, pff_lower, pff_upper,
+        sim->resident_sets.mode != RS_NONE ? config->rs_interval : 0, config->compressed_tier,
+        config->huge_pages, config->huge_pages ? config->huge_tlb_entries : 0,
+        config->huge_pages ? config->promote_misses : 0, sim->back_store_size,
+#ifdef VMM_STATS
+        1, config->stats_interval
+#else
+        0, 0
+#endif
+    };
+    memcpy(echo, values, sizeof(values));
+}
+
+/**
+ Writes the whole simulator state to a checkpoint at path, taken after the
+ first num_entries records of the trace. The translations printed so far are
+ flushed first, so the output matches the checkpoint. Returns 0 on success,
+ -1 if the file cannot be written (any earlier checkpoint at path is kept).
+ */
+int sim_checkpoint(struct Simulator* sim, const char* path) {
+    int page_size = sim->config.page_size;
+    struct CkptWriter out;
+    if (sim->output.buffer) {
+        output_flush(&sim->output);
+    }
+    if (ckpt_create(&out, path)) {
+        return -1;
+    }
+    int64_t echo[SIM_ECHO_FIELDS];
+    sim_config_echo(sim, echo);
+    ckpt_begin(&out, CKPT_CONFIG, 0);
+    ckpt_write(&out, echo, sizeof(echo));
+
+    ckpt_begin(&out, CKPT_COUNTERS, 0);
+    for (int p = 0; p < sim->num_processes; p++) {
+        ckpt_write(&out, &sim->processes[p].num_entries, sizeof(long));
+        ckpt_write(&out, &sim->processes[p].num_tlb_hits, sizeof(long));
+    }
+    ckpt_write(&out, &sim->output.countdown, sizeof(sim->output.countdown));
+    ckpt_write(&out, &sim->output.num_written, sizeof(sim->output.num_written));
+
+    ckpt_begin(&out, CKPT_PAGE_TABLES, 0);
+    for (int p = 0; p < sim->num_processes; p++) {
+        page_table_save(&sim->processes[p].page_table, &out);
+    }
+    ckpt_begin(&out, CKPT_TLB, 0);
+    tlb_save(&sim->tlb, &out);
+    ckpt_begin(&out, CKPT_FRAMES, 0);
+    frame_table_save(&sim->frame_table, &out);
+    ckpt_begin(&out, CKPT_MEMORY, 1);
+    ckpt_write(&out, sim->physical_mem, (size_t) sim->num_frames * page_size);
+
+    // the store changes as pages are written back, part 1 only reads it
+    if (sim->back_store->writable) {
+        char* chunk = (char *) malloc(SIM_STORE_CHUNK);
+        if (!chunk) {
+            out.error = 1;
+        }
+        ckpt_begin(&out, CKPT_STORE, 1);
+        for (long start = 0; chunk && start < sim->back_store_size; start += SIM_STORE_CHUNK) {
+            long len = sim->back_store_size - start < SIM_STORE_CHUNK ? sim->back_store_size - start
+                                                                      : SIM_STORE_CHUNK;
+            if (back_store_read(sim->back_store, chunk, start, len)) {
+                out.error = 1;
+                break;
+            }
+            ckpt_write(&out, chunk, len);
+        }
+        free(chunk);
+    }
+    ckpt_begin(&out, CKPT_SPILL, 0);
+    ckpt_write(&out, &sim->num_spilled, sizeof(sim->num_spilled));
+    page_map_save(&sim->spill_index, &out);
+    ckpt_write(&out, sim->spill_mem, (size_t) sim->num_spilled * page_size);
+
+    if (sim->write_behind.capacity > 0) {
+        ckpt_begin(&out, CKPT_WRITE_BEHIND, 0);
+        write_behind_save(&sim->write_behind, &out);
+    }
+    if (sim->tier.budget > 0) {
+        ckpt_begin(&out, CKPT_TIER, 0);
+        ctier_save(&sim->tier, &out);
+    }
+    if (sim->prefetcher.degree > 0) {
+        ckpt_begin(&out, CKPT_PREFETCH, 0);
+        prefetcher_save(&sim->prefetcher, &out);
+    }
+    if (sim->resident_sets.mode != RS_NONE) {
+        ckpt_begin(&out, CKPT_RESIDENT_SETS, 0);
+        rs_save(&sim->resident_sets, sim->num_frames, &out);
+    }
+    if (sim->huge.pages_per_huge > 0) {
+        ckpt_begin(&out, CKPT_HUGE, 0);
+        huge_save(&sim->huge, &out);
+    }
+    STATS(ckpt_begin(&out, CKPT_STATS, 0); stats_save(&sim->stats, &out));
+    return ckpt_commit(&out, sim->num_entries);
+}
+
+/**
+ Finds the PTE of every resident frame again and points its frame at the
+ memory it lives in. Returns 0 on success, -1 if a frame's page is not mapped
+ to it.
+ */
+static int sim_bind_frames(struct Simulator* sim) {
+    int page_size = sim->config.page_size;
+    for (int i = 0; i < sim->num_frames; i++) {
+        struct Frame* frame = &sim->frame_table.frames[i];
+        sim->frame_mem[i] = sim->physical_mem + (size_t) i * page_size;
+        if (frame->page_no < 0) {
+            continue;
+        }
+        unsigned long pid = (unsigned long) frame->page_no >> sim->vpn_bits;
+        if (pid >= (unsigned long) sim->num_processes) {
+            return -1;
+        }
+        struct PTE* pte = page_table_get(&sim->processes[pid].page_table,
+                                         frame->page_no & ((1L << sim->vpn_bits) - 1));
+        if (!pte->valid || pte->frame_no != i) {
+            return -1;
+        }
+        frame->pte = pte;
+        char* alias = back_store_alias(sim->back_store, frame->page_no * page_size, page_size);
+        if (alias) {
+            sim->frame_mem[i] = alias;
+        }
+    }
+    return 0;
+}
+
+/**
+ Loads every part of a checkpoint but the configuration into a freshly
+ initialised simulator. Returns 0 on success, -1 if a section is missing or
+ corrupt.
+ */
+static int sim_restore_sections(struct Simulator* sim, const struct Checkpoint* ckpt) {
+    int page_size = sim->config.page_size;
+    struct CkptReader in;
+    if (ckpt_section(ckpt, CKPT_COUNTERS, &in)) {
+        return -1;
+    }
+    for (int p = 0; p < sim->num_processes; p++) {
+        if (ckpt_read(&in, &sim->processes[p].num_entries, sizeof(long)) ||
+            ckpt_read(&in, &sim->processes[p].num_tlb_hits, sizeof(long))) {
+            return -1;
+        }
+    }
+    if (ckpt_read(&in, &sim->output.countdown, sizeof(sim->output.countdown)) ||
+        ckpt_read(&in, &sim->output.num_written, sizeof(sim->output.num_written))) {
+        return -1;
+    }
+    if (ckpt_section(ckpt, CKPT_PAGE_TABLES, &in)) {
+        return -1;
+    }
+    for (int p = 0; p < sim->num_processes; p++) {
+        if (page_table_restore(&sim->processes[p].page_table, &in)) {
+            return -1;
+        }
+    }
+    const char* memory;
+    if (ckpt_section(ckpt, CKPT_TLB, &in) || tlb_restore(&sim->tlb, &in) ||
+        ckpt_section(ckpt, CKPT_FRAMES, &in) || frame_table_restore(&sim->frame_table, &in) ||
+        sim_bind_frames(sim) || ckpt_section(ckpt, CKPT_MEMORY, &in) ||
+        !(memory = (const char *) ckpt_view(&in, (size_t) sim->num_frames * page_size))) {
+        return -1;
+    }
+    memcpy(sim->physical_mem, memory, (size_t) sim->num_frames * page_size);
+
+    if (sim->back_store->writable) {
+        const char* image;
+        if (ckpt_section(ckpt, CKPT_STORE, &in) ||
+            !(image = (const char *) ckpt_view(&in, sim->back_store_size))) {
+            return -1;
+        }
+        for (long start = 0; start < sim->back_store_size; start += SIM_STORE_CHUNK) {
+            long len = sim->back_store_size - start < SIM_STORE_CHUNK ? sim->back_store_size - start
+                                                                      : SIM_STORE_CHUNK;
+            if (back_store_write(sim->back_store, image + start, start, len)) {
+                fprintf(stderr, "Cannot write to back store: %s\n", strerror(errno));
+                return -1;
+            }
+        }
+    }
+    const char* spilled;
+    if (ckpt_section(ckpt, CKPT_SPILL, &in) ||
+        ckpt_read(&in, &sim->num_spilled, sizeof(sim->num_spilled)) || sim->num_spilled < 0 ||
+        page_map_restore(&sim->spill_index, &in) ||
+        !(spilled = (const char *) ckpt_view(&in, (size_t) sim->num_spilled * page_size))) {
+        return -1;
+    }
+    if (sim->num_spilled > 0) {
+        if (!(sim->spill_mem = (char *) malloc((size_t) sim->num_spilled * page_size))) {
+            return -1;
+        }
+        memcpy(sim->spill_mem, spilled, (size_t) sim->num_spilled * page_size);
+        sim->spill_cap = sim->num_spilled;
+    }
+
+    if ((sim->write_behind.capacity > 0 &&
+         (ckpt_section(ckpt, CKPT_WRITE_BEHIND, &in) ||
+          write_behind_restore(&sim->write_behind, &in))) ||
+        (sim->tier.budget > 0 &&
+         (ckpt_section(ckpt, CKPT_TIER, &in) || ctier_restore(&sim->tier, &in))) ||
+        (sim->prefetcher.degree > 0 &&
+         (ckpt_section(ckpt, CKPT_PREFETCH, &in) || prefetcher_restore(&sim->prefetcher, &in))) ||
+        (sim->resident_sets.mode != RS_NONE &&
+         (ckpt_section(ckpt, CKPT_RESIDENT_SETS, &in) ||
+          rs_restore(&sim->resident_sets, sim->num_frames, &in))) ||
+        (sim->huge.pages_per_huge > 0 &&
+         (ckpt_section(ckpt, CKPT_HUGE, &in) || huge_restore(&sim->huge, &in)))) {
+        return -1;
+    }
+#ifdef VMM_STATS
+    if (ckpt_section(ckpt, CKPT_STATS, &in) || stats_restore(&sim->stats, &in)) {
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+/**
+ Resumes from the checkpoint at path: a simulator freshly initialised with
+ the same geometry and features takes over the whole state of the one that
+ wrote it, including the backing store contents. Afterwards num_entries is the
+ number of trace records already consumed, which the caller skips. Returns 0
+ on success; on failure prints the reason and returns -1, and the simulator
+ must be freed.
+ */
+int sim_restore(struct Simulator* sim, const char* path) {
+    struct Checkpoint ckpt;
+    if (ckpt_open(&ckpt, path)) {
+        fprintf(stderr, "Cannot read checkpoint %s\n", path);
+        return -1;
+    }
+    int64_t echo[SIM_ECHO_FIELDS];
+    sim_config_echo(sim, echo);
+    struct CkptReader in;
+    const int64_t* saved;
+    if (ckpt_section(&ckpt, CKPT_CONFIG, &in) ||
+        !(saved = (const int64_t *) ckpt_view(&in, sizeof(echo)))) {
+        fprintf(stderr, "Checkpoint %s is corrupt\n", path);
+        ckpt_close(&ckpt);
+        return -1;
+    }
+    for (size_t i = 0; i < SIM_ECHO_FIELDS; i++) {
+        if (saved[i] != echo[i]) {
+            fprintf(stderr, "Checkpoint %s was taken with a different %s\n", path,
+                    sim_echo_names[i]);
+            ckpt_close(&ckpt);
+            return -1;
+        }
+    }
+    sim->num_entries = (long) ckpt.header->position;
+    if (sim_restore_sections(sim, &ckpt)) {
+        // a look-ahead policy cannot take over the pages of another
+        fprintf(stderr, "Checkpoint %s is corrupt%s\n", path,
+                frame_table_policy_ops(&sim->frame_table)->prepare ?
+                " or was taken under another replacement policy" : "");
+        ckpt_close(&ckpt);
+        return -1;
+    }
+    ckpt_close(&ckpt);
+    return 0;
+}
+
+/**
+ Returns a newly allocated array with the tagged page of every record, or only
+ of those in the sample if sampled is set and the simulator samples, and
+ stores their number in num_pages. Returns NULL if memory runs out or a
+ record names a process that is not simulated.
+ */
+static long* sim_pages_of(struct Simulator* sim, const uint64_t* records, size_t num_records,
+                          int sampled, size_t* num_pages) {
+    long* pages = (long *) malloc((num_records > 0 ? num_records : 1) * sizeof(long));
+    if (!pages) {
+        return NULL;
+    }
+    sampled = sampled && sim->sample_threshold;
+    *num_pages = 0;
+    for (size_t r = 0; r < num_records; r++) {
+        if (sampled && !sim_samples(sim, records[r])) {
+            continue;
+        }
+        unsigned long logical_addr = trace_address(records[r]) & sim->address_mask;
+        unsigned pid = trace_pid(records[r]);
+        if (pid >= (unsigned) sim->num_processes) {
+            fprintf(stderr, "Access by process %u, but only %d processes are simulated\n",
+                    pid, sim->num_processes);
+            free(pages);
+            return NULL;
+        }
+        pages[(*num_pages)++] = sim_tag(sim, pid, logical_addr / sim->config.page_size);
+    }
+    return pages;
+}
+
+/**
+ Hands the page of every access to policies that look ahead in the trace (OPT).
+ Must be called before the first sim_run when the policy has a prepare step.
+ Returns 0 on success.
+ */
+int sim_prepare(struct Simulator* sim, const uint64_t* records, size_t num_records) {
+    struct FrameTable* frame_table = &sim->frame_table;
+    if (!frame_table_policy_ops(frame_table)->prepare) {
+        return 0;
+    }
+    if (sim->exact && sim_prepare(sim->exact, records, num_records)) {
+        return -1;
+    }
+    // a sampled simulation only ever asks about the pages in its sample
+    size_t num_pages;
+    long* pages = sim_pages_of(sim, records, num_records, 1, &num_pages);
+    if (!pages) {
+        return -1;
+    }
+    // every partition sees the whole trace but is only asked about its own frames
+    int ret = 0;
+    for (int p = 0; p < frame_table->num_partitions && ret == 0; p++) {
+        struct ReplacementPolicy* policy = &frame_table->partitions[p].policy;
+        ret = policy->ops->prepare(policy, pages, num_pages);
+    }
+    free(pages);
+    return ret;
+}
+
+/**
+ Returns the share of pages a simulator samples.
+ */
+static double sim_sample_rate(const struct Simulator* sim) {
+    return sim->sample_threshold ? sim->sample_threshold / (double) SAMPLE_MODULUS : 1.0;
+}
+
+/**
+ Returns the miss rate of an LRU memory of capacity pages per set, estimated
+ from the stack distances of a sample taken at rate out of num_records
+ references: a sampled distance d stands for d / rate, and capacities that
+ scale to a fraction of a page are interpolated. Dividing by the expected
+ rather than the actual sample size is the SHARDS adjustment for a sample
+ that happens to hold more or fewer references than its share.
+ */
+static double sim_mrc_rate(const struct StackDistance* sd, long capacity, double rate,
+                           size_t num_records) {
+    double n = num_records > 0 ? rate * num_records : 1.0;
+    double scaled = capacity * rate;
+    long below = (long) scaled;
+    // a memory of no pages misses every reference expected
+    double misses = below > 0 ? stack_distance_misses(sd, below) : n;
+    if (scaled > below) {
+        misses += (scaled - below) * (stack_distance_misses(sd, below + 1) - misses);
+    }
+    misses /= n;
+    return misses < 1.0 ? misses : 1.0;
+}
+
+/**
+ Prints one curve of sim_print_mrc, as miss rates or, if hits is set, hit
+ rates, over capacities of sets pages each. With an exact curve of every page
+ alongside, stores the mean and maximum absolute error of the estimate in
+ error[0] and error[1].
+ */
+static void sim_print_curve(const char* size_name, const char* rate_name,
+                            const struct StackDistance* sd, const struct StackDistance* exact,
+                            double rate, size_t num_records, int sets, int hits, double* error) {
+    // the estimate is flat from the first capacity that covers max_distance
+    long end = (long) (sd->max_distance / rate);
+    while ((long) (end * rate) < sd->max_distance) {
+        end++;
+    }
+    if (exact) {
+        end = exact->max_distance > end ? exact->max_distance : end;
+        printf("%s,%s,exact_%s\n", size_name, rate_name, rate_name);
+    } else {
+        printf("%s,%s\n", size_name, rate_name);
+    }
+    double sum = 0.0, max = 0.0;
+    long c;
+    for (c = 1; c <= end || c == 1; c++) {
+        double estimate = sim_mrc_rate(sd, c, rate, num_records);
+        estimate = hits ? 1.0 - estimate : estimate;
+        if (!exact) {
+            printf("%ld,%f\n", c * sets, estimate);
+            continue;
+        }
+        double value = sim_mrc_rate(exact, c, 1.0, num_records);
+        value = hits ? 1.0 - value : value;
+        printf("%ld,%f,%f\n", c * sets, estimate, value);
+        double diff = estimate > value ? estimate - value : value - estimate;
+        sum += diff;
+        max = diff > max ? diff : max;
+    }
+    error[0] = sum / (c - 1);
+    error[1] = max;
+}
+
+/**
+ Prints, instead of simulating, the page-fault rate of an LRU memory for every
+ frame count and the hit rate of an LRU TLB with the configured number of
+ sets for every number of ways, both from one pass over the trace. Each curve
+ stops where it flattens out: beyond that only cold misses remain. A sampling
+ simulator computes the curves from its sample alone; with sample_check the
+ exact curves are printed beside them, followed by the errors.
+ Returns 0 on success.
+ */
+int sim_print_mrc(struct Simulator* sim, const uint64_t* records, size_t num_records) {
+    const int check = sim->config.sample_check;
+    size_t num_pages, num_all = 0;
+    long* pages = sim_pages_of(sim, records, num_records, 1, &num_pages);
+    long* all = check ? sim_pages_of(sim, records, num_records, 0, &num_all) : NULL;
+    struct StackDistance frames, tlb, exact_frames, exact_tlb;
+    memset(&frames, 0, sizeof(frames));
+    memset(&tlb, 0, sizeof(tlb));
+    memset(&exact_frames, 0, sizeof(exact_frames));
+    memset(&exact_tlb, 0, sizeof(exact_tlb));
+    int ret = -1;
+    if (!pages || (check && !all) ||
+        stack_distance_compute(&frames, pages, num_pages, 1) ||
+        stack_distance_compute(&tlb, pages, num_pages, sim->config.tlb_sets) ||
+        (check && (stack_distance_compute(&exact_frames, all, num_all, 1) ||
+                   stack_distance_compute(&exact_tlb, all, num_all, sim->config.tlb_sets)))) {
+        goto out;
+    }
+    double rate = sim_sample_rate(sim);
+    double errors[2][2];
+    sim_print_curve("frames", "page_fault_rate", &frames, check ? &exact_frames : NULL, rate,
+                    num_records, 1, 0, errors[0]);
+    printf("\n");
+    sim_print_curve("tlb_entries", "tlb_hit_rate", &tlb, check ? &exact_tlb : NULL, rate,
+                    num_records, sim->config.tlb_sets, 1, errors[1]);
+    if (check) {
+        printf("\ncurve,mean_absolute_error,max_absolute_error\n");
+        printf("page_fault_rate,%f,%f\n", errors[0][0], errors[0][1]);
+        printf("tlb_hit_rate,%f,%f\n", errors[1][0], errors[1][1]);
+    }
+    ret = 0;
+out:
+    stack_distance_free(&frames);
+    stack_distance_free(&tlb);
+    stack_distance_free(&exact_frames);
+    stack_distance_free(&exact_tlb);
+    free(pages);
+    free(all);
+    return ret;
+}
+
+/**
+ Returns the page faults of all processes.
+ */
+long sim_num_faults(const struct Simulator* sim) {
+    long num_faults = 0;
+    for (int p = 0; p < sim->num_processes; p++) {
+        num_faults += sim->processes[p].page_table.num_faults;
+    }
+    return num_faults;
+}
+
+/**
+ Computes the page-fault and TLB hit rates over all accesses. A sample's are
+ estimated over the accesses expected of it, the sampling rate times the
+ trace, rather than those it got (the SHARDS adjustment): the surplus
+ accesses of a hot page that happens to be sampled count as hits, a deficit
+ as misses.
+ */
+static void sim_rates(const struct Simulator* sim, double* fault_rate, double* hit_rate) {
+    if (!sim->sample_threshold) {
+        *fault_rate = sim_num_faults(sim) / (double) sim->num_entries;
+        *hit_rate = sim->tlb.num_hits / (double) sim->num_entries;
+        return;
+    }
+    double expected = sim_sample_rate(sim) * (sim->num_entries + sim->num_skipped);
+    double misses = (sim->num_entries - sim->tlb.num_hits) / expected;
+    *fault_rate = sim_num_faults(sim) / expected;
+    *fault_rate = *fault_rate < 1.0 ? *fault_rate : 1.0;
+    *hit_rate = misses < 1.0 ? 1.0 - misses : 0.0;
+}
+
+/**
+ Returns the dirty resident pages, scaled up from the sample when sampling.
+ */
+static long sim_num_dirty(const struct Simulator* sim) {
+    long num_dirty = frame_table_count_dirty(&sim->frame_table);
+    return sim->sample_threshold ? (long) (num_dirty / sim_sample_rate(sim) + 0.5) : num_dirty;
+}
+
+/**
+ Prints how much of the trace a sampling simulator simulated and, when it is
+ checked against the full simulation, the error of each estimate.
+ */
+static void sim_print_sample_stats(struct Simulator* sim, FILE* out) {
+    long num_records = sim->num_entries + sim->num_skipped;
+    fprintf(out, "Sampled accesses: %ld of %ld (rate %f)\n", sim->num_entries, num_records,
+            sim_sample_rate(sim));
+    struct Simulator* exact = sim->exact;
+    if (!exact) {
+        return;
+    }
+    double fault_rate, hit_rate, exact_fault_rate, exact_hit_rate;
+    sim_rates(sim, &fault_rate, &hit_rate);
+    sim_rates(exact, &exact_fault_rate, &exact_hit_rate);
+    fprintf(out, "Page-fault rate error: %+f (exact %f)\n", fault_rate - exact_fault_rate,
+            exact_fault_rate);
+    fprintf(out, "TLB hit rate error: %+f (exact %f)\n", hit_rate - exact_hit_rate,
+            exact_hit_rate);
+    fprintf(out, "Dirty pages error: %+ld (exact %ld)\n",
+            sim_num_dirty(sim) - sim_num_dirty(exact), sim_num_dirty(exact));
+}
+
+/**
+ Prints the fault rate, TLB hit rate and resident pages of every process.
+ */
+static void sim_print_process_stats(struct Simulator* sim, FILE* out) {
+    int* resident = (int *) calloc(sim->num_processes, sizeof(int));
+    if (!resident) {
+        return;
+    }
+    for (int i = 0; i < sim->frame_table.num_frames; i++) {
+        long tag = sim->frame_table.frames[i].page_no;
+        if (tag >= 0) {
+            resident[tag >> sim->vpn_bits]++;
+        }
+    }
+    for (int p = 0; p < sim->num_processes; p++) {
+        struct Process* process = &sim->processes[p];
+        double n = process->num_entries > 0 ? (double) process->num_entries : 1.0;
+        fprintf(out, "Process %d: %ld accesses, page-fault rate %f, TLB hit rate %f, "
+                "%d resident pages\n", p, process->num_entries,
+                process->page_table.num_faults / n, process->num_tlb_hits / n, resident[p]);
+    }
+    free(resident);
+}
+
+/**
+ Prints the statistics after the last translation. They go to stderr when
+ stdout carries binary records.
+ */
+void sim_print_stats(struct Simulator* sim) {
+    FILE* out = stdout;
+    if (sim->output.buffer) {
+        output_flush(&sim->output);
+        if (sim->output.format == OUTPUT_BINARY) {
+            out = stderr;
+        }
+    }
+    long num_faults = sim_num_faults(sim);
+    double fault_rate, hit_rate;
+    sim_rates(sim, &fault_rate, &hit_rate);
+    fprintf(out, "Page-fault rate: %f\n", fault_rate);
+    fprintf(out, "TLB hit rate: %f\n", hit_rate);
+    fprintf(out, "Number of dirty pages: %ld\n", sim_num_dirty(sim));
+    if (sim->num_processes > 1) {
+        sim_print_process_stats(sim, out);
+    }
+    // walk statistics of all page tables together, they share one geometry
+    struct PageTable* page_table = &sim->processes[0].page_table;
+    if (page_table->num_levels > 1) {
+        long num_walks = 0, levels_touched = 0, psc_hits = 0, num_nodes = 0;
+        for (int p = 0; p < sim->num_processes; p++) {
+            num_walks += sim->processes[p].page_table.num_walks;
+            levels_touched += sim->processes[p].page_table.levels_touched;
+            psc_hits += sim->processes[p].page_table.psc_hits;
+            num_nodes += sim->processes[p].page_table.num_nodes;
+        }
+        fprintf(out, "Page-table levels: %d\n", page_table->num_levels);
+        fprintf(out, "Page-walk levels per TLB miss: %f\n", levels_touched / (double) num_walks);
+        if (page_table->psc_mask >= 0) {
+            fprintf(out, "Paging-structure cache hit rate: %f\n", psc_hits / (double) num_walks);
+        }
+        fprintf(out, "Page-table nodes: %ld\n", num_nodes);
+    }
+    struct Prefetcher* prefetcher = &sim->prefetcher;
+    if (prefetcher->degree > 0) {
+        fprintf(out, "Prefetched pages: %ld\n", prefetcher->num_issued);
+        fprintf(out, "Prefetch accuracy: %f\n",
+                prefetcher->num_issued ? prefetcher->num_useful / (double) prefetcher->num_issued
+                                       : 0.0);
+        fprintf(out, "Prefetch coverage: %f\n",
+                prefetcher->num_useful + num_faults ?
+                prefetcher->num_useful / (double) (prefetcher->num_useful + num_faults) : 0.0);
+        fprintf(out, "Wasted prefetches: %ld\n", prefetcher->num_issued - prefetcher->num_useful);
+    }
+    struct CompressedTier* tier = &sim->tier;
+    if (tier->budget > 0) {
+        long writes_avoided = tier->num_dirty_stored - tier->num_written_back;
+        fprintf(out, "Compressed tier pages stored: %ld\n", tier->num_stored);
+        fprintf(out, "Compressed tier same-filled pages: %ld\n", tier->num_same_filled);
+        fprintf(out, "Compressed tier rejected pages: %ld\n", tier->num_rejected);
+        fprintf(out, "Compression ratio: %f\n",
+                tier->bytes_out ? tier->bytes_in / (double) tier->bytes_out : 0.0);
+        fprintf(out, "Compressed tier hit rate: %f\n",
+                tier->num_hits + tier->num_misses ?
+                tier->num_hits / (double) (tier->num_hits + tier->num_misses) : 0.0);
+        fprintf(out, "Back-store reads avoided: %ld\n", tier->num_hits);
+        fprintf(out, "Back-store writes avoided: %ld\n", writes_avoided);
+        fprintf(out, "Back-store bytes avoided: %ld\n",
+                (tier->num_hits + writes_avoided) * sim->config.page_size);
+    }
+    struct HugePages* huge = &sim->huge;
+    if (huge->pages_per_huge > 0) {
+        fprintf(out, "Huge-page TLB hit rate: %f\n", huge->num_hits / (double) sim->num_entries);
+        fprintf(out, "Huge-page promotions: %ld\n", huge->num_promotions);
+        fprintf(out, "Huge-page demotions: %ld\n", huge->num_demotions);
+        fprintf(out, "TLB reach: %ld bytes\n",
+                (sim->tlb.size + (long) huge->tlb.size * huge->pages_per_huge) *
+                sim->config.page_size);
+    }
+    struct ResidentSets* resident_sets = &sim->resident_sets;
+    if (resident_sets->mode != RS_NONE) {
+        // the last interval may be cut short by the end of the trace
+        if (sim->num_entries > resident_sets->next_sample - resident_sets->interval) {
+            sample_resident_sets(sim, sim->num_entries);
+        }
+        rs_print_stats(resident_sets, out);
+    }
+    struct WriteBehind* write_behind = &sim->write_behind;
+    if (write_behind->capacity > 0) {
+        fprintf(out, "Write-back bytes: %ld\n", write_behind->bytes_written);
+        fprintf(out, "Write-back syscalls: %ld\n", write_behind->num_syscalls);
+        fprintf(out, "Pages per write-back syscall: %f\n",
+                write_behind->num_syscalls ? write_behind->pages_written /
+                                             (double) write_behind->num_syscalls : 0.0);
+    }
+    if (sim->sample_threshold) {
+        sim_print_sample_stats(sim, out);
+    }
+    STATS(if (sim->config.stats_file) {
+              sim_write_stats(sim);
+          });
+}
@@ -0,0 +1,149 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "back_store.h"
+#include "checkpoint.h"
+#include "compressed_tier.h"
+#include "frame_table.h"
+#include "huge_page.h"
+#include "output.h"
+#include "page_map.h"
+#include "page_table.h"
+#include "prefetch.h"
+#include "pte.h"
+#include "resident_set.h"
+#include "sampling.h"
+#include "stats.h"
+#include "tlb.h"
+#include "vmm.h"
+#include "write_behind.h"
+
+/**
+ Run-time geometry and policy of a simulation. num_frames == 0 means as many
+ frames as pages (part 1: no replacement ever happens). num_levels == 0 lets
+ the page table pick its own split of the page number.
+ */
+struct SimConfig {
+    int address_bits;
+    int page_size;
+    int num_frames;
+    int tlb_sets;
+    int tlb_ways;
+    const char * policy;
+    const char * tlb_lookup;  // TLB lookup method, NULL for the fastest the CPU supports
+    int num_levels;
+    int level_bits[PAGE_TABLE_MAX_LEVELS];
+    int psc_entries;
+    int mrc;                  // print miss-ratio curves instead of simulating
+    int quiet;                // count only, do not print each translation
+    int output_format;        // OUTPUT_TEXT or OUTPUT_BINARY translations
+    long sample_every;        // print every Nth translation
+    int write_behind;         // dirty pages queued before a write-back, 0 writes at once
+    const char * back_store;  // backing store backend
+    int zero_copy;            // frames alias a mapped backing store instead of copying it
+    int prefetch;             // pages prefetched per detected stream fault, 0 for none
+    int prefetch_streams;     // streams the prefetcher tracks
+    int num_processes;        // address spaces, named by the process ID of each record
+    int local_replacement;    // each process replaces among its own share of the frames
+    int num_cores;            // simulated cores with private TLBs, 0 for the single-core engine
+    int shootdown_batch;      // victims a core reclaims and shoots down together
+    int core_quantum;         // consecutive records dealt to one core
+    long working_set;         // working-set window in references, 0 for none
+    double pff_lower;         // page-fault frequency thresholds in faults per access,
+    double pff_upper;         // upper 0 for none
+    long rs_interval;         // accesses between resident-set samples
+    const char * rs_series;   // resident-set time series CSV file, NULL for none
+    const char * stats_file;  // statistics export (VMM_STATS builds only), NULL for none
+    int stats_format;         // STATS_CSV or STATS_JSON
+    long stats_interval;      // accesses between statistics snapshots, 0 for none
+    int huge_pages;           // base pages per huge page, 0 for none
+    int huge_tlb_entries;     // entries of the huge-page TLB
+    int promote_misses;       // base TLB misses of a fully resident region before promotion
+    long compressed_tier;     // compressed swap tier budget in bytes, 0 for none
+    const char * checkpoint_file;  // where checkpoints are written, NULL for none
+    long checkpoint_every;    // accesses between checkpoints, 0 for on SIGUSR1 only
+    const char * restore_file;     // checkpoint the drivers resume from, NULL for none
+    double sample_rate;       // share of pages simulated (spatial sampling), 1 for all
+    int sample_check;         // also simulate every page and report the sampling error
+    int page_runs;            // translate a run of accesses to one page with one TLB lookup
+};
+
+/**
+ One address space. Pages of process p are tagged p << vpn_bits | page in the
+ TLB, the frame table and the backing store, so the TLB needs no flush on a
+ context switch and process 0 alone behaves exactly like a single address
+ space. Other processes are backed further into the store; past its end their
+ pages start out zero-filled.
+ */
+struct Process {
+    struct PageTable page_table;
+    int partition;       // frame partition it replaces in
+    long num_entries;
+    long num_tlb_hits;
+};
+
+struct Simulator {
+    struct SimConfig config;
+    unsigned long address_mask;
+    int page_shift; // log2(page_size), -1 if page_size is not a power of two
+    long num_pages;     // per process
+    int vpn_bits;       // page number width, the shift of the process ID in a tag
+    int num_frames;
+    struct BackStore * back_store;
+    long back_store_size;
+    // pages past the end of the backing store that were written back
+    struct PageMap spill_index;
+    char * spill_mem;
+    int num_spilled;
+    int spill_cap;
+    struct WriteBehind write_behind;
+    int write_behind_fd;
+    struct CompressedTier tier;
+    struct Prefetcher prefetcher;
+    struct ResidentSets resident_sets;
+    struct HugePages huge;
+#ifdef VMM_STATS
+    struct SimStats stats;
+#endif
+    struct OutputWriter output;  // translations, on stdout unless quiet
+    struct Tlb tlb;
+    struct Process * processes;
+    int num_processes;
+    struct FrameTable frame_table;
+    char * physical_mem;
+    char ** frame_mem;  // start of each frame: in physical_mem, or aliasing the backing store
+    long num_entries;
+    int failed;         // a backing-store or compressed-tier error stopped the run
+    // spatial sampling: hash threshold of the sampled pages, 0 when every page is simulated
+    uint64_t sample_threshold;
+    long num_skipped;               // trace records of pages outside the sample
+    struct Simulator * exact;       // unsampled simulation checked against, NULL for none
+    struct BackStore * exact_store; // its private copy of the backing store
+};
+
+void sim_default_config(struct SimConfig* config);
+int sim_init(struct Simulator* sim, const struct SimConfig* config, struct BackStore* back_store);
+void sim_free(struct Simulator* sim);
+int sim_prepare(struct Simulator* sim, const uint64_t* records, size_t num_records);
+int sim_run(struct Simulator* sim, const uint64_t* records, size_t num_records);
+int sim_translate(struct Simulator* sim, const uint64_t* records, size_t num_records,
+                   struct VmmTranslation* out);
+void sim_flush(struct Simulator* sim);
+int sim_checkpoint(struct Simulator* sim, const char* path);
+int sim_restore(struct Simulator* sim, const char* path);
+int sim_print_mrc(struct Simulator* sim, const uint64_t* records, size_t num_records);
+void sim_print_stats(struct Simulator* sim);
+long sim_num_faults(const struct Simulator* sim);
+
+/**
+ Returns the TLB, frame table and backing store name of page_no of process pid.
+ */
+static inline long sim_tag(const struct Simulator* sim, unsigned pid, long page_no) {
+    return (long) pid << sim->vpn_bits | page_no;
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "page_map.h"
+#include "stack_distance.h"
+
+/**
+ Fenwick tree over the positions of one set, stored at tree[1..len] of the
+ set's segment.
+ */
+static void fenwick_add(int* tree, long len, long i, int delta) {
+    for (; i <= len; i += i & -i) {
+        tree[i] += delta;
+    }
+}
+
+static long fenwick_sum(const int* tree, long i) {
+    long sum = 0;
+    for (; i > 0; i -= i & -i) {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+/**
+ Computes the miss counts of LRU memories of every size for the reference
+ string pages. num_sets must be a power of two. Returns 0 on success, -1 if
+ memory runs out.
+ */
+int stack_distance_compute(struct StackDistance* sd, const long* pages, size_t num_pages,
+                           int num_sets) {
+    memset(sd, 0, sizeof(*sd));
+    sd->num_sets = num_sets;
+    sd->num_references = num_pages;
+
+    // each set gets a segment of len + 1 tree slots, slot 0 unused
+    long * len = (long *) calloc(num_sets, sizeof(long));
+    long * used = (long *) calloc(num_sets, sizeof(long));
+    long * base = (long *) calloc(num_sets, sizeof(long));
+    int * tree = (int *) calloc(num_pages + num_sets, sizeof(int));
+    long * hist = NULL;
+    long hist_cap = 0;
+    struct PageMap last;
+    int ret = -1;
+    if (!len || !used || !base || !tree || page_map_init(&last, 1024)) {
+        free(len);
+        free(used);
+        free(base);
+        free(tree);
+        return -1;
+    }
+    for (size_t i = 0; i < num_pages; i++) {
+        len[pages[i] & (num_sets - 1)]++;
+    }
+    for (int s = 1; s < num_sets; s++) {
+        base[s] = base[s - 1] + len[s - 1] + 1;
+    }
+
+    for (size_t i = 0; i < num_pages; i++) {
+        int set = pages[i] & (num_sets - 1);
+        int * set_tree = tree + base[set];
+        long set_len = len[set];
+        // positions within a set start at 1; last maps a page to its latest one
+        long pos = ++used[set];
+        long prev = page_map_get(&last, pages[i]);
+        if (prev < 0) {
+            sd->num_cold++;
+        } else {
+            long distance = fenwick_sum(set_tree, pos - 1) - fenwick_sum(set_tree, prev) + 1;
+            if (distance >= hist_cap) {
+                long cap = hist_cap ? 2 * hist_cap : 1024;
+                while (cap <= distance) {
+                    cap *= 2;
+                }
+                long * bigger = (long *) realloc(hist, cap * sizeof(long));
+                if (!bigger) {
+                    goto out;
+                }
+                memset(bigger + hist_cap, 0, (cap - hist_cap) * sizeof(long));
+                hist = bigger;
+                hist_cap = cap;
+            }
+            hist[distance]++;
+            if (distance > sd->max_distance) {
+                sd->max_distance = distance;
+            }
+            fenwick_add(set_tree, set_len, prev, -1);
+        }
+        fenwick_add(set_tree, set_len, pos, 1);
+        page_map_put(&last, pages[i], (int) pos);
+    }
+
+    // misses[c] = cold misses + references further than c down the stack
+    sd->misses = (long *) malloc((sd->max_distance + 1) * sizeof(long));
+    if (!sd->misses) {
+        goto out;
+    }
+    sd->misses[sd->max_distance] = sd->num_cold;
+    for (long c = sd->max_distance; c > 0; c--) {
+        sd->misses[c - 1] = sd->misses[c] + hist[c];
+    }
+    ret = 0;
+out:
+    free(len);
+    free(used);
+    free(base);
+    free(tree);
+    free(hist);
+    page_map_free(&last);
+    return ret;
+}
+
+void stack_distance_free(struct StackDistance* sd) {
+    free(sd->misses);
+    sd->misses = NULL;
+}
@@ -0,0 +1,39 @@
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include <stddef.h>
+
+/**
+ LRU stack distances (Mattson et al.) of a page reference string. The stack
+ distance of a reference is the number of distinct pages referenced since the
+ previous reference to the same page, plus one; an LRU memory of c pages
+ misses exactly the references whose distance exceeds c, so one pass gives
+ the miss count of every size at once.
+
+ With num_sets > 1 pages are split into sets by their low bits, as in a
+ set-associative TLB, and distances are counted within each set; the curve is
+ then over the number of ways.
+
+ Each distance is a Fenwick tree range sum over trace positions that hold the
+ latest reference to some page, so a reference costs O(log n).
+ */
+struct StackDistance {
+    int num_sets;
+    long num_references;
+    long num_cold;       // first references, misses at every size
+    long max_distance;
+    long * misses;       // misses[c] for c in [0, max_distance], LRU of c pages per set
+};
+
+int stack_distance_compute(struct StackDistance* sd, const long* pages, size_t num_pages,
+                           int num_sets);
+void stack_distance_free(struct StackDistance* sd);
+
+/**
+ Returns the misses of an LRU memory of capacity pages per set.
+ */
+static inline long stack_distance_misses(const struct StackDistance* sd, long capacity) {
+    return capacity <= sd->max_distance ? sd->misses[capacity] : sd->num_cold;
+}
+
+#endif
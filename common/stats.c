@@ -0,0 +1,274 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+static const char * const timer_names[STATS_NUM_TIMERS] = {
+    "tlb_lookup", "page_walk", "page_in", "write_back"
+};
+
+/**
+ Sets up empty statistics with a snapshot every interval accesses (0 for
+ none). Returns 0 on success, -1 if memory runs out.
+ */
+int stats_init(struct SimStats* stats, long interval) {
+    memset(stats, 0, sizeof(*stats));
+    if (interval < 0 || page_map_init(&stats->index, 1024)) {
+        return -1;
+    }
+    stats->interval = interval;
+    stats->next_snapshot = interval;
+    return 0;
+}
+
+void stats_free(struct SimStats* stats) {
+    if (stats->index.slots) {
+        page_map_free(&stats->index);
+    }
+    free(stats->pages);
+    free(stats->snapshots);
+    memset(stats, 0, sizeof(*stats));
+}
+
+/**
+ Returns the counters of page_no, adding them the first time it is seen.
+ */
+struct StatsPage* stats_page(struct SimStats* stats, long page_no) {
+    int slot = page_map_get(&stats->index, page_no);
+    if (slot >= 0) {
+        return &stats->pages[slot];
+    }
+    if (stats->num_pages == stats->pages_cap) {
+        int cap = stats->pages_cap ? 2 * stats->pages_cap : 1024;
+        struct StatsPage * pages =
+            (struct StatsPage *) realloc(stats->pages, (size_t) cap * sizeof(struct StatsPage));
+        if (!pages) {
+            fprintf(stderr, "Cannot keep statistics of %d pages\n", cap);
+            exit(-1);
+        }
+        stats->pages = pages;
+        stats->pages_cap = cap;
+    }
+    slot = stats->num_pages++;
+    page_map_put(&stats->index, page_no, slot);
+    struct StatsPage * page = &stats->pages[slot];
+    memset(page, 0, sizeof(*page));
+    page->page_no = page_no;
+    page->last_access = -1;
+    return page;
+}
+
+/**
+ Keeps totals as the snapshot that ends the current interval.
+ */
+void stats_snapshot(struct SimStats* stats, const struct StatsSnapshot* totals) {
+    if (stats->num_snapshots == stats->snapshots_cap) {
+        int cap = stats->snapshots_cap ? 2 * stats->snapshots_cap : 64;
+        struct StatsSnapshot * snapshots = (struct StatsSnapshot *)
+            realloc(stats->snapshots, (size_t) cap * sizeof(struct StatsSnapshot));
+        if (!snapshots) {
+            fprintf(stderr, "Cannot keep %d statistics snapshots\n", cap);
+            exit(-1);
+        }
+        stats->snapshots = snapshots;
+        stats->snapshots_cap = cap;
+    }
+    stats->snapshots[stats->num_snapshots++] = *totals;
+    stats->next_snapshot += stats->interval;
+}
+
+/**
+ Returns the STATS_* format called name ("csv" or "json"), or -1.
+ */
+int stats_parse_format(const char* name) {
+    if (strcmp(name, "csv") == 0) {
+        return STATS_CSV;
+    }
+    if (strcmp(name, "json") == 0) {
+        return STATS_JSON;
+    }
+    return -1;
+}
+
+static int compare_pages(const void* a, const void* b) {
+    long x = ((const struct StatsPage *) a)->page_no;
+    long y = ((const struct StatsPage *) b)->page_no;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ Writes the totals, timers, reuse histogram, per-page counters (in page order,
+ process ID and page number split with vpn_bits) and snapshots to out. CSV
+ output is one table per section, separated by blank lines.
+ */
+void stats_write(const struct SimStats* stats, FILE* out, int format,
+                 const struct StatsSnapshot* totals, int vpn_bits) {
+    int json = format == STATS_JSON;
+    struct StatsPage * pages = (struct StatsPage *)
+        malloc((stats->num_pages > 0 ? stats->num_pages : 1) * sizeof(struct StatsPage));
+    if (!pages) {
+        fprintf(stderr, "Cannot sort the statistics of %d pages\n", stats->num_pages);
+        return;
+    }
+    memcpy(pages, stats->pages, stats->num_pages * sizeof(struct StatsPage));
+    qsort(pages, stats->num_pages, sizeof(struct StatsPage), compare_pages);
+
+    const char * const counters[] = {
+        "accesses", "page_faults", "tlb_hits", "evictions", "write_backs", "tlb_evictions",
+        "run_hits"
+    };
+    const long values[] = {
+        totals->accesses, totals->faults, totals->tlb_hits, totals->evictions,
+        totals->write_backs, totals->tlb_evictions, stats->num_run_hits
+    };
+    if (json) {
+        fprintf(out, "{\n");
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+            fprintf(out, "  \"%s\": %ld,\n", counters[i], values[i]);
+        }
+    } else {
+        fprintf(out, "counter,value\n");
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+            fprintf(out, "%s,%ld\n", counters[i], values[i]);
+        }
+    }
+
+#ifdef VMM_TIMERS
+    if (json) {
+        fprintf(out, "  \"timers\": {\"unit\": \"%s\"", STATS_TIMER_UNIT);
+    } else {
+        fprintf(out, "\ntimer,count,total_%s,mean_%s\n", STATS_TIMER_UNIT, STATS_TIMER_UNIT);
+    }
+    for (int t = 0; t < STATS_NUM_TIMERS; t++) {
+        double mean = stats->timer_count[t] ?
+                      stats->timer_total[t] / (double) stats->timer_count[t] : 0.0;
+        if (json) {
+            fprintf(out, ", \"%s\": {\"count\": %ld, \"total\": %llu, \"mean\": %.1f}",
+                    timer_names[t], stats->timer_count[t],
+                    (unsigned long long) stats->timer_total[t], mean);
+        } else {
+            fprintf(out, "%s,%ld,%llu,%.1f\n", timer_names[t], stats->timer_count[t],
+                    (unsigned long long) stats->timer_total[t], mean);
+        }
+    }
+    if (json) {
+        fprintf(out, "},\n");
+    }
+#else
+    (void) timer_names;
+#endif
+
+    int last_bucket = STATS_REUSE_BUCKETS - 1;
+    while (last_bucket > 0 && stats->reuse[last_bucket] == 0) {
+        last_bucket--;
+    }
+    if (json) {
+        fprintf(out, "  \"reuse_distance\": {\"cold\": %ld, \"buckets\": [", stats->num_cold);
+    } else {
+        fprintf(out, "\nreuse_min,reuse_max,accesses\ncold,cold,%ld\n", stats->num_cold);
+    }
+    for (int b = 0; b <= last_bucket; b++) {
+        if (json) {
+            fprintf(out, "%s{\"min\": %ld, \"max\": %ld, \"accesses\": %ld}", b ? ", " : "",
+                    1L << b, (2L << b) - 1, stats->reuse[b]);
+        } else {
+            fprintf(out, "%ld,%ld,%ld\n", 1L << b, (2L << b) - 1, stats->reuse[b]);
+        }
+    }
+
+    if (json) {
+        fprintf(out, "]},\n  \"pages\": [");
+    } else {
+        fprintf(out, "\npid,page,faults,evictions,write_backs\n");
+    }
+    for (int i = 0; i < stats->num_pages; i++) {
+        const struct StatsPage * page = &pages[i];
+        long pid = page->page_no >> vpn_bits;
+        long page_no = page->page_no & ((1L << vpn_bits) - 1);
+        if (json) {
+            fprintf(out, "%s\n    {\"pid\": %ld, \"page\": %ld, \"faults\": %ld, "
+                    "\"evictions\": %ld, \"write_backs\": %ld}", i ? "," : "", pid, page_no,
+                    page->faults, page->evictions, page->write_backs);
+        } else {
+            fprintf(out, "%ld,%ld,%ld,%ld,%ld\n", pid, page_no, page->faults, page->evictions,
+                    page->write_backs);
+        }
+    }
+
+    if (json) {
+        fprintf(out, "%s],\n  \"intervals\": [", stats->num_pages ? "\n  " : "");
+    } else {
+        fprintf(out, "\naccesses,page_faults,tlb_hits,evictions,write_backs,tlb_evictions\n");
+    }
+    for (int i = 0; i < stats->num_snapshots; i++) {
+        const struct StatsSnapshot * s = &stats->snapshots[i];
+        if (json) {
+            fprintf(out, "%s\n    {\"accesses\": %ld, \"page_faults\": %ld, \"tlb_hits\": %ld, "
+                    "\"evictions\": %ld, \"write_backs\": %ld, \"tlb_evictions\": %ld}",
+                    i ? "," : "", s->accesses, s->faults, s->tlb_hits, s->evictions,
+                    s->write_backs, s->tlb_evictions);
+        } else {
+            fprintf(out, "%ld,%ld,%ld,%ld,%ld,%ld\n", s->accesses, s->faults, s->tlb_hits,
+                    s->evictions, s->write_backs, s->tlb_evictions);
+        }
+    }
+    if (json) {
+        fprintf(out, "%s]\n}\n", stats->num_snapshots ? "\n  " : "");
+    }
+    free(pages);
+}
+
+/**
+ Writes the counters, the per-page statistics and the snapshots to a
+ checkpoint.
+ */
+void stats_save(const struct SimStats* stats, struct CkptWriter* out) {
+    ckpt_write(out, &stats->num_evictions, sizeof(stats->num_evictions));
+    ckpt_write(out, &stats->num_write_backs, sizeof(stats->num_write_backs));
+    ckpt_write(out, &stats->num_tlb_evictions, sizeof(stats->num_tlb_evictions));
+    ckpt_write(out, &stats->num_run_hits, sizeof(stats->num_run_hits));
+    ckpt_write(out, &stats->num_cold, sizeof(stats->num_cold));
+    ckpt_write(out, stats->reuse, sizeof(stats->reuse));
+    ckpt_write(out, stats->timer_total, sizeof(stats->timer_total));
+    ckpt_write(out, stats->timer_count, sizeof(stats->timer_count));
+    ckpt_write(out, &stats->next_snapshot, sizeof(stats->next_snapshot));
+    ckpt_write(out, &stats->num_pages, sizeof(stats->num_pages));
+    ckpt_write(out, stats->pages, stats->num_pages * sizeof(struct StatsPage));
+    ckpt_write(out, &stats->num_snapshots, sizeof(stats->num_snapshots));
+    ckpt_write(out, stats->snapshots, stats->num_snapshots * sizeof(struct StatsSnapshot));
+}
+
+/**
+ Loads statistics saved by stats_save into fresh ones. Returns 0 on success,
+ -1 if the checkpoint is corrupt.
+ */
+int stats_restore(struct SimStats* stats, struct CkptReader* in) {
+    int num_pages, num_snapshots;
+    const struct StatsPage * pages;
+    const struct StatsSnapshot * snapshots;
+    if (ckpt_read(in, &stats->num_evictions, sizeof(stats->num_evictions)) ||
+        ckpt_read(in, &stats->num_write_backs, sizeof(stats->num_write_backs)) ||
+        ckpt_read(in, &stats->num_tlb_evictions, sizeof(stats->num_tlb_evictions)) ||
+        ckpt_read(in, &stats->num_run_hits, sizeof(stats->num_run_hits)) ||
+        ckpt_read(in, &stats->num_cold, sizeof(stats->num_cold)) ||
+        ckpt_read(in, stats->reuse, sizeof(stats->reuse)) ||
+        ckpt_read(in, stats->timer_total, sizeof(stats->timer_total)) ||
+        ckpt_read(in, stats->timer_count, sizeof(stats->timer_count)) ||
+        ckpt_read(in, &stats->next_snapshot, sizeof(stats->next_snapshot)) ||
+        ckpt_read(in, &num_pages, sizeof(num_pages)) || num_pages < 0 ||
+        !(pages = (const struct StatsPage *) ckpt_view(in, num_pages * sizeof(struct StatsPage))) ||
+        ckpt_read(in, &num_snapshots, sizeof(num_snapshots)) || num_snapshots < 0 ||
+        !(snapshots = (const struct StatsSnapshot *)
+              ckpt_view(in, num_snapshots * sizeof(struct StatsSnapshot)))) {
+        return -1;
+    }
+    for (int i = 0; i < num_pages; i++) {
+        *stats_page(stats, pages[i].page_no) = pages[i];
+    }
+    for (int i = 0; i < num_snapshots; i++) {
+        long next_snapshot = stats->next_snapshot;
+        stats_snapshot(stats, &snapshots[i]);
+        stats->next_snapshot = next_snapshot;
+    }
+    return 0;
+}
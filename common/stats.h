@@ -0,0 +1,130 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "checkpoint.h"
+#include "page_map.h"
+
+/**
+ Hot-path instrumentation of the single-core simulator, exported as CSV or
+ JSON. It is compiled in only with -DVMM_STATS (make STATS=1); otherwise
+ every STATS() hook expands to nothing and the simulator carries no counters.
+
+ Counted: evictions, dirty write-backs and TLB evictions (valid entries
+ replaced by a fill), faults, evictions and write-backs per page, and a
+ histogram of reuse distances, the number of accesses since the previous
+ access to the same page, in power-of-two buckets. Every interval accesses a
+ snapshot of the running totals is kept for the export.
+
+ With -DVMM_TIMERS as well (make TIMERS=1) the TLB lookup, page walk, page-in
+ and write-back phases are timed with the time stamp counter (nanoseconds off
+ x86). Timing every lookup adds a few dozen cycles per access of its own.
+ */
+#define STATS_CSV 0
+#define STATS_JSON 1
+
+#define STATS_TLB_LOOKUP 0
+#define STATS_PAGE_WALK 1
+#define STATS_PAGE_IN 2
+#define STATS_WRITE_BACK 3
+#define STATS_NUM_TIMERS 4
+
+#define STATS_REUSE_BUCKETS 48  // bucket b holds distances [2^b, 2^(b+1))
+
+struct StatsPage {
+    long page_no;       // tagged page, see sim_tag
+    long faults;
+    long evictions;
+    long write_backs;
+    long last_access;   // trace position of the latest access
+};
+
+// running totals at the end of an interval
+struct StatsSnapshot {
+    long accesses;
+    long faults;
+    long tlb_hits;
+    long evictions;
+    long write_backs;
+    long tlb_evictions;
+};
+
+struct SimStats {
+    struct PageMap index;        // tagged page -> pages slot
+    struct StatsPage * pages;
+    int num_pages;
+    int pages_cap;
+    long num_evictions;
+    long num_write_backs;
+    long num_tlb_evictions;
+    long num_run_hits;           // TLB hits translated through the PTE of the access before
+    long num_cold;               // first accesses, which have no reuse distance
+    long reuse[STATS_REUSE_BUCKETS];
+    uint64_t timer_total[STATS_NUM_TIMERS];
+    long timer_count[STATS_NUM_TIMERS];
+    long interval;               // accesses between snapshots, 0 for none
+    long next_snapshot;          // trace position that ends the current interval
+    struct StatsSnapshot * snapshots;
+    int num_snapshots;
+    int snapshots_cap;
+};
+
+int stats_init(struct SimStats* stats, long interval);
+void stats_free(struct SimStats* stats);
+struct StatsPage* stats_page(struct SimStats* stats, long page_no);
+void stats_snapshot(struct SimStats* stats, const struct StatsSnapshot* totals);
+void stats_write(const struct SimStats* stats, FILE* out, int format,
+                 const struct StatsSnapshot* totals, int vpn_bits);
+int stats_parse_format(const char* name);
+void stats_save(const struct SimStats* stats, struct CkptWriter* out);
+int stats_restore(struct SimStats* stats, struct CkptReader* in);
+
+#ifdef VMM_STATS
+#define STATS(stmt) do { stmt; } while (0)
+#else
+#define STATS(stmt) do { } while (0)
+#endif
+
+#ifdef VMM_TIMERS
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define STATS_TIMER_UNIT "cycles"
+static inline uint64_t stats_clock(void) {
+    return __rdtsc();
+}
+#else
+#include <time.h>
+#define STATS_TIMER_UNIT "ns"
+static inline uint64_t stats_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+#define STATS_TIMER_START(start) uint64_t start = stats_clock()
+#define STATS_TIMER_STOP(stats, timer, start) \
+    do { \
+        (stats)->timer_total[timer] += stats_clock() - (start); \
+        (stats)->timer_count[timer]++; \
+    } while (0)
+#else
+#define STATS_TIMER_START(start) do { } while (0)
+#define STATS_TIMER_STOP(stats, timer, start) do { } while (0)
+#endif
+
+/**
+ Records an access to page_no at trace position now in the reuse histogram.
+ */
+static inline void stats_access(struct SimStats* stats, long page_no, long now) {
+    struct StatsPage* page = stats_page(stats, page_no);
+    if (page->last_access < 0) {
+        stats->num_cold++;
+    } else {
+        stats->reuse[63 - __builtin_clzl((unsigned long) (now - page->last_access))]++;
+    }
+    page->last_access = now;
+}
+
+#endif
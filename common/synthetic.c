@@ -0,0 +1,190 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "synthetic.h"
+#include "trace.h"
+
+#define SYNTH_STEP 64  // bytes between the accesses of a sequential scan
+
+static const char * const synth_names[SYNTH_NUM_PATTERNS] = {
+    "uniform", "zipf", "sequential", "loop", "phase"
+};
+
+void synth_default_config(struct SynthConfig* config) {
+    memset(config, 0, sizeof(*config));
+    config->pattern = SYNTH_UNIFORM;
+    config->num_records = 1000000;
+    config->address_bits = 16;
+    config->page_size = 256;
+    config->write_ratio = 0.3;
+    config->zipf_exponent = 0.99;
+    config->phase_length = 100000;
+    config->seed = 1;
+}
+
+/**
+ Returns the pattern called name, or -1.
+ */
+int synth_parse_pattern(const char* name) {
+    for (int i = 0; i < SYNTH_NUM_PATTERNS; i++) {
+        if (strcmp(name, synth_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char* synth_pattern_name(int pattern) {
+    return pattern >= 0 && pattern < SYNTH_NUM_PATTERNS ? synth_names[pattern] : "unknown";
+}
+
+const char* synth_pattern_names(void) {
+    return "uniform, zipf, sequential, loop, phase";
+}
+
+// xorshift64*: small, fast and the same on every platform
+static inline uint64_t synth_next(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+// uniform in [0, n)
+static inline uint64_t synth_below(uint64_t* state, uint64_t n) {
+    return (uint64_t) ((synth_next(state) >> 11) * (1.0 / 9007199254740992.0) * n);
+}
+
+static inline double synth_unit(uint64_t* state) {
+    return (synth_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ Returns a random permutation of [0, n), or NULL if memory runs out.
+ */
+static long* synth_permutation(uint64_t* state, long n) {
+    long * perm = (long *) malloc(n * sizeof(long));
+    if (!perm) {
+        return NULL;
+    }
+    for (long i = 0; i < n; i++) {
+        perm[i] = i;
+    }
+    for (long i = n - 1; i > 0; i--) {
+        long j = (long) synth_below(state, i + 1);
+        long t = perm[i];
+        perm[i] = perm[j];
+        perm[j] = t;
+    }
+    return perm;
+}
+
+/**
+ Returns the cumulative Zipf distribution over ranks [0, n) with exponent s,
+ or NULL if memory runs out.
+ */
+static double* synth_zipf_cdf(long n, double s) {
+    double * cdf = (double *) malloc(n * sizeof(double));
+    if (!cdf) {
+        return NULL;
+    }
+    double sum = 0;
+    for (long i = 0; i < n; i++) {
+        sum += 1.0 / pow(i + 1, s);
+        cdf[i] = sum;
+    }
+    for (long i = 0; i < n; i++) {
+        cdf[i] /= sum;
+    }
+    return cdf;
+}
+
+static long synth_zipf_rank(const double* cdf, long n, double u) {
+    long lo = 0, hi = n - 1;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (cdf[mid] < u) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ Generates the trace described by config. Returns a newly allocated array of
+ config->num_records records, or NULL if the configuration is invalid or
+ memory runs out.
+ */
+uint64_t* synth_generate(const struct SynthConfig* config) {
+    if (config->address_bits < 1 || config->address_bits > TRACE_MAX_ADDRESS_BITS ||
+        config->page_size < 1 || config->num_records < 1 ||
+        config->write_ratio < 0 || config->write_ratio > 1) {
+        return NULL;
+    }
+    uint64_t address_space = UINT64_C(1) << config->address_bits;
+    uint64_t page_size = config->page_size;
+    long num_pages = (long) (address_space / page_size);
+    long footprint = config->footprint > 0 ? config->footprint : num_pages;
+    if (num_pages < 1 || footprint > num_pages) {
+        return NULL;
+    }
+    long phase_pages = config->phase_pages > 0 ? config->phase_pages : footprint / 16;
+    phase_pages = phase_pages < 1 ? 1 : phase_pages > footprint ? footprint : phase_pages;
+    if (config->pattern == SYNTH_PHASE && config->phase_length < 1) {
+        return NULL;
+    }
+
+    uint64_t state = config->seed * UINT64_C(0x9E3779B97F4A7C15) | 1;
+    uint64_t * records = (uint64_t *) malloc(config->num_records * sizeof(uint64_t));
+    long * perm = NULL;
+    double * cdf = NULL;
+    if (records && (config->pattern == SYNTH_ZIPF || config->pattern == SYNTH_LOOP)) {
+        perm = synth_permutation(&state, footprint);
+    }
+    if (records && config->pattern == SYNTH_ZIPF) {
+        cdf = synth_zipf_cdf(footprint, config->zipf_exponent);
+    }
+    if (!records || ((config->pattern == SYNTH_ZIPF || config->pattern == SYNTH_LOOP) && !perm) ||
+        (config->pattern == SYNTH_ZIPF && !cdf)) {
+        free(records);
+        free(perm);
+        free(cdf);
+        return NULL;
+    }
+
+    uint64_t scan = 0;
+    long phase_base = 0;
+    for (size_t r = 0; r < config->num_records; r++) {
+        uint64_t address;
+        switch (config->pattern) {
+            case SYNTH_ZIPF:
+                address = perm[synth_zipf_rank(cdf, footprint, synth_unit(&state))] * page_size +
+                          synth_below(&state, page_size);
+                break;
+            case SYNTH_SEQUENTIAL:
+                address = scan;
+                scan = (scan + SYNTH_STEP) % (footprint * page_size);
+                break;
+            case SYNTH_LOOP:
+                address = perm[r % footprint] * page_size + synth_below(&state, page_size);
+                break;
+            case SYNTH_PHASE:
+                if (r % config->phase_length == 0) {
+                    phase_base = (long) synth_below(&state, footprint - phase_pages + 1);
+                }
+                address = (phase_base + synth_below(&state, phase_pages)) * page_size +
+                          synth_below(&state, page_size);
+                break;
+            default:
+                address = synth_below(&state, footprint) * page_size +
+                          synth_below(&state, page_size);
+        }
+        records[r] = address | (synth_unit(&state) < config->write_ratio ? TRACE_WRITE_FLAG : 0);
+    }
+    free(perm);
+    free(cdf);
+    return records;
+}
@@ -0,0 +1,39 @@
+#ifndef SYNTHETIC_H
+#define SYNTHETIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SYNTH_UNIFORM 0     // every page of the footprint equally likely
+#define SYNTH_ZIPF 1        // page popularity follows a Zipf law, hot pages scattered
+#define SYNTH_SEQUENTIAL 2  // a scan through the footprint in 64-byte steps, wrapping
+#define SYNTH_LOOP 3        // one access per page, pages in a fixed cyclic order
+#define SYNTH_PHASE 4       // uniform within a small region that moves every phase
+#define SYNTH_NUM_PATTERNS 5
+
+/**
+ Synthetic address traces. The same configuration and seed always give the
+ same trace: the generator has its own xorshift random number source and does
+ not touch rand(). Records use the version 2 trace layout, process 0, and only
+ touch pages [0, footprint).
+ */
+struct SynthConfig {
+    int pattern;
+    size_t num_records;
+    int address_bits;
+    int page_size;
+    long footprint;        // pages touched, 0 for the whole address space
+    double write_ratio;    // share of accesses that write
+    double zipf_exponent;  // SYNTH_ZIPF skew, 0.99 by default
+    long phase_length;     // SYNTH_PHASE accesses per phase
+    long phase_pages;      // SYNTH_PHASE pages of each phase's region, 0 for footprint / 16
+    uint64_t seed;
+};
+
+void synth_default_config(struct SynthConfig* config);
+int synth_parse_pattern(const char* name);
+const char* synth_pattern_name(int pattern);
+const char* synth_pattern_names(void);
+uint64_t* synth_generate(const struct SynthConfig* config);
+
+#endif
@@ -0,0 +1,109 @@
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "thread_pool.h"
+
+/**
+ Jobs of one thread. The owner takes from the tail, thieves from the head.
+ Jobs are whole simulations, so a lock per deque costs nothing measurable.
+ */
+struct JobDeque {
+    pthread_mutex_t lock;
+    size_t * jobs;
+    size_t head;
+    size_t tail;
+};
+
+struct ThreadPool {
+    struct JobDeque * deques;
+    int num_threads;
+    void (*job)(void* ctx, size_t index);
+    void * ctx;
+};
+
+struct Worker {
+    struct ThreadPool * pool;
+    int id;
+};
+
+static int deque_take(struct JobDeque* deque, int from_tail, size_t* index) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *index = from_tail ? deque->jobs[--deque->tail] : deque->jobs[deque->head++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static void* worker_main(void* arg) {
+    struct Worker * worker = (struct Worker *) arg;
+    struct ThreadPool * pool = worker->pool;
+    size_t index;
+    for (;;) {
+        int found = deque_take(&pool->deques[worker->id], 1, &index);
+        // no job is ever added, so once every deque is empty the work is done
+        for (int i = 1; !found && i < pool->num_threads; i++) {
+            found = deque_take(&pool->deques[(worker->id + i) % pool->num_threads], 0, &index);
+        }
+        if (!found) {
+            return NULL;
+        }
+        pool->job(pool->ctx, index);
+    }
+}
+
+int thread_pool_run(int num_threads, size_t num_jobs, void (*job)(void* ctx, size_t index),
+                    void* ctx) {
+    if (num_threads < 1) {
+        num_threads = 1;
+    }
+    if ((size_t) num_threads > num_jobs) {
+        num_threads = num_jobs > 0 ? (int) num_jobs : 1;
+    }
+    struct ThreadPool pool = { NULL, num_threads, job, ctx };
+    pool.deques = (struct JobDeque *) calloc(num_threads, sizeof(struct JobDeque));
+    size_t * jobs = (size_t *) malloc((num_jobs > 0 ? num_jobs : 1) * sizeof(size_t));
+    struct Worker * workers = (struct Worker *) calloc(num_threads, sizeof(struct Worker));
+    pthread_t * threads = (pthread_t *) calloc(num_threads, sizeof(pthread_t));
+    int ret = -1;
+    if (!pool.deques || !jobs || !workers || !threads) {
+        goto out;
+    }
+
+    // deal the jobs round-robin; deque t owns a contiguous slice of jobs[]
+    size_t next = 0;
+    for (int t = 0; t < num_threads; t++) {
+        struct JobDeque * deque = &pool.deques[t];
+        pthread_mutex_init(&deque->lock, NULL);
+        deque->jobs = jobs + next;
+        for (size_t i = t; i < num_jobs; i += num_threads) {
+            jobs[next++] = i;
+        }
+        deque->tail = jobs + next - deque->jobs;
+    }
+
+    int started = 0;
+    for (; started < num_threads; started++) {
+        workers[started].pool = &pool;
+        workers[started].id = started;
+        if (pthread_create(&threads[started], NULL, worker_main, &workers[started])) {
+            break;
+        }
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    // if some threads failed to start the ones that did have drained every deque
+    ret = started > 0 ? 0 : -1;
+    for (int t = 0; t < num_threads; t++) {
+        pthread_mutex_destroy(&pool.deques[t].lock);
+    }
+out:
+    free(pool.deques);
+    free(jobs);
+    free(workers);
+    free(threads);
+    return ret;
+}
@@ -0,0 +1,16 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+/**
+ Runs job(ctx, i) for every i in [0, num_jobs) on num_threads threads and
+ returns once all of them have finished. Jobs are dealt round-robin to one
+ deque per thread; a thread works from the back of its own deque and, when it
+ runs dry, steals from the front of the others, so long and short jobs even
+ out. Returns 0 on success, -1 if the threads could not be started.
+ */
+int thread_pool_run(int num_threads, size_t num_jobs, void (*job)(void* ctx, size_t index),
+                    void* ctx);
+
+#endif
@@ -0,0 +1,345 @@
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TLB_X86 1
+#endif
+
+#include "tlb.h"
+
+/**
+ Returns the way whose full tag is key among the candidate ways in mask, whose
+ folded tags matched.
+ */
+static inline int tlb_verify(const long* tags, unsigned long mask, long key) {
+    while (mask) {
+        int way = __builtin_ctzl(mask);
+        if (tags[way] == key) {
+            return way;
+        }
+        mask &= mask - 1;
+    }
+    return -1;
+}
+
+static int tlb_scan_scalar(const long* tags, const uint32_t* folded, int num_ways, long key) {
+    for (int way = 0; way < num_ways; way++) {
+        if (tags[way] == key) {
+            return way;
+        }
+    }
+    return -1;
+}
+
+#ifdef TLB_X86
+/**
+ Compares the folded tags 32 at a time, eight per instruction, then checks
+ the full tag of each candidate. Reading past the set is safe: the arrays are
+ padded, and the candidates are cut to the first num_ways.
+ */
+__attribute__((target("avx2")))
+static int tlb_scan_avx2(const long* tags, const uint32_t* folded, int num_ways, long key) {
+    const __m256i k = _mm256_set1_epi32((int) tlb_fold(key));
+    for (int i = 0; i < num_ways; i += 32) {
+        const __m256i * t = (const __m256i *) (folded + i);
+        unsigned long mask =
+            (unsigned long) (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(_mm256_loadu_si256(t), k))) |
+            (unsigned long) (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(_mm256_loadu_si256(t + 1), k))) << 8 |
+            (unsigned long) (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(_mm256_loadu_si256(t + 2), k))) << 16 |
+            (unsigned long) (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(
+                _mm256_cmpeq_epi32(_mm256_loadu_si256(t + 3), k))) << 24;
+        if (num_ways - i < 32) {
+            mask &= (1UL << (num_ways - i)) - 1;
+        }
+        int way = tlb_verify(tags + i, mask, key);
+        if (way >= 0) {
+            return i + way;
+        }
+    }
+    return -1;
+}
+
+/**
+ The same with SSE2, which every x86-64 CPU has: 16 folded tags per round.
+ */
+static int tlb_scan_sse2(const long* tags, const uint32_t* folded, int num_ways, long key) {
+    const __m128i k = _mm_set1_epi32((int) tlb_fold(key));
+    for (int i = 0; i < num_ways; i += 16) {
+        const __m128i * t = (const __m128i *) (folded + i);
+        unsigned long mask =
+            (unsigned long) _mm_movemask_ps(_mm_castsi128_ps(
+                _mm_cmpeq_epi32(_mm_loadu_si128(t), k))) |
+            (unsigned long) _mm_movemask_ps(_mm_castsi128_ps(
+                _mm_cmpeq_epi32(_mm_loadu_si128(t + 1), k))) << 4 |
+            (unsigned long) _mm_movemask_ps(_mm_castsi128_ps(
+                _mm_cmpeq_epi32(_mm_loadu_si128(t + 2), k))) << 8 |
+            (unsigned long) _mm_movemask_ps(_mm_castsi128_ps(
+                _mm_cmpeq_epi32(_mm_loadu_si128(t + 3), k))) << 12;
+        if (num_ways - i < 16) {
+            mask &= (1UL << (num_ways - i)) - 1;
+        }
+        int way = tlb_verify(tags + i, mask, key);
+        if (way >= 0) {
+            return i + way;
+        }
+    }
+    return -1;
+}
+#endif
+
+static const struct {
+    const char * name;
+    TlbScanFn scan;
+} tlb_lookups[] = {
+#ifdef TLB_X86
+    {"avx2", tlb_scan_avx2},
+    {"sse2", tlb_scan_sse2},
+#endif
+    {"scalar", tlb_scan_scalar},
+    {"hash", NULL},
+};
+
+static int tlb_cpu_supports(const char* name) {
+#ifdef TLB_X86
+    if (strcmp(name, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (strcmp(name, "sse2") == 0) {
+        return __builtin_cpu_supports("sse2");
+    }
+#endif
+    return 1;
+}
+
+/**
+ Switches the lookup of an empty TLB to the named method: "avx2", "sse2"
+ or "scalar" scans, or "hash" for the index. Returns 0 on success, -1 if the
+ method is unknown, not supported by this CPU, or a scan of sets this wide.
+ */
+int tlb_set_lookup(struct Tlb* tlb_table, const char* name) {
+    for (size_t i = 0; i < sizeof(tlb_lookups) / sizeof(tlb_lookups[0]); i++) {
+        if (strcmp(name, tlb_lookups[i].name) == 0) {
+            if (!tlb_cpu_supports(name) ||
+                (tlb_lookups[i].scan && tlb_table->num_ways > TLB_SCAN_MAX_WAYS)) {
+                return -1;
+            }
+            tlb_table->scan = tlb_lookups[i].scan;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char* tlb_lookup_name(const struct Tlb* tlb_table) {
+    for (size_t i = 0; i < sizeof(tlb_lookups) / sizeof(tlb_lookups[0]); i++) {
+        if (tlb_lookups[i].scan == tlb_table->scan) {
+            return tlb_lookups[i].name;
+        }
+    }
+    return "hash";
+}
+
+/**
+ Allocates an empty TLB of num_sets * num_ways entries. num_sets must be a power
+ of two. Returns 0 on success, -1 on bad geometry or allocation failure.
+ parameters:
+ struct Tlb* tlb_table: TLB to initialise
+ int num_sets: 1 for a fully associative TLB
+ int num_ways: 1 for a direct-mapped TLB
+ */
+int tlb_init(struct Tlb* tlb_table, int num_sets, int num_ways) {
+    memset(tlb_table, 0, sizeof(*tlb_table));
+    if (num_sets < 1 || num_ways < 1 || (num_sets & (num_sets - 1))) {
+        return -1;
+    }
+    int num_entries = num_sets * num_ways;
+    tlb_table->num_sets = num_sets;
+    tlb_table->num_ways = num_ways;
+    tlb_table->tags = (long *) malloc((num_entries + TLB_SCAN_PAD) * sizeof(long));
+    tlb_table->folded = (uint32_t *) malloc((num_entries + TLB_SCAN_PAD) * sizeof(uint32_t));
+    tlb_table->ptes = (struct PTE *) calloc(num_entries, sizeof(struct PTE));
+    tlb_table->older = (int *) malloc(num_entries * sizeof(int));
+    tlb_table->newer = (int *) malloc(num_entries * sizeof(int));
+    tlb_table->oldest = (int *) malloc(num_sets * sizeof(int));
+    tlb_table->newest = (int *) malloc(num_sets * sizeof(int));
+    tlb_table->free = (int *) malloc(num_sets * sizeof(int));
+    if (!tlb_table->tags || !tlb_table->folded || !tlb_table->ptes || !tlb_table->older ||
+        !tlb_table->newer || !tlb_table->oldest ||
+        !tlb_table->newest || !tlb_table->free || page_map_init(&tlb_table->index, num_entries)) {
+        tlb_free(tlb_table);
+        return -1;
+    }
+    for (int i = 0; i < num_entries + TLB_SCAN_PAD; i++) {
+        tlb_table->tags[i] = TLB_NO_TAG;
+        tlb_table->folded[i] = tlb_fold(TLB_NO_TAG);
+    }
+    // the fastest scan the CPU supports, or the index for wide sets
+    size_t lookup = 0;
+    while (tlb_set_lookup(tlb_table, tlb_lookups[lookup].name)) {
+        lookup++;
+    }
+    for (int set = 0; set < num_sets; set++) {
+        int first = set * num_ways;
+        tlb_table->oldest[set] = -1;
+        tlb_table->newest[set] = -1;
+        tlb_table->free[set] = first;
+        for (int i = first; i < first + num_ways; i++) {
+            tlb_table->newer[i] = i + 1 < first + num_ways ? i + 1 : -1;
+        }
+    }
+    return 0;
+}
+
+void tlb_free(struct Tlb* tlb_table) {
+    free(tlb_table->tags);
+    free(tlb_table->folded);
+    free(tlb_table->ptes);
+    free(tlb_table->older);
+    free(tlb_table->newer);
+    free(tlb_table->oldest);
+    free(tlb_table->newest);
+    free(tlb_table->free);
+    page_map_free(&tlb_table->index);
+    memset(tlb_table, 0, sizeof(*tlb_table));
+}
+
+/**
+ Unlinks entry index from the FIFO of its set.
+ */
+static void tlb_unlink(struct Tlb* tlb_table, int set, int index) {
+    int older = tlb_table->older[index];
+    int newer = tlb_table->newer[index];
+    if (older >= 0) {
+        tlb_table->newer[older] = newer;
+    } else {
+        tlb_table->oldest[set] = newer;
+    }
+    if (newer >= 0) {
+        tlb_table->older[newer] = older;
+    } else {
+        tlb_table->newest[set] = older;
+    }
+}
+
+/**
+ This function adds an entry to the TLB. If the set of logical_pg is full its
+ oldest entry is replaced and copied to *evicted; otherwise evicted->pte.valid
+ is set to 0. Returns the PTE of the new entry.
+ parameters:
+ struct Tlb* tlb_table: a pointer to the TLB table to which an entry must be added to
+ long logical_pg: page number which must be added
+ struct PTE pte: page table entry associated with page # which must be added
+ struct TLBE* evicted: receives the replaced entry
+ */
+struct PTE* tlb_add_entry(struct Tlb* tlb_table, long logical_pg, struct PTE pte,
+                          struct TLBE* evicted) {
+    int set = logical_pg & (tlb_table->num_sets - 1);
+    int index = tlb_table->free[set];
+    if (index >= 0) {
+        tlb_table->free[set] = tlb_table->newer[index];
+        tlb_table->size++;
+        evicted->pte.valid = 0;
+    } else {
+        index = tlb_table->oldest[set];
+        evicted->page_no = tlb_table->tags[index];
+        evicted->pte = tlb_table->ptes[index];
+        tlb_unlink(tlb_table, set, index);
+        if (!tlb_table->scan) {
+            page_map_remove(&tlb_table->index, evicted->page_no);
+        }
+    }
+
+    tlb_table->tags[index] = logical_pg;
+    tlb_table->folded[index] = tlb_fold(logical_pg);
+    tlb_table->ptes[index] = pte;
+    // append to the FIFO of the set
+    tlb_table->older[index] = tlb_table->newest[set];
+    tlb_table->newer[index] = -1;
+    if (tlb_table->newest[set] >= 0) {
+        tlb_table->newer[tlb_table->newest[set]] = index;
+    } else {
+        tlb_table->oldest[set] = index;
+    }
+    tlb_table->newest[set] = index;
+    if (!tlb_table->scan) {
+        page_map_put(&tlb_table->index, logical_pg, index);
+    }
+    return &tlb_table->ptes[index];
+}
+
+/**
+ Invalidates the entry of logical_pg, if any. The FIFO order of the remaining
+ entries of the set is unchanged.
+ parameters:
+ struct Tlb* tlb_table: TLB to update
+ long logical_pg: page whose translation is no longer valid
+ */
+void tlb_remove_entry(struct Tlb* tlb_table, long logical_pg) {
+    int index = tlb_find_entry(tlb_table, logical_pg);
+    if (index < 0) {
+        return;
+    }
+    int set = logical_pg & (tlb_table->num_sets - 1);
+    tlb_unlink(tlb_table, set, index);
+    if (!tlb_table->scan) {
+        page_map_remove(&tlb_table->index, logical_pg);
+    }
+    tlb_table->tags[index] = TLB_NO_TAG;
+    tlb_table->folded[index] = tlb_fold(TLB_NO_TAG);
+    memset(&tlb_table->ptes[index], 0, sizeof(struct PTE));
+    tlb_table->newer[index] = tlb_table->free[set];
+    tlb_table->free[set] = index;
+    tlb_table->size--;
+}
+
+/**
+ Writes the entries and their FIFO order to a checkpoint. The lookup method
+ is not saved: the folded tags and the index are rebuilt from the tags.
+ */
+void tlb_save(const struct Tlb* tlb_table, struct CkptWriter* out) {
+    int num_entries = tlb_table->num_sets * tlb_table->num_ways;
+    ckpt_write(out, &tlb_table->num_sets, sizeof(tlb_table->num_sets));
+    ckpt_write(out, &tlb_table->num_ways, sizeof(tlb_table->num_ways));
+    ckpt_write(out, &tlb_table->size, sizeof(tlb_table->size));
+    ckpt_write(out, &tlb_table->num_hits, sizeof(tlb_table->num_hits));
+    ckpt_write(out, tlb_table->tags, num_entries * sizeof(long));
+    ckpt_write(out, tlb_table->ptes, num_entries * sizeof(struct PTE));
+    ckpt_write(out, tlb_table->older, num_entries * sizeof(int));
+    ckpt_write(out, tlb_table->newer, num_entries * sizeof(int));
+    ckpt_write(out, tlb_table->oldest, tlb_table->num_sets * sizeof(int));
+    ckpt_write(out, tlb_table->newest, tlb_table->num_sets * sizeof(int));
+    ckpt_write(out, tlb_table->free, tlb_table->num_sets * sizeof(int));
+}
+
+/**
+ Loads a TLB saved by tlb_save into one of the same geometry. Returns 0 on
+ success, -1 if the geometry differs or the checkpoint is cut short.
+ */
+int tlb_restore(struct Tlb* tlb_table, struct CkptReader* in) {
+    int num_sets, num_ways;
+    int num_entries = tlb_table->num_sets * tlb_table->num_ways;
+    if (ckpt_read(in, &num_sets, sizeof(num_sets)) || ckpt_read(in, &num_ways, sizeof(num_ways)) ||
+        num_sets != tlb_table->num_sets || num_ways != tlb_table->num_ways ||
+        ckpt_read(in, &tlb_table->size, sizeof(tlb_table->size)) ||
+        ckpt_read(in, &tlb_table->num_hits, sizeof(tlb_table->num_hits)) ||
+        ckpt_read(in, tlb_table->tags, num_entries * sizeof(long)) ||
+        ckpt_read(in, tlb_table->ptes, num_entries * sizeof(struct PTE)) ||
+        ckpt_read(in, tlb_table->older, num_entries * sizeof(int)) ||
+        ckpt_read(in, tlb_table->newer, num_entries * sizeof(int)) ||
+        ckpt_read(in, tlb_table->oldest, num_sets * sizeof(int)) ||
+        ckpt_read(in, tlb_table->newest, num_sets * sizeof(int)) ||
+        ckpt_read(in, tlb_table->free, num_sets * sizeof(int))) {
+        return -1;
+    }
+    page_map_clear(&tlb_table->index);
+    for (int i = 0; i < num_entries; i++) {
+        tlb_table->folded[i] = tlb_fold(tlb_table->tags[i]);
+        if (!tlb_table->scan && tlb_table->tags[i] != TLB_NO_TAG) {
+            page_map_put(&tlb_table->index, tlb_table->tags[i], i);
+        }
+    }
+    return 0;
+}
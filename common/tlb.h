@@ -0,0 +1,92 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdint.h>
+
+#include "checkpoint.h"
+#include "pte.h"
+#include "page_map.h"
+
+#define TLB_NO_TAG -1L         // tag of an empty entry, never a page number
+#define TLB_SCAN_MAX_WAYS 64   // wider sets are looked up through the hash index
+#define TLB_SCAN_PAD 32        // tags read past the last entry by a vector scan
+
+struct TLBE {
+    long page_no;
+    struct PTE pte;
+};
+
+/**
+ Returns the way of key among the num_ways tags of a set, or -1. folded holds
+ the same tags folded to 32 bits.
+ */
+typedef int (*TlbScanFn)(const long* tags, const uint32_t* folded, int num_ways, long key);
+
+/**
+ Set-associative TLB. Entry i belongs to set i / num_ways; a page always goes to
+ set page_no & (num_sets - 1). Within a set entries are replaced in FIFO order,
+ so a single set of 16 ways behaves exactly like the old circular buffer.
+
+ The tags (page numbers) of all entries sit in one contiguous array apart from
+ their PTEs, next to a copy folded to 32 bits. A lookup compares the folded
+ key against every folded tag of its set with a few vector compares (16 ways
+ are one cache line: two AVX2 or four SSE2 compares), then checks the full tag
+ of the candidates. AVX2 is used when the CPU has it, picked at run time; a
+ scalar loop over the full tags is the fallback off x86. Scanning spares the
+ fills and invalidations the upkeep of an index.
+
+ Sets of more than TLB_SCAN_MAX_WAYS ways are found through a hash index from
+ page number to entry instead, which makes hits and invalidations constant
+ time whatever the associativity.
+ */
+struct Tlb {
+    long * tags;           // TLB_NO_TAG for empty entries, TLB_SCAN_PAD extra at the end
+    uint32_t * folded;     // tlb_fold of each tag, padded the same way
+    struct PTE * ptes;
+    // FIFO order of the live entries of each set, oldest first
+    int * older;
+    int * newer;
+    int * oldest;
+    int * newest;
+    // free entries of each set, chained through newer
+    int * free;
+    TlbScanFn scan;        // NULL when the hash index is used
+    struct PageMap index;
+    int num_sets;
+    int num_ways;
+    int size;
+    long num_hits;
+};
+
+int tlb_init(struct Tlb* tlb_table, int num_sets, int num_ways);
+void tlb_free(struct Tlb* tlb_table);
+int tlb_set_lookup(struct Tlb* tlb_table, const char* name);
+const char* tlb_lookup_name(const struct Tlb* tlb_table);
+struct PTE* tlb_add_entry(struct Tlb* tlb_table, long logical_pg, struct PTE pte,
+                          struct TLBE* evicted);
+void tlb_remove_entry(struct Tlb* tlb_table, long logical_pg);
+void tlb_save(const struct Tlb* tlb_table, struct CkptWriter* out);
+int tlb_restore(struct Tlb* tlb_table, struct CkptReader* in);
+
+static inline uint32_t tlb_fold(long tag) {
+    return (uint32_t) tag ^ (uint32_t) ((unsigned long) tag >> 32);
+}
+
+/**
+ Returns the index into tlb_table->ptes of the entry for logical_pg, or -1 if
+ the page is not in the TLB.
+ parameters:
+ struct Tlb* tlb_table: TLB to search
+ long logical_pg: the page to be searched for in the tlb_table
+ */
+static inline int tlb_find_entry(struct Tlb* tlb_table, long logical_pg) {
+    if (tlb_table->scan) {
+        int first = (logical_pg & (tlb_table->num_sets - 1)) * tlb_table->num_ways;
+        int way = tlb_table->scan(tlb_table->tags + first, tlb_table->folded + first,
+                                  tlb_table->num_ways, logical_pg);
+        return way < 0 ? -1 : first + way;
+    }
+    return page_map_get(&tlb_table->index, logical_pg);
+}
+
+#endif
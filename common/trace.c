@@ -0,0 +1,285 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trace.h"
+
+// Size of the chunks read from text traces
+#define TRACE_TEXT_CHUNK (1 << 20)
+
+/**
+ Maps a binary trace into memory. Returns 0 on success, -1 if the header is
+ malformed.
+ parameters:
+ struct TraceReader* reader: reader whose fd is already open
+ size_t file_len: size of the trace file in bytes
+ */
+static int trace_map_binary(struct TraceReader* reader, size_t file_len) {
+    reader->map = mmap(NULL, file_len, PROT_READ, MAP_PRIVATE, reader->fd, 0);
+    if (reader->map == MAP_FAILED) {
+        reader->map = NULL;
+        return -1;
+    }
+    reader->map_len = file_len;
+    madvise(reader->map, file_len, MADV_SEQUENTIAL);
+
+    const struct TraceHeader * header = (const struct TraceHeader *) reader->map;
+    size_t record_size;
+    if (header->version == TRACE_VERSION_COMPACT) {
+        record_size = sizeof(uint32_t);
+    } else if (header->version == TRACE_VERSION_WIDE) {
+        record_size = sizeof(uint64_t);
+    } else {
+        return -1;
+    }
+    if (header->record_size != record_size) {
+        return -1;
+    }
+    // never trust the header past the end of the file
+    size_t available = (file_len - sizeof(struct TraceHeader)) / record_size;
+    reader->num_records = header->num_records < available ? header->num_records : available;
+    reader->records = (const char *) reader->map + sizeof(struct TraceHeader);
+    reader->version = header->version;
+    return 0;
+}
+
+/**
+ Opens a trace file and detects whether it is a binary trace or a text file
+ with one decimal entry per line. Returns 0 on success and -1 on failure.
+ parameters:
+ struct TraceReader* reader: reader to initialise
+ const char* fname: path of the trace
+ int address_bits: width of the addresses in text entries, the write bit is the next bit up
+ */
+int trace_open(struct TraceReader* reader, const char* fname, int address_bits) {
+    memset(reader, 0, sizeof(*reader));
+    reader->address_bits = address_bits;
+    reader->fd = open(fname, O_RDONLY);
+    if (reader->fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(reader->fd, &st)) {
+        trace_close(reader);
+        return -1;
+    }
+
+    char magic[4];
+    if (st.st_size >= (off_t) sizeof(struct TraceHeader) &&
+        pread(reader->fd, magic, sizeof(magic), 0) == sizeof(magic) &&
+        memcmp(magic, TRACE_MAGIC, sizeof(magic)) == 0) {
+        if (trace_map_binary(reader, st.st_size)) {
+            trace_close(reader);
+            return -1;
+        }
+        if (reader->version == TRACE_VERSION_WIDE) {
+            return 0;
+        }
+        // compact records are widened a block at a time
+        reader->block = (uint64_t *) malloc(TRACE_BLOCK_RECORDS * sizeof(uint64_t));
+        if (!reader->block) {
+            trace_close(reader);
+            return -1;
+        }
+        return 0;
+    }
+
+    // fall back to text
+    reader->text_cap = TRACE_TEXT_CHUNK;
+    reader->text = (char *) malloc(reader->text_cap);
+    reader->block = (uint64_t *) malloc(TRACE_BLOCK_RECORDS * sizeof(uint64_t));
+    if (!reader->text || !reader->block) {
+        trace_close(reader);
+        return -1;
+    }
+    posix_fadvise(reader->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return 0;
+}
+
+/**
+ Tops up the text buffer with the next chunk of the file, keeping the unparsed
+ bytes that start at consumed.
+ */
+static void trace_fill_text(struct TraceReader* reader, size_t consumed) {
+    memmove(reader->text, reader->text + consumed, reader->text_len - consumed);
+    reader->text_len -= consumed;
+    while (!reader->text_eof && reader->text_len < reader->text_cap) {
+        ssize_t c = read(reader->fd, reader->text + reader->text_len,
+                         reader->text_cap - reader->text_len);
+        if (c <= 0) {
+            reader->text_eof = 1;
+            break;
+        }
+        reader->text_len += c;
+    }
+}
+
+/**
+ Parses up to TRACE_BLOCK_RECORDS decimal entries. Numbers cut at the end of a
+ chunk are carried over to the next one. Parsing stops for good at the first
+ token that is not a number, like the fscanf loop it replaces.
+ */
+static size_t trace_parse_text(struct TraceReader* reader) {
+    size_t n = 0;
+    size_t i = 0;
+    while (n < TRACE_BLOCK_RECORDS) {
+        const char * text = reader->text;
+        size_t len = reader->text_len;
+        while (i < len && (text[i] == ' ' || text[i] == '\n' || text[i] == '\r' ||
+                           text[i] == '\t' || text[i] == '\v' || text[i] == '\f')) {
+            i++;
+        }
+        // make sure the number is entirely in the buffer
+        size_t end = i;
+        if (end < len && (text[end] == '-' || text[end] == '+')) {
+            end++;
+        }
+        while (end < len && text[end] >= '0' && text[end] <= '9') {
+            end++;
+        }
+        if (end == len && !reader->text_eof) {
+            trace_fill_text(reader, i);
+            i = 0;
+            continue;
+        }
+        if (i == len) {
+            break;
+        }
+
+        int negative = text[i] == '-';
+        if (text[i] == '-' || text[i] == '+') {
+            i++;
+        }
+        if (i == end) {
+            // not a number: nothing more can be read from this trace
+            reader->text_eof = 1;
+            reader->text_len = 0;
+            return n;
+        }
+        uint64_t value = 0;
+        for (; i < end; i++) {
+            value = value * 10 + (text[i] - '0');
+        }
+        reader->block[n++] = trace_from_entry(negative ? -value : value, reader->address_bits);
+    }
+    // drop what was parsed so the next call starts at the unread bytes
+    memmove(reader->text, reader->text + i, reader->text_len - i);
+    reader->text_len -= i;
+    return n;
+}
+
+/**
+ Returns the number of records in the next block of the trace, or 0 at the end
+ of the trace. *records is set to the first record of the block; it stays valid
+ until the next call.
+ parameters:
+ struct TraceReader* reader: open trace
+ const uint64_t** records: receives the block
+ */
+size_t trace_next_block(struct TraceReader* reader, const uint64_t** records) {
+    if (reader->preloaded) {
+        reader->preloaded = 0;
+        *records = reader->all;
+        return reader->num_all;
+    }
+    if (reader->version == TRACE_VERSION_WIDE) {
+        size_t n = reader->num_records - reader->pos;
+        *records = (const uint64_t *) reader->records + reader->pos;
+        reader->pos = reader->num_records;
+        return n;
+    }
+    if (reader->version == TRACE_VERSION_COMPACT) {
+        const uint32_t * compact = (const uint32_t *) reader->records + reader->pos;
+        size_t n = reader->num_records - reader->pos;
+        if (n > TRACE_BLOCK_RECORDS) {
+            n = TRACE_BLOCK_RECORDS;
+        }
+        for (size_t i = 0; i < n; i++) {
+            reader->block[i] = trace_from_entry(compact[i], 16);
+        }
+        reader->pos += n;
+        *records = reader->block;
+        return n;
+    }
+    if (reader->text_eof && reader->text_len == 0) {
+        return 0;
+    }
+    *records = reader->block;
+    return trace_parse_text(reader);
+}
+
+/**
+ Reads the rest of the trace into memory for consumers that need lookahead.
+ Returns the number of records and points *records at them. The next call to
+ trace_next_block returns the same records as a single block. Version 2
+ binary traces are already mapped, so nothing is copied for them.
+ parameters:
+ struct TraceReader* reader: open trace
+ const uint64_t** records: receives the remaining records
+ */
+size_t trace_preload(struct TraceReader* reader, const uint64_t** records) {
+    if (reader->version == TRACE_VERSION_WIDE) {
+        *records = (const uint64_t *) reader->records + reader->pos;
+        return reader->num_records - reader->pos;
+    }
+    size_t cap = TRACE_BLOCK_RECORDS;
+    reader->all = (uint64_t *) malloc(cap * sizeof(uint64_t));
+    reader->num_all = 0;
+    const uint64_t * block;
+    size_t n;
+    while (reader->all && (n = trace_next_block(reader, &block)) > 0) {
+        if (reader->num_all + n > cap) {
+            cap *= 2;
+            uint64_t * all = (uint64_t *) realloc(reader->all, cap * sizeof(uint64_t));
+            if (!all) {
+                free(reader->all);
+                reader->all = NULL;
+                break;
+            }
+            reader->all = all;
+        }
+        memcpy(reader->all + reader->num_all, block, n * sizeof(uint64_t));
+        reader->num_all += n;
+    }
+    if (!reader->all) {
+        fprintf(stderr, "Cannot hold the trace in memory! Exiting program...\n");
+        exit(-1);
+    }
+    reader->preloaded = 1;
+    *records = reader->all;
+    return reader->num_all;
+}
+
+void trace_close(struct TraceReader* reader) {
+    if (reader->map) {
+        munmap(reader->map, reader->map_len);
+    }
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    free(reader->text);
+    free(reader->block);
+    free(reader->all);
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+}
+
+/**
+ Writes a binary trace header. Returns 0 on success.
+ parameters:
+ FILE* fh: output positioned at the start of the file
+ int version: TRACE_VERSION_COMPACT or TRACE_VERSION_WIDE
+ uint64_t num_records: number of records that follow the header
+ */
+int trace_write_header(FILE* fh, int version, uint64_t num_records) {
+    struct TraceHeader header;
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = version;
+    header.record_size = version == TRACE_VERSION_COMPACT ? sizeof(uint32_t) : sizeof(uint64_t);
+    header.num_records = num_records;
+    return fwrite(&header, sizeof(header), 1, fh) == 1 ? 0 : -1;
+}
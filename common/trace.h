@@ -0,0 +1,98 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ Binary trace format. A trace file starts with a 16 byte header followed by
+ num_records fixed-width little-endian records.
+ Version 1 records are 4 bytes and use the same encoding as a line of
+ addresses.txt: bits 0-15 hold the logical address, bit 16 is the write bit
+ and bits 17-31 the process ID.
+ Version 2 records are 8 bytes: bits 0-47 hold the logical address, bit 63 is
+ the write bit and bits 48-62 the process ID.
+
+ Whatever the input, the reader hands out version 2 records. Text entries
+ carry the write bit just above the address, at bit address_bits, and the
+ process ID above that. Single-process traces leave the process ID 0.
+ */
+#define TRACE_MAGIC "VMTR"
+#define TRACE_VERSION_COMPACT 1
+#define TRACE_VERSION_WIDE 2
+
+#define TRACE_MAX_ADDRESS_BITS 48
+#define TRACE_ADDRESS_MASK ((UINT64_C(1) << TRACE_MAX_ADDRESS_BITS) - 1)
+#define TRACE_WRITE_FLAG (UINT64_C(1) << 63)
+#define TRACE_PID_SHIFT 48
+#define TRACE_MAX_PROCESSES (1 << 15)
+
+struct TraceHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t record_size;
+    uint64_t num_records;
+};
+
+// Number of records handed out per trace_next_block call for text traces
+#define TRACE_BLOCK_RECORDS 65536
+
+struct TraceReader {
+    int fd;
+    int version;     // 0 for text traces
+    int address_bits;
+    // binary traces: records point straight into the mapping
+    void * map;
+    size_t map_len;
+    const void * records;
+    size_t num_records;
+    size_t pos;
+    // text traces: raw bytes are read in large chunks and parsed by hand
+    char * text;
+    size_t text_len;
+    size_t text_cap;
+    int text_eof;
+    uint64_t * block;
+    // whole trace kept in memory by trace_preload
+    uint64_t * all;
+    size_t num_all;
+    int preloaded;
+};
+
+int trace_open(struct TraceReader* reader, const char* fname, int address_bits);
+size_t trace_next_block(struct TraceReader* reader, const uint64_t** records);
+size_t trace_preload(struct TraceReader* reader, const uint64_t** records);
+void trace_close(struct TraceReader* reader);
+
+int trace_write_header(FILE* fh, int version, uint64_t num_records);
+
+static inline uint64_t trace_address(uint64_t record) {
+    return record & TRACE_ADDRESS_MASK;
+}
+
+static inline int trace_is_write(uint64_t record) {
+    return record >> 63;
+}
+
+static inline unsigned trace_pid(uint64_t record) {
+    return (record >> TRACE_PID_SHIFT) & (TRACE_MAX_PROCESSES - 1);
+}
+
+/**
+ Converts a text (or version 1) entry, whose write bit sits at bit
+ address_bits and process ID above it, to a version 2 record, and back.
+ */
+static inline uint64_t trace_from_entry(uint64_t entry, int address_bits) {
+    uint64_t address = entry & ((UINT64_C(1) << address_bits) - 1);
+    uint64_t pid = (entry >> (address_bits + 1)) & (TRACE_MAX_PROCESSES - 1);
+    return address | ((entry >> address_bits) & 1 ? TRACE_WRITE_FLAG : 0) |
+           pid << TRACE_PID_SHIFT;
+}
+
+static inline uint64_t trace_to_entry(uint64_t record, int address_bits) {
+    return trace_address(record) | ((uint64_t) trace_is_write(record) << address_bits) |
+           (uint64_t) trace_pid(record) << (address_bits + 1);
+}
+
+#endif
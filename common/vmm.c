@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulator.h"
+#include "trace.h"
+#include "vmm.h"
+
+_Static_assert(VMM_WRITE_FLAG == TRACE_WRITE_FLAG && VMM_PID_SHIFT == TRACE_PID_SHIFT,
+               "library records must be trace records");
+
+struct Vmm {
+    struct Simulator sim;
+    struct BackStore store;
+};
+
+/**
+ Fills config with the geometry of the original assignment (16-bit addresses,
+ 256-byte pages, a 16-entry FIFO TLB), 128 frames under FIFO replacement and
+ a zero-filled 64 KiB backing store.
+ */
+void vmm_default_config(struct VmmConfig* config) {
+    struct SimConfig defaults;
+    sim_default_config(&defaults);
+    memset(config, 0, sizeof(*config));
+    config->address_bits = defaults.address_bits;
+    config->page_size = defaults.page_size;
+    config->num_frames = 128;
+    config->tlb_sets = defaults.tlb_sets;
+    config->tlb_ways = defaults.tlb_ways;
+    config->policy = defaults.policy;
+    config->num_processes = defaults.num_processes;
+    config->back_store_size = 1L << defaults.address_bits;
+    config->page_runs = defaults.page_runs;
+}
+
+/**
+ Opens the backing store of config: the file itself when dirty pages are to
+ be written back to it, otherwise a private copy of it, or of zeros when
+ there is no file. Returns 0 on success.
+ */
+static int vmm_open_store(struct BackStore* store, const struct VmmConfig* config) {
+    if (config->back_store && config->write_back) {
+        return back_store_open(store, config->back_store, "stdio", 1, 0);
+    }
+    if (config->back_store) {
+        struct BackStore file;
+        if (back_store_open(&file, config->back_store, "mmap", 0, 0)) {
+            return -1;
+        }
+        int ret = back_store_open_memory(store, file.map, file.size);
+        back_store_close(&file);
+        return ret;
+    }
+    if (config->back_store_size < 0) {
+        return -1;
+    }
+    char* zeros = (char *) calloc(config->back_store_size > 0 ? config->back_store_size : 1, 1);
+    int ret = zeros ? back_store_open_memory(store, zeros, config->back_store_size) : -1;
+    free(zeros);
+    return ret;
+}
+
+/**
+ Creates a simulator described by config. Returns NULL, with the reason on
+ stderr, if the configuration is invalid or the backing store cannot be
+ opened.
+ */
+struct Vmm* vmm_create(const struct VmmConfig* config) {
+    struct SimConfig sim_config;
+    sim_default_config(&sim_config);
+    sim_config.address_bits = config->address_bits;
+    sim_config.page_size = config->page_size;
+    sim_config.num_frames = config->num_frames;
+    sim_config.tlb_sets = config->tlb_sets;
+    sim_config.tlb_ways = config->tlb_ways;
+    sim_config.tlb_lookup = config->tlb_lookup;
+    sim_config.policy = config->policy;
+    sim_config.num_processes = config->num_processes;
+    sim_config.page_runs = config->page_runs;
+    sim_config.quiet = 1;
+
+    struct Vmm* vmm = (struct Vmm *) calloc(1, sizeof(struct Vmm));
+    if (!vmm) {
+        fprintf(stderr, "Cannot allocate a simulator\n");
+        return NULL;
+    }
+    if (vmm_open_store(&vmm->store, config)) {
+        fprintf(stderr, "Cannot open back store %s\n",
+                config->back_store ? config->back_store : "in memory");
+        free(vmm);
+        return NULL;
+    }
+    if (sim_init(&vmm->sim, &sim_config, &vmm->store)) {
+        back_store_close(&vmm->store);
+        free(vmm);
+        return NULL;
+    }
+    // the library never sees the whole trace in advance
+    if (frame_table_policy_ops(&vmm->sim.frame_table)->prepare) {
+        fprintf(stderr, "Policy %s needs the whole trace in advance\n", config->policy);
+        vmm_destroy(vmm);
+        return NULL;
+    }
+    return vmm;
+}
+
+/**
+ Translates n accesses in order, storing the translation of addrs[i] in
+ out[i]. A batch with an access by a process beyond num_processes is refused
+ before anything in it is translated. Returns 0, or -1 with the reason on
+ stderr.
+ */
+int vmm_translate_batch(struct Vmm* vmm, const uint64_t* addrs, size_t n,
+                        struct VmmTranslation* out) {
+    unsigned num_processes = vmm->sim.num_processes;
+    for (size_t i = 0; i < n; i++) {
+        if (trace_pid(addrs[i]) >= num_processes) {
+            fprintf(stderr, "Access %zu is by process %u, but only %u processes are simulated\n",
+                    i, trace_pid(addrs[i]), num_processes);
+            return -1;
+        }
+    }
+    return sim_translate(&vmm->sim, addrs, n, out);
+}
+
+/**
+ Fills stats with the totals of every access translated so far.
+ */
+void vmm_stats(const struct Vmm* vmm, struct VmmStats* stats) {
+    stats->accesses = vmm->sim.num_entries;
+    stats->page_faults = sim_num_faults(&vmm->sim);
+    stats->tlb_hits = vmm->sim.tlb.num_hits;
+    stats->dirty_pages = frame_table_count_dirty(&vmm->sim.frame_table);
+}
+
+/**
+ Frees a simulator. Writes still queued for the backing store are completed;
+ dirty pages still resident are not written back, as at the end of a
+ simulator run.
+ */
+void vmm_destroy(struct Vmm* vmm) {
+    if (!vmm) {
+        return;
+    }
+    sim_flush(&vmm->sim);
+    sim_free(&vmm->sim);
+    back_store_close(&vmm->store);
+    free(vmm);
+}
@@ -0,0 +1,63 @@
+#ifndef VMM_H
+#define VMM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ libvmm, the simulator as a library for other programs. A struct Vmm is an
+ opaque simulator with its own TLB, page tables, frames and backing store.
+ Accesses go in as an array of records and their translations come out as an
+ array, so a batch of any size costs one call and the translation loop runs
+ without printing anything. Build with make in lib/, which leaves libvmm.a
+ and libvmm.so in lib/plain/, and link with -lvmm -pthread.
+
+ A record is the logical address in bits 0-47, VMM_WRITE_FLAG for a write
+ and the process ID from VMM_PID_SHIFT up: the record format of binary
+ traces (see trace.h). The library never ends the program: errors are
+ reported on stderr and returned. vmm_translate_batch refuses a batch with an
+ access by a process beyond num_processes; after a backing-store I/O error
+ it returns -1 for that batch and every later one, and the simulator is only
+ good for vmm_stats and vmm_destroy.
+ */
+#define VMM_WRITE_FLAG (UINT64_C(1) << 63)
+#define VMM_PID_SHIFT 48
+
+struct Vmm;
+
+struct VmmConfig {
+    int address_bits;
+    int page_size;
+    int num_frames;           // 0 for one frame per page: no replacement ever happens
+    int tlb_sets;
+    int tlb_ways;
+    const char * tlb_lookup;  // TLB lookup method, NULL for the fastest the CPU supports
+    const char * policy;      // replacement policy, except opt, which needs the whole trace
+    int num_processes;
+    const char * back_store;  // backing store file, NULL for back_store_size zero bytes
+    long back_store_size;
+    int write_back;           // write dirty pages to the file instead of a private copy
+    int page_runs;            // skip the TLB lookup of a repeat of the page before
+};
+
+struct VmmTranslation {
+    uint64_t physical_addr;
+    int value;                // the byte at the address after the access
+    int dirty;                // the dirty bit of the page after the access
+};
+
+struct VmmStats {
+    long accesses;
+    long page_faults;
+    long tlb_hits;
+    long dirty_pages;         // resident pages not yet written back
+};
+
+void vmm_default_config(struct VmmConfig* config);
+struct Vmm* vmm_create(const struct VmmConfig* config);
+int vmm_translate_batch(struct Vmm* vmm, const uint64_t* addrs, size_t n,
+                        struct VmmTranslation* out);
+void vmm_stats(const struct Vmm* vmm, struct VmmStats* stats);
+void vmm_destroy(struct Vmm* vmm);
+
+#endif
@@ -0,0 +1,151 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+
+#include "write_behind.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/**
+ Allocates an empty queue of capacity pages. Returns 0 on success.
+ */
+int write_behind_init(struct WriteBehind* queue, int capacity, int page_size) {
+    memset(queue, 0, sizeof(*queue));
+    queue->capacity = capacity;
+    queue->page_size = page_size;
+    queue->buffer = (char *) malloc((size_t) capacity * page_size);
+    queue->page_of = (long *) malloc(capacity * sizeof(long));
+    if (!queue->buffer || !queue->page_of || page_map_init(&queue->index, capacity)) {
+        write_behind_free(queue);
+        return -1;
+    }
+    return 0;
+}
+
+void write_behind_free(struct WriteBehind* queue) {
+    free(queue->buffer);
+    free(queue->page_of);
+    page_map_free(&queue->index);
+    queue->buffer = NULL;
+    queue->page_of = NULL;
+}
+
+/**
+ Queues the contents of page_no, replacing an older copy of the same page.
+ Returns 1 once the queue is full and must be flushed, 0 otherwise.
+ */
+int write_behind_put(struct WriteBehind* queue, long page_no, const void* data) {
+    int slot = page_map_get(&queue->index, page_no);
+    if (slot < 0) {
+        slot = queue->num_queued++;
+        queue->page_of[slot] = page_no;
+        page_map_put(&queue->index, page_no, slot);
+    }
+    memcpy(queue->buffer + (size_t) slot * queue->page_size, data, queue->page_size);
+    return queue->num_queued == queue->capacity;
+}
+
+static int compare_pages(const void* a, const void* b, void* page_of) {
+    long pa = ((long *) page_of)[*(const int *) a];
+    long pb = ((long *) page_of)[*(const int *) b];
+    return pa < pb ? -1 : pa > pb;
+}
+
+/**
+ Writes every queued page to fd and empties the queue. Pages are sorted and
+ each run of consecutive page numbers (up to IOV_MAX pages) is written with
+ one pwritev. A page that extends past store_size is cut short, as the
+ backing store does not grow. Exits on a write error.
+ */
+void write_behind_flush(struct WriteBehind* queue, int fd, long store_size) {
+    if (queue->num_queued == 0) {
+        return;
+    }
+    int * order = (int *) malloc(queue->num_queued * sizeof(int));
+    struct iovec * iov = (struct iovec *) malloc(IOV_MAX * sizeof(struct iovec));
+    if (!order || !iov) {
+        fprintf(stderr, "Cannot flush write-behind queue: out of memory\n");
+        exit(-1);
+    }
+    for (int i = 0; i < queue->num_queued; i++) {
+        order[i] = i;
+    }
+    qsort_r(order, queue->num_queued, sizeof(int), compare_pages, queue->page_of);
+
+    int i = 0;
+    while (i < queue->num_queued) {
+        long first = queue->page_of[order[i]];
+        long start = first * queue->page_size;
+        int count = 0;
+        size_t len = 0;
+        while (i < queue->num_queued && count < IOV_MAX &&
+               queue->page_of[order[i]] == first + count) {
+            long page_start = start + (long) count * queue->page_size;
+            long page_len = store_size - page_start < queue->page_size ? store_size - page_start
+                                                                       : queue->page_size;
+            iov[count].iov_base = queue->buffer + (size_t) order[i] * queue->page_size;
+            iov[count].iov_len = page_len;
+            len += page_len;
+            count++;
+            i++;
+        }
+        ssize_t written = pwritev(fd, iov, count, start);
+        if (written < 0 || (size_t) written != len) {
+            fprintf(stderr, "Cannot write to back store: %s\n",
+                    written < 0 ? strerror(errno) : "short write");
+            exit(-1);
+        }
+        queue->bytes_written += written;
+        queue->pages_written += count;
+        queue->num_syscalls++;
+    }
+    queue->num_queued = 0;
+    page_map_clear(&queue->index);
+    free(order);
+    free(iov);
+}
+
+/**
+ Writes the queued pages and the counters to a checkpoint.
+ */
+void write_behind_save(const struct WriteBehind* queue, struct CkptWriter* out) {
+    ckpt_write(out, &queue->capacity, sizeof(queue->capacity));
+    ckpt_write(out, &queue->num_queued, sizeof(queue->num_queued));
+    ckpt_write(out, &queue->bytes_written, sizeof(queue->bytes_written));
+    ckpt_write(out, &queue->num_syscalls, sizeof(queue->num_syscalls));
+    ckpt_write(out, &queue->pages_written, sizeof(queue->pages_written));
+    ckpt_write(out, queue->page_of, queue->num_queued * sizeof(long));
+    ckpt_write(out, queue->buffer, (size_t) queue->num_queued * queue->page_size);
+}
+
+/**
+ Refills an empty queue of the same capacity from a checkpoint. Returns 0 on
+ success, -1 if it does not fit or is corrupt.
+ */
+int write_behind_restore(struct WriteBehind* queue, struct CkptReader* in) {
+    int capacity, num_queued;
+    const char * buffer;
+    if (ckpt_read(in, &capacity, sizeof(capacity)) || capacity != queue->capacity ||
+        ckpt_read(in, &num_queued, sizeof(num_queued)) || num_queued < 0 ||
+        num_queued > capacity ||
+        ckpt_read(in, &queue->bytes_written, sizeof(queue->bytes_written)) ||
+        ckpt_read(in, &queue->num_syscalls, sizeof(queue->num_syscalls)) ||
+        ckpt_read(in, &queue->pages_written, sizeof(queue->pages_written)) ||
+        ckpt_read(in, queue->page_of, num_queued * sizeof(long)) ||
+        !(buffer = (const char *) ckpt_view(in, (size_t) num_queued * queue->page_size))) {
+        return -1;
+    }
+    queue->num_queued = 0;
+    page_map_clear(&queue->index);
+    for (int i = 0; i < num_queued; i++) {
+        write_behind_put(queue, queue->page_of[i], buffer + (size_t) i * queue->page_size);
+    }
+    return 0;
+}
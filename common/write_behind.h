@@ -0,0 +1,41 @@
+#ifndef WRITE_BEHIND_H
+#define WRITE_BEHIND_H
+
+#include "checkpoint.h"
+#include "page_map.h"
+
+/**
+ Write-behind queue for dirty evictions. Evicted pages are copied into the
+ queue instead of being written at once; when the queue is full (and at exit)
+ it is flushed in page order, each run of consecutive page numbers going out
+ in a single pwritev. A page that faults back in before the flush is served
+ from the queue, which holds its latest contents.
+ */
+struct WriteBehind {
+    int capacity;          // pages held before a flush
+    int page_size;
+    char * buffer;         // capacity pages
+    long * page_of;        // page held by each slot
+    int num_queued;
+    struct PageMap index;  // page -> slot
+    long bytes_written;
+    long num_syscalls;
+    long pages_written;
+};
+
+int write_behind_init(struct WriteBehind* queue, int capacity, int page_size);
+void write_behind_free(struct WriteBehind* queue);
+int write_behind_put(struct WriteBehind* queue, long page_no, const void* data);
+void write_behind_flush(struct WriteBehind* queue, int fd, long store_size);
+void write_behind_save(const struct WriteBehind* queue, struct CkptWriter* out);
+int write_behind_restore(struct WriteBehind* queue, struct CkptReader* in);
+
+/**
+ Returns the queued contents of page_no, or NULL if it is not queued.
+ */
+static inline const char* write_behind_find(const struct WriteBehind* queue, long page_no) {
+    int slot = page_map_get(&queue->index, page_no);
+    return slot >= 0 ? queue->buffer + (size_t) slot * queue->page_size : NULL;
+}
+
+#endif
@@ -0,0 +1,70 @@
+#!/bin/sh
+# Checks of simulator behaviour that out.txt does not cover. Run from tools/
+# after building part2 and trace_gen (make check does both). Every trace and
+# backing store is generated into a scratch directory; data/ is not touched.
+set -e
+SIM=../part2/virtual_manager
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+FAILED=0
+
+fail() {
+    echo "FAIL: $*"
+    FAILED=1
+}
+
+# prints the value of a "Name: value" line of the statistics
+stat() {
+    sed -n "s/^$1: //p" "$2"
+}
+
+# compressed tier: pages that are all zeros still count against the budget,
+# so a tier too small for a loop over 200 pages never hits
+head -c 4194304 /dev/zero > "$DIR/zero.store"
+./trace_gen -g loop -a 20 -p 4096 -m 200 -n 20000 -x 0 "$DIR/loop.bin" > /dev/null
+$SIM -a 20 -p 4096 -f 16 -Z 6400 -o summary "$DIR/loop.bin" "$DIR/zero.store" > "$DIR/tier.out"
+hits=$(stat "Compressed tier hit rate" "$DIR/tier.out")
+same=$(stat "Compressed tier same-filled pages" "$DIR/tier.out")
+[ "$same" -gt 0 ] || fail "tier: no same-filled pages stored"
+[ "$hits" = "0.000000" ] || fail "tier: same-filled pages exceed the budget (hit rate $hits)"
+$SIM -a 20 -p 4096 -f 16 -Z 13000 -o summary "$DIR/loop.bin" "$DIR/zero.store" > "$DIR/tier.out"
+hits=$(stat "Compressed tier hit rate" "$DIR/tier.out")
+[ "$hits" = "0.990000" ] || fail "tier: a budget for every page should serve the loop (hit rate $hits)"
+
+# sampling: the sampled TLB hit rate tracks the exact one with set-associative
+# TLBs too, not only fully associative ones
+./trace_gen -g zipf -a 32 -p 4096 -n 1000000 "$DIR/zipf.bin" > /dev/null
+tlb_error() {
+    $SIM -a 32 -p 4096 -f 4096 $2 -e $1 -A "$DIR/zipf.bin" "$DIR/zero.store" > "$DIR/sample.out"
+    stat "TLB hit rate error" "$DIR/sample.out" | cut -d' ' -f1
+}
+within() {
+    awk -v a="$1" -v b="$2" -v tol="$3" 'BEGIN { d = a - b; exit !(d >= -tol && d <= tol) }'
+}
+for geometry in "-s 1 -w 256" "-s 64 -w 4" "-s 256 -w 8"; do
+    error=$(tlb_error 0.1 "$geometry")
+    within "$error" 0 0.05 || fail "sampling: TLB hit rate error $error with $geometry"
+done
+# at a low rate a set-associative TLB must shrink as far as a fully associative
+# one of the same size, so their errors agree
+full=$(tlb_error 0.02 "-s 1 -w 512")
+for geometry in "-s 64 -w 8" "-s 512 -w 1"; do
+    error=$(tlb_error 0.02 "$geometry")
+    within "$error" "$full" 0.02 ||
+        fail "sampling: TLB hit rate error $error with $geometry, $full fully associative"
+done
+
+# huge pages model TLB reach only: translations, values and the backing store
+# are those of a run without them
+./trace_gen -g zipf -n 200000 "$DIR/huge.bin" > /dev/null
+head -c 65536 /dev/urandom > "$DIR/huge.store"
+cp "$DIR/huge.store" "$DIR/base.store"
+$SIM "$DIR/huge.bin" "$DIR/base.store" | grep '^0x' > "$DIR/base.out"
+cp "$DIR/huge.store" "$DIR/huge4.store"
+$SIM -H 4 "$DIR/huge.bin" "$DIR/huge4.store" | grep '^0x' > "$DIR/huge4.out"
+cmp -s "$DIR/huge.store" "$DIR/base.store" && fail "huge pages: the trace wrote no page back"
+cmp -s "$DIR/base.out" "$DIR/huge4.out" || fail "huge pages: translations differ with -H 4"
+cmp -s "$DIR/base.store" "$DIR/huge4.store" || fail "huge pages: backing store differs with -H 4"
+
+[ $FAILED -eq 0 ] && echo "all checks passed"
+exit $FAILED
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "simulator.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+#define SWEEP_MAX_VALUES 64
+
+/**
+ Runs the part 2 simulator over every combination of the given page sizes,
+ frame counts, policies and TLB geometries. The trace and the backing store
+ are read once; each simulation gets its own TLB, page table, frames and a
+ private in-memory copy of the backing store, and simulations run in parallel
+ on a work-stealing thread pool. One row per combination is written to
+ stdout, as CSV or JSON, in the order of the combinations.
+ */
+struct SweepJob {
+    struct SimConfig config;
+    int failed;
+    long num_entries;
+    long num_faults;
+    long num_hits;
+    int num_dirty;
+};
+
+struct Sweep {
+    const uint64_t * records;
+    size_t num_records;
+    const char * back_store;
+    long back_store_size;
+    struct SweepJob * jobs;
+};
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options] <addresses> <backing store>\n"
+            "  -a, --address-bits N      width of logical addresses (default 16)\n"
+            "  -p, --page-size N,...     page sizes in bytes (default 256)\n"
+            "  -f, --frames N,...        numbers of physical frames (default 128)\n"
+            "  -r, --policy NAME,...     replacement policies: %s (default fifo)\n"
+            "  -s, --tlb-sets N,...      numbers of TLB sets (default 1)\n"
+            "  -w, --tlb-ways N,...      entries per TLB set (default 16)\n"
+            "  -N, --processes N         address spaces in the trace (default 1)\n"
+            "  -L, --local               local instead of global page replacement\n"
+            "  -j, --threads N           worker threads (default: online CPUs)\n"
+            "  -o, --format csv|json     results table format (default csv)\n",
+            prog, policy_names());
+    exit(-1);
+}
+
+/**
+ Splits a comma separated list in place. Returns the number of values.
+ */
+static int split_list(char* arg, char** values) {
+    int n = 0;
+    for (char * value = strtok(arg, ","); value; value = strtok(NULL, ",")) {
+        if (n == SWEEP_MAX_VALUES) {
+            return -1;
+        }
+        values[n++] = value;
+    }
+    return n;
+}
+
+static int parse_ints(char* arg, int* values) {
+    char * strings[SWEEP_MAX_VALUES];
+    int n = split_list(arg, strings);
+    for (int i = 0; i < n; i++) {
+        values[i] = atoi(strings[i]);
+        if (values[i] < 1) {
+            return -1;
+        }
+    }
+    return n;
+}
+
+static void run_job(void* ctx, size_t index) {
+    struct Sweep * sweep = (struct Sweep *) ctx;
+    struct SweepJob * job = &sweep->jobs[index];
+    job->failed = 1;
+    struct BackStore store;
+    if (back_store_open_memory(&store, sweep->back_store, sweep->back_store_size)) {
+        return;
+    }
+    struct Simulator sim;
+    if (sim_init(&sim, &job->config, &store) == 0) {
+        if (sim_prepare(&sim, sweep->records, sweep->num_records) == 0) {
+            job->failed = sim_run(&sim, sweep->records, sweep->num_records) != 0;
+            job->num_entries = sim.num_entries;
+            job->num_faults = sim_num_faults(&sim);
+            job->num_hits = sim.tlb.num_hits;
+            job->num_dirty = frame_table_count_dirty(&sim.frame_table);
+        }
+        sim_free(&sim);
+    }
+    back_store_close(&store);
+}
+
+static void print_results(const struct Sweep* sweep, size_t num_jobs, int json) {
+    if (json) {
+        printf("[\n");
+    } else {
+        printf("policy,page_size,frames,tlb_sets,tlb_ways,accesses,page_faults,page_fault_rate,"
+               "tlb_hits,tlb_hit_rate,dirty_pages\n");
+    }
+    for (size_t i = 0; i < num_jobs; i++) {
+        const struct SweepJob * job = &sweep->jobs[i];
+        const struct SimConfig * c = &job->config;
+        double n = job->num_entries > 0 ? (double) job->num_entries : 1.0;
+        if (json) {
+            printf("  {\"policy\": \"%s\", \"page_size\": %d, \"frames\": %d, \"tlb_sets\": %d, "
+                   "\"tlb_ways\": %d, \"accesses\": %ld, \"page_faults\": %ld, "
+                   "\"page_fault_rate\": %f, \"tlb_hits\": %ld, \"tlb_hit_rate\": %f, "
+                   "\"dirty_pages\": %d}%s\n",
+                   c->policy, c->page_size, c->num_frames, c->tlb_sets, c->tlb_ways,
+                   job->num_entries, job->num_faults, job->num_faults / n, job->num_hits,
+                   job->num_hits / n, job->num_dirty, i + 1 < num_jobs ? "," : "");
+        } else {
+            printf("%s,%d,%d,%d,%d,%ld,%ld,%f,%ld,%f,%d\n",
+                   c->policy, c->page_size, c->num_frames, c->tlb_sets, c->tlb_ways,
+                   job->num_entries, job->num_faults, job->num_faults / n, job->num_hits,
+                   job->num_hits / n, job->num_dirty);
+        }
+    }
+    if (json) {
+        printf("]\n");
+    }
+}
+
+int main (int argc, char** argv) {
+    static const struct option long_options[] = {
+        {"address-bits", required_argument, NULL, 'a'},
+        {"page-size", required_argument, NULL, 'p'},
+        {"frames", required_argument, NULL, 'f'},
+        {"policy", required_argument, NULL, 'r'},
+        {"tlb-sets", required_argument, NULL, 's'},
+        {"tlb-ways", required_argument, NULL, 'w'},
+        {"processes", required_argument, NULL, 'N'},
+        {"local", no_argument, NULL, 'L'},
+        {"threads", required_argument, NULL, 'j'},
+        {"format", required_argument, NULL, 'o'},
+        {NULL, 0, NULL, 0}
+    };
+    struct SimConfig base;
+    sim_default_config(&base);
+    base.quiet = 1;
+    int page_sizes[SWEEP_MAX_VALUES] = { 256 };
+    int frames[SWEEP_MAX_VALUES] = { 128 };
+    int tlb_sets[SWEEP_MAX_VALUES] = { 1 };
+    int tlb_ways[SWEEP_MAX_VALUES] = { 16 };
+    char * default_policy = "fifo";
+    char ** policies = &default_policy;
+    char * policy_list[SWEEP_MAX_VALUES];
+    int num_page_sizes = 1, num_frames = 1, num_policies = 1, num_sets = 1, num_ways = 1;
+    int num_threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int json = 0;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "a:p:f:r:s:w:N:Lj:o:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'a':
+                base.address_bits = atoi(optarg);
+                break;
+            case 'p':
+                num_page_sizes = parse_ints(optarg, page_sizes);
+                break;
+            case 'f':
+                num_frames = parse_ints(optarg, frames);
+                break;
+            case 'r':
+                num_policies = split_list(optarg, policy_list);
+                policies = policy_list;
+                break;
+            case 's':
+                num_sets = parse_ints(optarg, tlb_sets);
+                break;
+            case 'w':
+                num_ways = parse_ints(optarg, tlb_ways);
+                break;
+            case 'N':
+                base.num_processes = atoi(optarg);
+                break;
+            case 'L':
+                base.local_replacement = 1;
+                break;
+            case 'j':
+                num_threads = atoi(optarg);
+                break;
+            case 'o':
+                if (strcmp(optarg, "csv") && strcmp(optarg, "json")) {
+                    usage(argv[0]);
+                }
+                json = strcmp(optarg, "json") == 0;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind != 2 || num_page_sizes < 1 || num_frames < 1 || num_policies < 1 ||
+        num_sets < 1 || num_ways < 1 || num_threads < 1) {
+        usage(argv[0]);
+    }
+
+    //the whole trace is shared read-only by every simulation
+    struct TraceReader trace;
+    if (trace_open(&trace, argv[optind], base.address_bits)) {
+        fprintf(stderr, "Address file failed to open! Exiting program...\n");
+        exit(-1);
+    }
+    struct Sweep sweep;
+    memset(&sweep, 0, sizeof(sweep));
+    sweep.num_records = trace_preload(&trace, &sweep.records);
+
+    FILE * bfp = fopen(argv[optind + 1], "rb");
+    char * back_store = NULL;
+    if (!bfp || fseek(bfp, 0, SEEK_END) || (sweep.back_store_size = ftell(bfp)) < 0 ||
+        fseek(bfp, 0, SEEK_SET) ||
+        !(back_store = (char *) malloc(sweep.back_store_size > 0 ? sweep.back_store_size : 1)) ||
+        fread(back_store, 1, sweep.back_store_size, bfp) != (size_t) sweep.back_store_size) {
+        fprintf(stderr, "Back store file failed to open! Exiting program...\n");
+        exit(-1);
+    }
+    fclose(bfp);
+    sweep.back_store = back_store;
+
+    size_t num_jobs = (size_t) num_page_sizes * num_frames * num_policies * num_sets * num_ways;
+    sweep.jobs = (struct SweepJob *) calloc(num_jobs, sizeof(struct SweepJob));
+    if (!sweep.jobs) {
+        fprintf(stderr, "Cannot allocate %zu simulations! Exiting program...\n", num_jobs);
+        exit(-1);
+    }
+    size_t j = 0;
+    for (int r = 0; r < num_policies; r++) {
+        for (int p = 0; p < num_page_sizes; p++) {
+            for (int f = 0; f < num_frames; f++) {
+                for (int s = 0; s < num_sets; s++) {
+                    for (int w = 0; w < num_ways; w++) {
+                        struct SimConfig * config = &sweep.jobs[j++].config;
+                        *config = base;
+                        config->policy = policies[r];
+                        config->page_size = page_sizes[p];
+                        config->num_frames = frames[f];
+                        config->tlb_sets = tlb_sets[s];
+                        config->tlb_ways = tlb_ways[w];
+                    }
+                }
+            }
+        }
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (thread_pool_run(num_threads, num_jobs, run_job, &sweep)) {
+        fprintf(stderr, "Cannot start worker threads! Exiting program...\n");
+        exit(-1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    int failed = 0;
+    for (size_t i = 0; i < num_jobs; i++) {
+        if (sweep.jobs[i].failed) {
+            fprintf(stderr, "Simulation %zu (%s, %d-byte pages, %d frames, %dx%d TLB) failed\n", i,
+                    sweep.jobs[i].config.policy, sweep.jobs[i].config.page_size,
+                    sweep.jobs[i].config.num_frames, sweep.jobs[i].config.tlb_sets,
+                    sweep.jobs[i].config.tlb_ways);
+            failed = 1;
+        }
+    }
+    print_results(&sweep, num_jobs, json);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "%zu simulations of %zu accesses on %d threads in %.3f s (%.1f M accesses/s)\n",
+            num_jobs, sweep.num_records, num_threads < (int) num_jobs ? num_threads : (int) num_jobs,
+            seconds, num_jobs * (double) sweep.num_records / seconds / 1e6);
+
+    free(sweep.jobs);
+    free(back_store);
+    trace_close(&trace);
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "tlb.h"
+
+/**
+ Times TLB lookups with every lookup method the CPU supports (vector tag
+ scans, the scalar scan and the hash index) on the same TLB contents and the
+ same random key sequence, and prints one CSV row per method with its speedup
+ over the scalar scan. All methods must find the same entries; a mismatch is
+ reported and fails the run.
+ */
+static const char * const methods[] = { "scalar", "sse2", "avx2", "hash" };
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -s, --tlb-sets N      number of TLB sets, a power of two (default 1)\n"
+            "  -w, --tlb-ways N      entries per TLB set, up to %d (default 16)\n"
+            "  -n, --lookups N       lookups per method (default 20000000)\n"
+            "  -h, --hit-rate P      percentage of lookups that hit (default 90)\n",
+            prog, TLB_SCAN_MAX_WAYS);
+    exit(-1);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    static const struct option long_options[] = {
+        {"tlb-sets", required_argument, NULL, 's'},
+        {"tlb-ways", required_argument, NULL, 'w'},
+        {"lookups", required_argument, NULL, 'n'},
+        {"hit-rate", required_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+    int num_sets = 1, num_ways = 16, hit_rate = 90;
+    long num_lookups = 20000000;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:w:n:h:", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                num_sets = atoi(optarg);
+                break;
+            case 'w':
+                num_ways = atoi(optarg);
+                break;
+            case 'n':
+                num_lookups = atol(optarg);
+                break;
+            case 'h':
+                hit_rate = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind != argc || num_ways < 1 || num_ways > TLB_SCAN_MAX_WAYS || num_lookups < 1 ||
+        hit_rate < 0 || hit_rate > 100) {
+        usage(argv[0]);
+    }
+
+    // every TLB holds pages [0, entries); misses look up pages beyond them
+    long num_entries = (long) num_sets * num_ways;
+    long * keys = (long *) malloc(num_lookups * sizeof(long));
+    if (!keys) {
+        fprintf(stderr, "Cannot allocate %ld lookups\n", num_lookups);
+        exit(-1);
+    }
+    srand(1);
+    for (long i = 0; i < num_lookups; i++) {
+        long r = rand();
+        keys[i] = rand() % 100 < hit_rate ? r % num_entries : num_entries + r % (4 * num_entries);
+    }
+
+    printf("lookup,sets,ways,lookups,seconds,m_lookups_per_s,speedup\n");
+    double scalar_seconds = 0;
+    long expected = -1;
+    int failed = 0;
+    for (size_t m = 0; m < sizeof(methods) / sizeof(methods[0]); m++) {
+        struct Tlb tlb;
+        if (tlb_init(&tlb, num_sets, num_ways)) {
+            fprintf(stderr, "Invalid TLB geometry: %d sets x %d ways\n", num_sets, num_ways);
+            exit(-1);
+        }
+        if (tlb_set_lookup(&tlb, methods[m])) {
+            fprintf(stderr, "Lookup %s is not supported here, skipped\n", methods[m]);
+            tlb_free(&tlb);
+            continue;
+        }
+        struct PTE pte = { 0, 1, 0, 1, PTE_PROT_READ | PTE_PROT_WRITE };
+        struct TLBE evicted;
+        for (long page = 0; page < num_entries; page++) {
+            pte.frame_no = (int) page;
+            tlb_add_entry(&tlb, page, pte, &evicted);
+        }
+
+        long checksum = 0;
+        double start = now_seconds();
+        for (long i = 0; i < num_lookups; i++) {
+            checksum += tlb_find_entry(&tlb, keys[i]);
+        }
+        double seconds = now_seconds() - start;
+        if (expected == -1) {
+            expected = checksum;
+        } else if (checksum != expected) {
+            fprintf(stderr, "Lookup %s found different entries\n", methods[m]);
+            failed = 1;
+        }
+        if (strcmp(methods[m], "scalar") == 0) {
+            scalar_seconds = seconds;
+        }
+        printf("%s,%d,%d,%ld,%.4f,%.1f,%.2f\n", methods[m], num_sets, num_ways, num_lookups,
+               seconds, num_lookups / seconds / 1e6, scalar_seconds / seconds);
+        tlb_free(&tlb);
+    }
+    free(keys);
+    return failed ? -1 : 0;
+}
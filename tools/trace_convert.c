@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "trace.h"
+
+/**
+ Converts an address trace between the text format of addresses.txt (one
+ decimal entry per line) and the binary trace format read by the simulators.
+ By default the output is binary; -t writes text instead. -a gives the width
+ of the addresses in text entries (default 16, the write bit is the next bit
+ up). 16-bit traces are written with compact 4-byte records, wider ones with
+ 8-byte records.
+ */
+int main (int argc, char** argv) {
+    int to_text = 0;
+    int address_bits = 16;
+    int opt;
+    while ((opt = getopt(argc, argv, "ta:")) != -1) {
+        switch (opt) {
+            case 't':
+                to_text = 1;
+                break;
+            case 'a':
+                address_bits = atoi(optarg);
+                break;
+            default:
+                argc = 0;
+        }
+    }
+    if (argc - optind != 2 || address_bits < 1 || address_bits > TRACE_MAX_ADDRESS_BITS) {
+        fprintf(stderr, "Usage: %s [-t] [-a address bits] <input trace> <output trace>\n", argv[0]);
+        exit(-1);
+    }
+
+    struct TraceReader trace;
+    if (trace_open(&trace, argv[optind], address_bits)) {
+        fprintf(stderr, "Input trace failed to open! Exiting program...\n");
+        exit(-1);
+    }
+    FILE * ofp = fopen(argv[optind + 1], to_text ? "w" : "wb");
+    if (!ofp) {
+        fprintf(stderr, "Output trace failed to open! Exiting program...\n");
+        exit(-1);
+    }
+
+    // the record count is patched in once the whole input has been read
+    int version = address_bits == 16 ? TRACE_VERSION_COMPACT : TRACE_VERSION_WIDE;
+    if (!to_text && trace_write_header(ofp, version, 0)) {
+        fprintf(stderr, "Cannot write trace header! Exiting program...\n");
+        exit(-1);
+    }
+
+    uint64_t num_records = 0;
+    const uint64_t * records;
+    size_t n;
+    while ((n = trace_next_block(&trace, &records)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            int written;
+            if (to_text) {
+                written = fprintf(ofp, "%llu\n",
+                                  (unsigned long long) trace_to_entry(records[i], address_bits)) > 0;
+            } else if (version == TRACE_VERSION_COMPACT) {
+                uint32_t entry = trace_to_entry(records[i], 16);
+                written = fwrite(&entry, sizeof(entry), 1, ofp);
+            } else {
+                written = fwrite(&records[i], sizeof(records[i]), 1, ofp);
+            }
+            if (written != 1) {
+                fprintf(stderr, "Cannot write trace records! Exiting program...\n");
+                exit(-1);
+            }
+        }
+        num_records += n;
+    }
+    trace_close(&trace);
+
+    if (!to_text && (fseek(ofp, 0, SEEK_SET) || trace_write_header(ofp, version, num_records))) {
+        fprintf(stderr, "Cannot write trace header! Exiting program...\n");
+        exit(-1);
+    }
+    fclose(ofp);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "synthetic.h"
+#include "trace.h"
+
+/**
+ Writes a synthetic address trace (see synthetic.h). By default the output is
+ a binary trace with 8-byte records, or 4-byte records for 16-bit addresses;
+ -t writes text entries like addresses.txt instead. The same options and seed
+ always write the same trace.
+ */
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options] <output trace>\n"
+            "  -g, --pattern NAME        access pattern: %s (default uniform)\n"
+            "  -n, --records N           number of accesses (default 1000000)\n"
+            "  -a, --address-bits N      width of logical addresses (default 16)\n"
+            "  -p, --page-size N         page size in bytes (default 256)\n"
+            "  -m, --footprint N         pages touched (default: the whole address space)\n"
+            "  -x, --write-ratio R       share of accesses that write (default 0.3)\n"
+            "  -z, --zipf-exponent S     skew of the zipf pattern (default 0.99)\n"
+            "  -l, --phase-length N      accesses per phase of the phase pattern (default 100000)\n"
+            "  -P, --phase-pages N       pages of each phase (default: footprint / 16)\n"
+            "  -S, --seed N              random seed (default 1)\n"
+            "  -t, --text                write a text trace\n",
+            prog, synth_pattern_names());
+    exit(-1);
+}
+
+int main (int argc, char** argv) {
+    static const struct option long_options[] = {
+        {"pattern", required_argument, NULL, 'g'},
+        {"records", required_argument, NULL, 'n'},
+        {"address-bits", required_argument, NULL, 'a'},
+        {"page-size", required_argument, NULL, 'p'},
+        {"footprint", required_argument, NULL, 'm'},
+        {"write-ratio", required_argument, NULL, 'x'},
+        {"zipf-exponent", required_argument, NULL, 'z'},
+        {"phase-length", required_argument, NULL, 'l'},
+        {"phase-pages", required_argument, NULL, 'P'},
+        {"seed", required_argument, NULL, 'S'},
+        {"text", no_argument, NULL, 't'},
+        {NULL, 0, NULL, 0}
+    };
+    struct SynthConfig config;
+    synth_default_config(&config);
+    int to_text = 0;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "g:n:a:p:m:x:z:l:P:S:t", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'g':
+                if ((config.pattern = synth_parse_pattern(optarg)) < 0) {
+                    usage(argv[0]);
+                }
+                break;
+            case 'n':
+                config.num_records = strtoul(optarg, NULL, 10);
+                break;
+            case 'a':
+                config.address_bits = atoi(optarg);
+                break;
+            case 'p':
+                config.page_size = atoi(optarg);
+                break;
+            case 'm':
+                config.footprint = atol(optarg);
+                break;
+            case 'x':
+                config.write_ratio = atof(optarg);
+                break;
+            case 'z':
+                config.zipf_exponent = atof(optarg);
+                break;
+            case 'l':
+                config.phase_length = atol(optarg);
+                break;
+            case 'P':
+                config.phase_pages = atol(optarg);
+                break;
+            case 'S':
+                config.seed = strtoull(optarg, NULL, 10);
+                break;
+            case 't':
+                to_text = 1;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (argc - optind != 1) {
+        usage(argv[0]);
+    }
+
+    uint64_t * records = synth_generate(&config);
+    if (!records) {
+        fprintf(stderr, "Invalid trace parameters or out of memory! Exiting program...\n");
+        exit(-1);
+    }
+    FILE * ofp = fopen(argv[optind], to_text ? "w" : "wb");
+    if (!ofp) {
+        fprintf(stderr, "Output trace failed to open! Exiting program...\n");
+        exit(-1);
+    }
+    int version = config.address_bits == 16 ? TRACE_VERSION_COMPACT : TRACE_VERSION_WIDE;
+    if (!to_text && trace_write_header(ofp, version, config.num_records)) {
+        fprintf(stderr, "Cannot write trace header! Exiting program...\n");
+        exit(-1);
+    }
+    for (size_t i = 0; i < config.num_records; i++) {
+        int written;
+        if (to_text) {
+            written = fprintf(ofp, "%llu\n", (unsigned long long)
+                              trace_to_entry(records[i], config.address_bits)) > 0;
+        } else if (version == TRACE_VERSION_COMPACT) {
+            uint32_t entry = trace_to_entry(records[i], 16);
+            written = fwrite(&entry, sizeof(entry), 1, ofp);
+        } else {
+            written = fwrite(&records[i], sizeof(records[i]), 1, ofp);
+        }
+        if (written != 1) {
+            fprintf(stderr, "Cannot write trace records! Exiting program...\n");
+            exit(-1);
+        }
+    }
+    fclose(ofp);
+    free(records);
+    return 0;
+}
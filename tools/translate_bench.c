@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "simulator.h"
+#include "synthetic.h"
+#include "trace.h"
+#include "vmm.h"
+
+/**
+ Translation microbenchmark. For every requested access pattern a synthetic
+ trace is generated (see synthetic.h) and run through the part 1 path (as
+ many frames as pages) and the part 2 path (fewer frames and a replacement
+ policy), quietly, against a zero-filled in-memory backing store. Only
+ sim_run is timed; each run is repeated and the fastest kept. One row per
+ pattern and engine is written to stdout as CSV or JSON, with the cost per
+ translation and the fault and TLB hit rates, so that runs can be compared
+ over time. The traces depend only on the options, never on the clock.
+
+ The libvmm engine is the part 2 path again, driven through the library in
+ batches of BENCH_BATCH accesses (see vmm.h), which shows what the library
+ boundary costs. Policies that need the whole trace in advance have no row.
+ */
+#define BENCH_ENGINES 3
+#define BENCH_LIBVMM 2
+#define BENCH_BATCH 4096
+
+static const char * const engine_names[BENCH_ENGINES] = { "part1", "part2", "libvmm" };
+
+struct BenchResult {
+    int pattern;
+    int engine;
+    long num_entries;
+    long num_faults;
+    long num_hits;
+    double seconds;
+};
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -g, --pattern NAME,...    access patterns: %s (default: all)\n"
+            "  -n, --records N           accesses per trace (default 1000000)\n"
+            "  -a, --address-bits N      width of logical addresses (default 16)\n"
+            "  -p, --page-size N         page size in bytes (default 256)\n"
+            "  -m, --footprint N         pages touched (default: the whole address space)\n"
+            "  -x, --write-ratio R       share of accesses that write (default 0.3)\n"
+            "  -S, --seed N              random seed of the traces (default 1)\n"
+            "  -f, --frames N            part 2 physical frames (default: half the footprint)\n"
+            "  -r, --policy NAME         part 2 replacement policy: %s (default fifo)\n"
+            "  -s, --tlb-sets N          number of TLB sets (default 1)\n"
+            "  -w, --tlb-ways N          entries per TLB set (default 16)\n"
+            "  -k, --tlb-lookup NAME     TLB lookup: avx2, sse2, scalar or hash (default: fastest)\n"
+            "  -u, --no-page-runs        look every access up in the TLB (see --no-page-runs\n"
+            "                            of the simulators)\n"
+            "  -R, --repeat N            runs per row, the fastest is reported (default 3)\n"
+            "  -o, --format csv|json     results table format (default csv)\n",
+            prog, synth_pattern_names(), policy_names());
+    exit(-1);
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ Runs records once under config. Returns 0 and fills in result on success.
+ */
+static int run_once(const struct SimConfig* config, const char* back_store, long back_store_size,
+                    const uint64_t* records, size_t num_records, struct BenchResult* result) {
+    struct BackStore store;
+    if (back_store_open_memory(&store, back_store, back_store_size)) {
+        return -1;
+    }
+    struct Simulator sim;
+    int failed = 1;
+    if (sim_init(&sim, config, &store) == 0) {
+        if (sim_prepare(&sim, records, num_records) == 0) {
+            double start = now_seconds();
+            failed = sim_run(&sim, records, num_records) != 0;
+            result->seconds = now_seconds() - start;
+            result->num_entries = sim.num_entries;
+            result->num_faults = sim_num_faults(&sim);
+            result->num_hits = sim.tlb.num_hits;
+        }
+        sim_free(&sim);
+    }
+    back_store_close(&store);
+    return failed ? -1 : 0;
+}
+
+/**
+ Runs records once through the library under config. Returns 0 and fills in
+ result on success.
+ */
+static int run_library(const struct SimConfig* config, long back_store_size,
+                       const uint64_t* records, size_t num_records, struct BenchResult* result) {
+    struct VmmConfig vmm_config;
+    vmm_default_config(&vmm_config);
+    vmm_config.address_bits = config->address_bits;
+    vmm_config.page_size = config->page_size;
+    vmm_config.num_frames = config->num_frames;
+    vmm_config.tlb_sets = config->tlb_sets;
+    vmm_config.tlb_ways = config->tlb_ways;
+    vmm_config.tlb_lookup = config->tlb_lookup;
+    vmm_config.policy = config->policy;
+    vmm_config.page_runs = config->page_runs;
+    vmm_config.back_store_size = back_store_size;
+    struct Vmm * vmm = vmm_create(&vmm_config);
+    if (!vmm) {
+        return -1;
+    }
+    static struct VmmTranslation out[BENCH_BATCH];
+    double start = now_seconds();
+    for (size_t i = 0; i < num_records; i += BENCH_BATCH) {
+        size_t n = num_records - i < BENCH_BATCH ? num_records - i : BENCH_BATCH;
+        if (vmm_translate_batch(vmm, records + i, n, out)) {
+            vmm_destroy(vmm);
+            return -1;
+        }
+    }
+    result->seconds = now_seconds() - start;
+    struct VmmStats stats;
+    vmm_stats(vmm, &stats);
+    result->num_entries = stats.accesses;
+    result->num_faults = stats.page_faults;
+    result->num_hits = stats.tlb_hits;
+    vmm_destroy(vmm);
+    return 0;
+}
+
+static void print_results(const struct BenchResult* results, int num_results, int json) {
+    if (json) {
+        printf("[\n");
+    } else {
+        printf("pattern,engine,accesses,seconds,ns_per_access,m_accesses_per_s,page_fault_rate,"
+               "tlb_hit_rate\n");
+    }
+    for (int i = 0; i < num_results; i++) {
+        const struct BenchResult * r = &results[i];
+        double n = r->num_entries > 0 ? (double) r->num_entries : 1.0;
+        double seconds = r->seconds > 0 ? r->seconds : 1e-9;
+        if (json) {
+            printf("  {\"pattern\": \"%s\", \"engine\": \"%s\", \"accesses\": %ld, "
+                   "\"seconds\": %.6f, \"ns_per_access\": %.2f, \"m_accesses_per_s\": %.2f, "
+                   "\"page_fault_rate\": %f, \"tlb_hit_rate\": %f}%s\n",
+                   synth_pattern_name(r->pattern), engine_names[r->engine], r->num_entries,
+                   r->seconds, seconds * 1e9 / n, n / seconds / 1e6, r->num_faults / n,
+                   r->num_hits / n, i + 1 < num_results ? "," : "");
+        } else {
+            printf("%s,%s,%ld,%.6f,%.2f,%.2f,%f,%f\n",
+                   synth_pattern_name(r->pattern), engine_names[r->engine], r->num_entries,
+                   r->seconds, seconds * 1e9 / n, n / seconds / 1e6, r->num_faults / n,
+                   r->num_hits / n);
+        }
+    }
+    if (json) {
+        printf("]\n");
+    }
+}
+
+int main (int argc, char** argv) {
+    static const struct option long_options[] = {
+        {"pattern", required_argument, NULL, 'g'},
+        {"records", required_argument, NULL, 'n'},
+        {"address-bits", required_argument, NULL, 'a'},
+        {"page-size", required_argument, NULL, 'p'},
+        {"footprint", required_argument, NULL, 'm'},
+        {"write-ratio", required_argument, NULL, 'x'},
+        {"seed", required_argument, NULL, 'S'},
+        {"frames", required_argument, NULL, 'f'},
+        {"policy", required_argument, NULL, 'r'},
+        {"tlb-sets", required_argument, NULL, 's'},
+        {"tlb-ways", required_argument, NULL, 'w'},
+        {"tlb-lookup", required_argument, NULL, 'k'},
+        {"no-page-runs", no_argument, NULL, 'u'},
+        {"repeat", required_argument, NULL, 'R'},
+        {"format", required_argument, NULL, 'o'},
+        {NULL, 0, NULL, 0}
+    };
+    struct SynthConfig synth;
+    synth_default_config(&synth);
+    struct SimConfig base;
+    sim_default_config(&base);
+    base.quiet = 1;
+    int patterns[SYNTH_NUM_PATTERNS];
+    int num_patterns = SYNTH_NUM_PATTERNS;
+    for (int i = 0; i < SYNTH_NUM_PATTERNS; i++) {
+        patterns[i] = i;
+    }
+    int frames = 0, repeat = 3, json = 0;
+    int opt;
+    while ((opt = getopt_long(argc, argv, "g:n:a:p:m:x:S:f:r:s:w:k:uR:o:", long_options,
+                              NULL)) != -1) {
+        switch (opt) {
+            case 'g':
+                num_patterns = 0;
+                for (char * name = strtok(optarg, ","); name; name = strtok(NULL, ",")) {
+                    if (num_patterns == SYNTH_NUM_PATTERNS ||
+                        (patterns[num_patterns++] = synth_parse_pattern(name)) < 0) {
+                        usage(argv[0]);
+                    }
+                }
+                break;
+            case 'n':
+                synth.num_records = strtoul(optarg, NULL, 10);
+                break;
+            case 'a':
+                synth.address_bits = base.address_bits = atoi(optarg);
+                break;
+            case 'p':
+                synth.page_size = base.page_size = atoi(optarg);
+                break;
+            case 'm':
+                synth.footprint = atol(optarg);
+                break;
+            case 'x':
+                synth.write_ratio = atof(optarg);
+                break;
+            case 'S':
+                synth.seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'f':
+                frames = atoi(optarg);
+                break;
+            case 'r':
+                base.policy = optarg;
+                break;
+            case 's':
+                base.tlb_sets = atoi(optarg);
+                break;
+            case 'w':
+                base.tlb_ways = atoi(optarg);
+                break;
+            case 'k':
+                base.tlb_lookup = optarg;
+                break;
+            case 'u':
+                base.page_runs = 0;
+                break;
+            case 'R':
+                repeat = atoi(optarg);
+                break;
+            case 'o':
+                if (strcmp(optarg, "csv") && strcmp(optarg, "json")) {
+                    usage(argv[0]);
+                }
+                json = strcmp(optarg, "json") == 0;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind != argc || num_patterns < 1 || repeat < 1 || frames < 0 ||
+        base.address_bits < 1 || base.address_bits > TRACE_MAX_ADDRESS_BITS ||
+        base.page_size < 1) {
+        usage(argv[0]);
+    }
+    long footprint = synth.footprint > 0 ? synth.footprint
+                     : (long) ((UINT64_C(1) << base.address_bits) / base.page_size);
+    if (frames == 0) {
+        frames = footprint / 2 > 0 ? (int) (footprint / 2) : 1;
+    }
+
+    // every run starts from the same zero-filled store covering the footprint
+    long back_store_size = footprint * base.page_size;
+    char * back_store = (char *) calloc(back_store_size > 0 ? back_store_size : 1, 1);
+    struct BenchResult * results =
+        (struct BenchResult *) calloc(num_patterns * BENCH_ENGINES, sizeof(struct BenchResult));
+    if (!back_store || !results) {
+        fprintf(stderr, "Cannot allocate the backing store! Exiting program...\n");
+        exit(-1);
+    }
+
+    int num_results = 0, num_engines = BENCH_ENGINES;
+    for (int p = 0; p < num_patterns; p++) {
+        synth.pattern = patterns[p];
+        uint64_t * records = synth_generate(&synth);
+        if (!records) {
+            fprintf(stderr, "Cannot generate the %s trace! Exiting program...\n",
+                    synth_pattern_name(synth.pattern));
+            exit(-1);
+        }
+        for (int e = 0; e < num_engines; e++) {
+            struct SimConfig config = base;
+            config.num_frames = e == 0 ? 0 : frames;
+            struct BenchResult * best = &results[num_results++];
+            best->pattern = synth.pattern;
+            best->engine = e;
+            best->seconds = -1;
+            for (int i = 0; i < repeat; i++) {
+                struct BenchResult run = *best;
+                if (e == BENCH_LIBVMM &&
+                    run_library(&config, back_store_size, records, synth.num_records, &run)) {
+                    // vmm_create has said why; no later pattern would do better
+                    num_engines = BENCH_LIBVMM;
+                    num_results--;
+                    break;
+                }
+                if (e != BENCH_LIBVMM &&
+                    run_once(&config, back_store, back_store_size, records, synth.num_records,
+                             &run)) {
+                    fprintf(stderr, "The %s run of the %s trace failed! Exiting program...\n",
+                            engine_names[e], synth_pattern_name(synth.pattern));
+                    exit(-1);
+                }
+                if (best->seconds < 0 || run.seconds < best->seconds) {
+                    *best = run;
+                }
+            }
+        }
+        free(records);
+    }
+    print_results(results, num_results, json);
+
+    free(results);
+    free(back_store);
+    return 0;
+}